@@ -5,14 +5,16 @@
 #include <optional>
 #include <span>
 #include <vulkan/vulkan.hpp>
+#include <vk-types.h>
 
 struct descriptor_layout_builder_t
 {
     std::vector<vk::DescriptorSetLayoutBinding> bindings;
+    std::vector<vk::DescriptorBindingFlags> binding_flags;
 
-    descriptor_layout_builder_t& add_binding(std::uint32_t binding, vk::DescriptorType type);
+    descriptor_layout_builder_t& add_binding(std::uint32_t binding, vk::DescriptorType type, std::uint32_t count = 1, vk::DescriptorBindingFlags flags = {});
     void clear();
-    std::optional<vk::DescriptorSetLayout> build(vk::Device device, vk::ShaderStageFlags shader_stages);
+    std::optional<vk::DescriptorSetLayout> build(vk::Device device, vk::ShaderStageFlags shader_stages, vk::DescriptorSetLayoutCreateFlags flags = {});
 };
 
 struct descriptor_allocator_t
@@ -25,7 +27,7 @@ struct descriptor_allocator_t
 
     vk::DescriptorPool pool;
 
-    bool init_pool(vk::Device device, std::uint32_t max_sets, std::span<pool_size_ratio_t> pool_ratios);
+    bool init_pool(vk::Device device, std::uint32_t max_sets, std::span<pool_size_ratio_t> pool_ratios, vk::DescriptorPoolCreateFlags flags = {});
     void clear_descriptors(vk::Device device);
     void destroy_pool(vk::Device device);
 
@@ -61,9 +63,62 @@ struct descriptor_writer_t
     std::deque<vk::DescriptorBufferInfo> buffer_infos;
     std::vector<vk::WriteDescriptorSet> writes;
 
-    void write_image(std::int32_t binding, vk::ImageView image, vk::Sampler sampler, vk::ImageLayout layout, vk::DescriptorType type);
-    void write_buffer(std::int32_t binding, vk::Buffer buffer, std::size_t size, std::size_t offset, vk::DescriptorType type);
+    void write_image(std::int32_t binding, vk::ImageView image, vk::Sampler sampler, vk::ImageLayout layout, vk::DescriptorType type,
+            std::uint32_t array_element = 0);
+    void write_buffer(std::int32_t binding, vk::Buffer buffer, std::size_t size, std::size_t offset, vk::DescriptorType type,
+            std::uint32_t array_element = 0);
 
     void clear();
     void update_set(vk::Device device, vk::DescriptorSet set);
 };
+
+/// Hands out slots of a descriptor array e.g. the texture array of the bindless descriptor set.
+/// Released slots are reused before new ones are handed out.
+struct descriptor_index_allocator_t
+{
+    std::uint32_t capacity = 0;
+    std::uint32_t next = 0;
+    std::vector<std::uint32_t> free_list;
+
+    std::optional<std::uint32_t> allocate();
+    void release(std::uint32_t index);
+};
+
+/// Descriptor storage for set layouts created with `eDescriptorBufferEXT`.
+/// Sets are linearly allocated from the range [`base`, `base + size`) of a host visible buffer. Descriptors are written with `getDescriptorEXT`
+/// and sets are bound by their offset into the buffer. `reset` turns the range into a ring that is reused every frame.
+/// Several `descriptor_buffer_t` can share one buffer, the owner of the buffer is responsible for destroying it.
+struct descriptor_buffer_t
+{
+    allocated_buffer_t buffer;
+    vk::DeviceAddress address;
+    vk::BufferUsageFlags usage;
+    vk::DeviceSize base = 0;
+    vk::DeviceSize size = 0;
+    vk::DeviceSize head = 0;
+    vk::PhysicalDeviceDescriptorBufferPropertiesEXT properties;
+
+    /// Params:
+    /// * `buffer`     - persistently mapped buffer created with `usage` and `eShaderDeviceAddress`
+    /// * `usage`      - descriptor buffer usage flags of `buffer`
+    /// * `properties` - descriptor sizes and alignment of the device
+    /// * `base`       - start of the range sets are allocated from
+    /// * `size`       - size of the range sets are allocated from
+    void init(vk::Device device, allocated_buffer_t buffer, vk::BufferUsageFlags usage, const vk::PhysicalDeviceDescriptorBufferPropertiesEXT& properties,
+            vk::DeviceSize base, vk::DeviceSize size);
+    void reset();
+
+    /// Reserves memory for one set of the given layout.
+    ///
+    /// Returns:
+    /// * `vk::DeviceSize` - offset of the set from the start of the buffer
+    /// * `std::nullopt` - if the buffer is full
+    std::optional<vk::DeviceSize> allocate(vk::Device device, vk::DescriptorSetLayout layout, const vk::DispatchLoaderDynamic& dispatch);
+
+    void write_image(vk::Device device, vk::DescriptorSetLayout layout, vk::DeviceSize set_offset, std::uint32_t binding, vk::ImageView image,
+            vk::Sampler sampler, vk::ImageLayout image_layout, vk::DescriptorType type, const vk::DispatchLoaderDynamic& dispatch, std::uint32_t array_element = 0);
+    void write_buffer(vk::Device device, vk::DescriptorSetLayout layout, vk::DeviceSize set_offset, std::uint32_t binding, vk::DeviceAddress buffer_address,
+            std::size_t size, vk::DescriptorType type, const vk::DispatchLoaderDynamic& dispatch, std::uint32_t array_element = 0);
+
+    vk::DescriptorBufferBindingInfoEXT binding_info() const;
+};
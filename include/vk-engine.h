@@ -1,8 +1,12 @@
 #pragma once
 
 #include "vk-images.h"
+#include <array>
+#include <atomic>
 #include <cstdint>
+#include <deque>
 #include <functional>
+#include <mutex>
 #include <vulkan/vulkan.hpp>
 #include <GLFW/glfw3.h>
 #include <VkBootstrap.h>
@@ -11,6 +15,9 @@
 #include <vk-descriptors.h>
 #include <vk-pipelines.h>
 #include <vk-loader.h>
+#include <vk-governor.h>
+#include <vk-upload.h>
+#include <vk-jobs.h>
 
 #include <glm/glm.hpp>
 #include <camera.h>
@@ -22,11 +29,110 @@ struct engine_stats_t
     std::uint32_t drawcall_count;
     float scene_update_time;
     float mesh_draw_time;
+    // measured with timestamp queries, 0 if the graphics queue does not support them
+    float gpu_frame_time;
+};
+
+// How descriptor sets of the scene data and bindless layouts are stored and bound.
+// `BUFFER` requires VK_EXT_descriptor_buffer and falls back to `POOL` if the device does not support it.
+enum struct descriptor_backend_e : std::uint8_t
+{
+    POOL,
+    BUFFER
+};
+
+// How `draw_image` is brought to the resolution of the swapchain.
+// `TEMPORAL` accumulates jittered frames and requires motion vectors in `upscaler.motion_image`, which the default `draw_cmd` renders.
+enum struct upscale_mode_e : std::uint8_t
+{
+    LINEAR,
+    SPATIAL,
+    TEMPORAL
+};
+
+// Passes of a frame in the order they are recorded, transient images declare the passes they are used in.
+enum struct frame_pass_e : std::uint8_t
+{
+    BACKGROUND,
+    GEOMETRY,
+    UPSCALE,
+    SHARPEN,
+    IMGUI
+};
+
+// Image that only lives from `first_pass` to `last_pass` within a frame. Its contents are undefined at `first_pass`,
+// so it has to be transitioned from `vk::ImageLayout::eUndefined` there every frame.
+struct transient_image_info_t
+{
+    vk::Format format;
+    vk::ImageUsageFlags usage;
+    frame_pass_e first_pass;
+    frame_pass_e last_pass;
+    // The image is only an attachment that is cleared or not loaded and not stored, so it never leaves tile memory.
+    // Such images get `vk::ImageUsageFlagBits::eTransientAttachment` and lazily allocated memory if the device has it.
+    bool tile_only = false;
+};
+
+// Categories allocations are tracked by, see `engine_t::track_allocation`.
+enum struct memory_category_e : std::uint8_t
+{
+    RENDER_TARGETS,
+    MESHES,
+    TEXTURES,
+    STAGING,
+    FRAME,
+    // every allocation VMA knows of that is in none of the other categories
+    OTHER
+};
+constexpr std::size_t MEMORY_CATEGORY_COUNT = 6;
+constexpr std::array<const char*, MEMORY_CATEGORY_COUNT> MEMORY_CATEGORY_NAMES = { "render_targets", "meshes", "textures", "staging",
+    "frame", "other" };
+
+// Snapshot of the device memory of the engine, see `engine_t::memory_report`.
+struct memory_report_t
+{
+    struct heap_t
+    {
+        bool device_local;
+        // bytes the process uses and may use of the heap, from VK_EXT_memory_budget if the device has it
+        vk::DeviceSize usage;
+        vk::DeviceSize budget;
+        std::uint32_t allocations;
+        vk::DeviceSize allocation_bytes;
+        // bytes of the `vk::DeviceMemory` blocks VMA allocated, including the free ranges between allocations
+        vk::DeviceSize block_bytes;
+    };
+    struct category_t
+    {
+        std::uint32_t allocations = 0;
+        vk::DeviceSize bytes = 0;
+    };
+    struct scene_t
+    {
+        std::string name;
+        std::uint32_t images = 0;
+        vk::DeviceSize image_bytes = 0;
+        // ranges of the geometry pool
+        std::uint32_t meshes = 0;
+        vk::DeviceSize mesh_bytes = 0;
+    };
+
+    std::vector<heap_t> heaps;
+    std::array<category_t, MEMORY_CATEGORY_COUNT> categories;
+    std::vector<scene_t> scenes;
+    std::uint32_t allocations = 0;
+    vk::DeviceSize allocation_bytes = 0;
+    vk::DeviceSize block_bytes = 0;
+    // bytes of the geometry pool in use by meshes and its size
+    vk::DeviceSize geometry_used = 0;
+    vk::DeviceSize geometry_size = 0;
 };
 
 struct mesh_node_t : public node_t
 {
     std::shared_ptr<mesh_asset_t> mesh;
+    // world transforms of the last draw, used for motion vectors
+    std::vector<glm::mat4> previous_transforms;
     virtual void draw(const glm::mat4& top_matrix, draw_context_t& ctx) override;
     virtual void draw(const std::vector<glm::mat4>& top_matrix, draw_context_t& ctx) override;
     virtual ~mesh_node_t() {};
@@ -37,11 +143,18 @@ struct render_object_t
     std::uint32_t index_count;
     std::uint32_t first_index;
     vk::Buffer index_buffer;
+    vk::IndexType index_type;
 
     material_instance_t* material;
     bounds_t bounds;
     std::vector<glm::mat4> transform;
+    std::vector<glm::mat4> previous_transform;
     vk::DeviceAddress vertex_buffer_address;
+    vertex_format_e vertex_format;
+    glm::vec3 position_offset;
+    glm::vec3 position_scale;
+    // the object is skipped until the uploads of its mesh and material are done
+    upload_ticket_t ticket;
 };
 
 struct draw_context_t
@@ -53,66 +166,45 @@ struct draw_context_t
 struct gltf_metallic_roughness_t
 {
     material_pipeline_t opaque_pipeline;
+    // shares the main pass pipelines with `opaque_pipeline` but alpha tests in the depth pre-pass
+    material_pipeline_t masked_pipeline;
     material_pipeline_t transparent_pipeline;
 
-    vk::DescriptorSetLayout material_layout;
-
     // size: 256 bytes
     struct material_constants_t
     {
         glm::vec4 color_factors;
         glm::vec4 metal_rough_factors;
-        glm::vec4 extra[14];
+        // x: color texture, y: color sampler, z: metal rough texture, w: metal rough sampler
+        glm::uvec4 texture_indices;
+        // extra[0].x: alpha cutoff of masked materials
+        glm::vec4 extra[13];
     };
 
-    struct material_resources_t
-    {
-        struct img_t
-        {
-            std::size_t binding;
-            allocated_image_t image;
-            vk::Sampler sampler;
-            vk::ImageLayout layout;
-            vk::DescriptorType type;
-        };
-        struct buf_t
-        {
-            std::size_t binding;
-            vk::Buffer buffer;
-            std::uint32_t offset;
-            std::size_t size;
-            vk::DescriptorType type;
-        };
-        std::vector<img_t> images;
-        std::vector<buf_t> buffers;
-    };
-
-    descriptor_writer_t writer;
-
     /// Builds opaque and transparent pipelines for the given shader modules.
+    /// The depth pre-pass variants of the opaque pipelines are generated from the same state with the engine's depth-only shaders.
+    /// The pipeline layout uses the scene data layout as set 0 and the bindless layout as set 1.
+    /// Without `formats` the pipelines render into `draw_image` and the motion vectors of the upscaler.
     ///
     /// Returns:
     /// `true` - success
     /// `false` - if pipeline creation failed
-    bool build_pipelines(engine_t* engine, std::string vertex, std::string fragment,
-            std::size_t push_constants_size, std::vector<std::tuple<std::uint32_t, vk::DescriptorType>> bindings,
-            std::vector<vk::DescriptorSetLayout> external_layouts, std::vector<vk::VertexInputBindingDescription> input_bindings = {},
-            std::vector<vk::VertexInputAttributeDescription> input_attributes = {}, std::vector<vk::Format> formats = {});
+    bool build_pipelines(engine_t* engine, std::string vertex, std::string fragment, std::size_t push_constants_size,
+            std::vector<vk::VertexInputBindingDescription> input_bindings = {}, std::vector<vk::VertexInputAttributeDescription> input_attributes = {},
+            std::vector<vk::Format> formats = {});
     void clear_resources(vk::Device device);
-    /// Creates a new `material_instance_t` based on the given `material_resources_t`.
-    /// Allocates and updates the descriptor set using the given `descriptor_allocator_growable_t`.
+    /// Creates a new `material_instance_t` based on the given `material_constants_t`.
+    /// The constants are stored in the material buffer of the bindless descriptor set.
     ///
     /// Params:
-    /// * `device`               - `vk::Device` to use for allocation
-    /// * `pass`                 - type of the pass this material is used in
-    /// * `resources`            - resources used in the material e.g. textures, data, etc.
-    /// * `descriptor_allocator` - allocator used to allocate the descriptor set
+    /// * `engine`    - engine that owns the bindless descriptor set
+    /// * `pass`      - type of the pass this material is used in
+    /// * `constants` - material factors and bindless texture/sampler indices
     ///
     /// Returns:
     /// * `material_instance_t` - success
-    /// * `std::nullopt` - failed to allocate descriptor set
-    std::optional<material_instance_t> write_material(vk::Device device, material_pass_e pass, const material_resources_t& resources,
-            descriptor_allocator_growable_t& descriptor_allocator);
+    /// * `std::nullopt` - the material buffer is full
+    std::optional<material_instance_t> write_material(engine_t* engine, material_pass_e pass, const material_constants_t& constants);
 };
 
 struct compute_push_constants_t
@@ -123,6 +215,22 @@ struct compute_push_constants_t
     glm::vec4 data4;
 };
 
+struct upscale_push_constants_t
+{
+    glm::ivec2 input_extent;
+    glm::ivec2 output_extent;
+    float sharpness;
+};
+
+struct taa_push_constants_t
+{
+    glm::ivec2 input_extent;
+    glm::ivec2 output_extent;
+    glm::vec2 jitter;
+    float blend;
+    std::uint32_t reset;
+};
+
 struct compute_effect_t
 {
     const char* name;
@@ -139,6 +247,11 @@ struct gpu_scene_data_t
     alignas(16) glm::vec4 ambient_color;
     alignas(16) glm::vec4 sunlight_dir;
     alignas(16) glm::vec4 sunlight_color;
+    // without the sub-pixel jitter of the temporal upscaler, used for motion vectors
+    alignas(16) glm::mat4 unjittered_viewproj;
+    alignas(16) glm::mat4 prev_viewproj;
+    // xy: jitter in pixels
+    alignas(16) glm::vec4 jitter;
 };
 
 struct deletion_queue_t
@@ -156,10 +269,70 @@ struct frame_data_t
     vk::Semaphore swapchain_semaphore, render_semaphore;
     vk::Fence render_fence;
 
+    // Only used if the compute queue is separate from the graphics queue.
+    vk::CommandPool compute_pool;
+    vk::CommandBuffer compute_buffer;
+    vk::Semaphore compute_semaphore;
+
     deletion_queue_t deletion_queue;
     descriptor_allocator_growable_t frame_descriptors;
+
+    // Persistently mapped scene data of this frame. `scene_set` is only used if push descriptors are not supported.
+    allocated_buffer_t scene_buffer;
+    vk::DescriptorSet scene_set;
+    // Region of the engine's descriptor buffer that is rewritten every frame. Only used with `descriptor_backend_e::BUFFER`.
+    descriptor_buffer_t descriptor_ring;
+
+    // Timestamps at the start and end of the command buffer of this frame.
+    vk::QueryPool timestamp_pool;
+    bool timestamps_written = false;
 };
 constexpr std::uint32_t FRAME_OVERLAP = 2;
+constexpr std::uint32_t BINDLESS_MAX_TEXTURES = 4096;
+constexpr std::uint32_t BINDLESS_MAX_SAMPLERS = 64;
+constexpr std::uint32_t BINDLESS_MAX_MATERIALS = 4096;
+constexpr std::size_t DESCRIPTOR_RING_SIZE = 64 * 1024;
+constexpr std::size_t GEOMETRY_POOL_VERTEX_SIZE = 128 * 1024 * 1024;
+constexpr std::size_t GEOMETRY_POOL_INDEX_SIZE = 32 * 1024 * 1024;
+constexpr float MIN_RENDER_SCALE = .25f;
+// render targets are reallocated this much larger than the swapchain, so growing a window does not reallocate them every frame
+constexpr float RENDER_TARGET_HEADROOM = 1.125f;
+// mip levels up to this size are uploaded with the model, the finer ones are streamed in afterwards
+constexpr std::uint32_t TEXTURE_STREAM_TAIL_SIZE = 64;
+constexpr vk::DeviceSize TEXTURE_STREAM_BUDGET = 8 * 1024 * 1024;
+// streamed textures drawn within this many frames are not evicted
+constexpr std::uint64_t RESIDENCY_IDLE_FRAMES = 60;
+// bounds of a defragmentation pass, which runs within one frame
+constexpr vk::DeviceSize DEFRAG_BYTES_PER_PASS = 16 * 1024 * 1024;
+constexpr std::uint32_t DEFRAG_MOVES_PER_PASS = 32;
+// frames between the end of a defragmentation and the start of the next one
+constexpr std::uint64_t DEFRAG_INTERVAL_FRAMES = 600;
+
+enum struct model_load_state_e : std::uint8_t
+{
+    // parsing, decoding and recording the uploads on a worker
+    LOADING,
+    // waiting for the uploads on the GPU
+    UPLOADING,
+    // inserted into `loaded_scenes`
+    RESIDENT,
+    FAILED
+};
+
+// Progress of a model loaded by `engine_t::load_model_async`. Only `state` may be read while the model is loading.
+struct model_load_t
+{
+    std::string path;
+    std::string name;
+    vertex_format_e format;
+    gltf_metallic_roughness_t* material;
+    // instance transforms the scene is inserted with
+    std::vector<glm::mat4> transform;
+
+    std::atomic<model_load_state_e> state = model_load_state_e::LOADING;
+    // written by the worker before `state` leaves `LOADING`
+    std::shared_ptr<loaded_gltf_t> scene;
+};
 
 struct engine_t
 {
@@ -167,6 +340,8 @@ struct engine_t
     vkb::Instance vkb_instance;
     vk::Instance instance;
     vk::DebugUtilsMessengerEXT messenger;
+    // NOTE: Extension functions are not exported by the loader, so they have to be called through this dispatcher.
+    vk::DispatchLoaderDynamic dispatch;
 
     VmaAllocator allocator;
 
@@ -190,6 +365,24 @@ struct engine_t
         };
         queue_t graphics;
         queue_t present;
+        // separate compute queue family if the device has one, otherwise the graphics queue
+        queue_t compute;
+        // separate transfer queue family if the device has one, otherwise the graphics queue
+        queue_t transfer;
+
+        // optional extensions and features that were enabled on the device
+        struct
+        {
+            bool push_descriptor = false;
+            bool descriptor_buffer = false;
+            bool storage_write_without_format = false;
+            // VK_EXT_host_image_copy with `vk::ImageLayout::eShaderReadOnlyOptimal` as a copy destination layout
+            bool host_image_copy = false;
+            // BC1-BC7 compressed textures
+            bool texture_compression_bc = false;
+            // VK_EXT_memory_budget, VMA then reports the budget and usage of the driver instead of estimating them
+            bool memory_budget = false;
+        } extensions;
     } device;
 
     struct swapchain_t
@@ -199,19 +392,48 @@ struct engine_t
         vk::Extent2D extent;
         std::vector<vk::Image> images;
         std::vector<vk::ImageView> views;
+        // the images were created with storage usage and can be written by compute shaders
+        bool storage = false;
     } swapchain;
 
     // TODO: Images should not be hard coded for general usage e.g. deferred rendering where more than one image is required before copying to the swapchain
+    // At least the size of the swapchain, see `update_render_targets`.
     allocated_image_t draw_image;
-    std::vector<allocated_image_t> color_images;
+    // transient, only used by the geometry pass
     allocated_image_t depth_image;
-    std::vector<allocated_image_t> depth_images;
     vk::Extent2D draw_extent;
+    // NOTE: Only shrinks `draw_extent` inside of the fixed size render targets, changing it never reallocates images.
     float render_scale = 1.f;
 
+    // Transient images at the size of `draw_image`, see `declare_transient_image`. Images whose passes do not overlap share the
+    // memory of one allocation, tile only images live in lazily allocated memory if the device has it.
+    struct
+    {
+        std::vector<std::pair<allocated_image_t*, transient_image_info_t>> declared;
+        // created images, `allocation` is null for the ones bound to `allocation` below
+        std::vector<allocated_image_t> images;
+        VmaAllocation allocation = nullptr;
+        // bytes of the shared allocation and of the images without aliasing
+        vk::DeviceSize size = 0;
+        vk::DeviceSize unaliased_size = 0;
+        vk::DeviceSize lazy_size = 0;
+        // set by `declare_transient_image`, the images are created again at the start of the next frame
+        bool dirty = false;
+    } transients;
+
     frame_data_t frames[FRAME_OVERLAP];
     std::size_t frame_count = 0;
 
+    // Signaled with an increasing value by every graphics submission, so other queues can wait for the previous frame.
+    vk::Semaphore frame_timeline;
+    std::uint64_t frame_timeline_value = 0;
+
+    // Submits `compute_cmd` to the compute queue ahead of the graphics work of the frame, which then only waits for it where
+    // the draw image is first used as an attachment. Has no effect if the device has no separate compute queue.
+    bool use_async_compute = true;
+    // set while recording `draw_cmd` if `compute_cmd` has been recorded for the compute queue this frame
+    bool compute_submitted = false;
+
     deletion_queue_t main_deletion_queue;
 
     descriptor_allocator_growable_t global_descriptor_allocator;
@@ -243,8 +465,170 @@ struct engine_t
     {
         gpu_scene_data_t gpu_data;
         vk::DescriptorSetLayout layout;
+        // unjittered view projection of the last frame
+        glm::mat4 prev_viewproj;
+        bool prev_valid = false;
     } scene_data;
 
+    // Has to be set before calling `init_vulkan`.
+    descriptor_backend_e descriptor_backend = descriptor_backend_e::POOL;
+
+    // Renders the depth of the culled opaque surfaces before the main pass, which then only shades visible fragments.
+    bool depth_prepass = false;
+
+    // Upscaling from `draw_extent` to the swapchain.
+    // `SPATIAL`: An edge adaptive upsampling pass (EASU) writes into `image`.
+    // `TEMPORAL`: The jittered frame is accumulated into one of the `history` images, reprojected with `motion_image`.
+    // The result of either is sharpened (RCAS) straight into the swapchain if it supports storage or back into `draw_image` otherwise.
+    // `LINEAR` blits the draw image to the swapchain.
+    struct
+    {
+        upscale_mode_e mode = upscale_mode_e::SPATIAL;
+        // in stops, 0 is the sharpest
+        float sharpness = .2f;
+        // transient, written by the upscale pass and read by the sharpening pass
+        allocated_image_t image;
+        vk::DescriptorSetLayout layout;
+        vk::PipelineLayout pipeline_layout;
+        vk::Pipeline easu_pipeline;
+        vk::Pipeline rcas_pipeline;
+        vk::Pipeline rcas_present_pipeline;
+
+        // weight of the current frame in the history
+        float blend = .1f;
+        // transient, written by the geometry pass and read by the upscale pass
+        allocated_image_t motion_image;
+        allocated_image_t history[2];
+        std::uint32_t history_index = 0;
+        bool history_valid = false;
+        // set by `draw_cmd` if motion vectors were rendered this frame, `TEMPORAL` falls back to `SPATIAL` otherwise
+        bool motion_written = false;
+        glm::vec2 jitter = glm::vec2(0.f);
+        std::uint32_t jitter_index = 0;
+        vk::Sampler sampler;
+        vk::DescriptorSetLayout taa_layout;
+        vk::PipelineLayout taa_pipeline_layout;
+        vk::Pipeline taa_pipeline;
+    } upscaler;
+
+    // Uploads meshes and textures on the transfer queue. Surfaces are not drawn until the uploads of their mesh and textures are done.
+    upload_manager_t uploads;
+    // Compute downsampler for uploaded textures and depth pyramids, only initialized if the device supports push descriptors
+    // and storage image writes without a format.
+    mip_generator_t mips;
+    // Encodes PNG and JPEG textures of loaded models to BC1/BC3 on the job pool, if the device supports BC formats, instead of
+    // uploading them uncompressed. The results are cached in `texture_cache_dir` by a hash of the source image.
+    bool compress_textures = false;
+    // defaults to `tests/build/texture_cache`, an empty path disables the cache
+    std::string texture_cache_dir;
+    // Loads models with only the mip levels up to `TEXTURE_STREAM_TAIL_SIZE` resident, so they can be drawn right away.
+    // The finer levels are uploaded by `update_texture_streaming`, at most `texture_stream_budget` bytes per frame.
+    bool texture_streaming = true;
+    vk::DeviceSize texture_stream_budget = TEXTURE_STREAM_BUDGET;
+
+    // Keeps device local memory within `budget` by evicting the finer levels of the streamed textures that were drawn least
+    // recently, see `update_residency`. Textures drawn again are expanded if they fit into the budget.
+    struct
+    {
+        // in bytes, 0 uses 90% of the budget VMA reports for the device local heaps
+        vk::DeviceSize budget = 0;
+        // measured by the last `update_residency`
+        vk::DeviceSize usage = 0;
+        vk::DeviceSize effective_budget = 0;
+        // Evicted images are destroyed a few frames later, memory is not measured again until then.
+        std::size_t settle_frame = 0;
+        std::uint32_t evictions = 0;
+    } residency;
+
+    // Allocations tagged by `track_allocation`, updated from any thread.
+    struct
+    {
+        std::array<std::atomic<std::uint32_t>, MEMORY_CATEGORY_COUNT> allocations = {};
+        std::array<std::atomic<vk::DeviceSize>, MEMORY_CATEGORY_COUNT> bytes = {};
+        // Device local usage above this fraction of the budget is warned about once, again after it fell below it.
+        float warn_ratio = .9f;
+        bool warned = false;
+        // written by the button of the memory window
+        std::string dump_path = "memory.json";
+        // `memory_report` shown by the memory window, which walks every block of VMA, so it is only refreshed every
+        // `report_interval` seconds or by the refresh button
+        std::optional<memory_report_t> report;
+        double report_time = 0.;
+        float report_interval = 1.f;
+    } memory;
+
+    // Compacts the memory of the textures of loaded models, opt-in and has to be enabled before `init_vulkan`. Textures are then
+    // allocated from `pool`, so every allocation a pass moves is a texture the engine can recreate. Meshes are sub-allocated
+    // from the geometry pool buffers, which never move. See `update_defragmentation`.
+    struct
+    {
+        bool enabled = false;
+        vk::DeviceSize bytes_per_pass = DEFRAG_BYTES_PER_PASS;
+        std::uint32_t moves_per_pass = DEFRAG_MOVES_PER_PASS;
+        std::uint64_t interval = DEFRAG_INTERVAL_FRAMES;
+        VmaPool pool = nullptr;
+        VmaDefragmentationContext context = nullptr;
+        VmaDefragmentationPassMoveInfo pass = {};
+        // Set while the copies of `pass` are in flight, it ends once the frame timeline reaches `pass_value`.
+        bool pass_open = false;
+        std::uint64_t pass_value = 0;
+        // images the copies read from and their views, destroyed when the pass ends
+        std::vector<vk::Image> moved_images;
+        std::vector<vk::ImageView> moved_views;
+        std::uint64_t next_frame = 0;
+        std::uint32_t moved_allocations = 0;
+        vk::DeviceSize moved_bytes = 0;
+    } defrag;
+
+    struct retired_t
+    {
+        std::uint64_t frame_timeline_value;
+        upload_ticket_t ticket;
+        std::function<void()> function;
+    };
+    // Functions that destroy resources frames in flight or uploads may still use, each runs once the frame timeline reaches its
+    // value and its upload is done.
+    std::deque<retired_t> retired;
+
+    // Adjusts `render_scale` and any other registered knobs to the measured GPU frame time. Disabled by default.
+    quality_governor_t governor;
+    // nanoseconds per timestamp tick, 0 if timestamps are not supported on the graphics queue
+    float timestamp_period = 0.f;
+    std::uint64_t timestamp_mask = 0;
+
+    // Global update-after-bind descriptor set shared by all materials.
+    // binding 0: material constants, binding 1: texture array, binding 2: sampler array
+    // With `descriptor_backend_e::BUFFER` the set lives at `buffer_offset` in `descriptor_buffer`, followed by the rings of the frames.
+    struct
+    {
+        vk::DescriptorSetLayout layout;
+        vk::DescriptorSet set;
+        descriptor_allocator_t allocator;
+        descriptor_buffer_t descriptor_buffer;
+        vk::DeviceSize buffer_offset;
+        allocated_buffer_t material_buffer;
+        descriptor_index_allocator_t textures;
+        descriptor_index_allocator_t samplers;
+        descriptor_index_allocator_t materials;
+
+        std::uint32_t white_texture;
+        std::uint32_t error_texture;
+        std::uint32_t linear_sampler;
+        std::uint32_t nearest_sampler;
+    } bindless;
+
+    // Device local buffers all meshes are sub-allocated from. Free ranges are tracked by VMA virtual blocks.
+    struct
+    {
+        allocated_buffer_t vertex_buffer;
+        vk::DeviceAddress vertex_buffer_address;
+        VmaVirtualBlock vertex_block;
+        allocated_buffer_t index_buffer;
+        VmaVirtualBlock index_block;
+        // set if both buffers are mapped (UMA, ReBAR), meshes are then written in place instead of being staged
+        bool host_visible = false;
+    } geometry;
+
     allocated_image_t white_image;
     allocated_image_t black_image;
     allocated_image_t grey_image;
@@ -262,6 +646,12 @@ struct engine_t
 
     draw_context_t main_draw_context;
     std::unordered_map<std::string, std::shared_ptr<loaded_gltf_t>> loaded_scenes;
+    // models of `load_model_async` that are not resident yet
+    std::vector<std::shared_ptr<model_load_t>> pending_loads;
+    job_pool_t jobs;
+    // Guards the bindless slots and descriptor writes, the geometry pool blocks and `main_deletion_queue`,
+    // which `load_model_async` workers use alongside the render thread.
+    std::mutex resource_mutex;
 
     std::function<void()> define_imgui_windows = [](){};
     std::function<void()> input_handler = [](){};
@@ -279,6 +669,8 @@ struct engine_t
     bool init_vulkan(std::string app_name = "vk-app");
 
     /// Initializes the command pools and buffers for the frames and immediate submission.
+    /// Also creates the compute command pools of the frames if there is a separate compute queue
+    /// and the timestamp query pools of the frames if the graphics queue supports timestamps.
     ///
     /// Returns:
     /// * `false` - if creation of any pool or buffer failed
@@ -293,13 +685,43 @@ struct engine_t
     bool init_sync_structures();
 
     /// Initializes the global descriptor allocator and the descriptor allocators for the frames.
-    /// Also initializes the descriptors for the background pipeline and scene data.
+    /// Also initializes the descriptors for the background pipeline, scene data and bindless resources.
     ///
     /// Returns:
     /// * `false` - if creation of any allocator or allocation of any descriptor fails
     /// * `true` - if all allocators were created and no allocations failed
     bool init_descriptors();
 
+    /// Initializes the bindless descriptor set layout, pool and set as well as the material buffer.
+    /// The array sizes are clamped to the update-after-bind limits of the device.
+    /// With `descriptor_backend_e::BUFFER` the set and the per-frame rings are allocated from a descriptor buffer instead of a pool.
+    ///
+    /// Returns:
+    /// * `false` - if creation of the layout, pool, set or material buffer failed
+    /// * `true` - if the bindless descriptor set was created successfully
+    bool init_bindless_descriptors();
+
+    /// Initializes the vertex and index buffers of the geometry pool and the virtual blocks that sub-allocate them.
+    ///
+    /// Returns:
+    /// * `false` - if creation of any buffer or virtual block failed
+    /// * `true` - if the geometry pool was created successfully
+    bool init_geometry_pool();
+
+    /// Initializes the intermediate image, descriptor set layout and compute pipelines of the upscaler.
+    ///
+    /// Returns:
+    /// * `false` - if creation of the image, layout or any pipeline failed
+    /// * `true` - if the upscaler was initialized successfully
+    bool init_upscaler();
+
+    /// Initializes the compute mip generator and hands it to `uploads` if the device supports it, mip levels are blitted otherwise.
+    ///
+    /// Returns:
+    /// * `false` - if creation of the descriptor set layout or the pipeline failed
+    /// * `true` - if the mip generator was initialized or is not supported
+    bool init_mip_generator();
+
     /// Lambda function that should be set to create pipelines.
     ///
     /// Returns:
@@ -337,58 +759,228 @@ struct engine_t
     /// * `.glb`
     ///
     /// Params:
-    /// * `path` - path to the glTF file
-    /// * `name` - key to store the model under
+    /// * `path`   - path to the glTF file
+    /// * `name`   - key to store the model under
+    /// * `format` - layout the vertices are stored in on the GPU
     ///
     /// Returns:
     /// * `false` - if the model could not be loaded e.g. invalid path, buffer or texture could not be created
     /// * `true` - if the model was loaded successfully
-    bool load_model(std::string path, std::string name, std::array<std::uint32_t, 3> bindings = { 0, 1, 2 });
-    bool load_model(std::string path, std::string name, gltf_metallic_roughness_t& material, std::array<std::uint32_t, 3> bindings = { 0, 1, 2 });
+    bool load_model(std::string path, std::string name, vertex_format_e format = vertex_format_e::FLOAT);
+    bool load_model(std::string path, std::string name, gltf_metallic_roughness_t& material, vertex_format_e format = vertex_format_e::FLOAT);
+    /// Loads the glTF model at `path` on a worker and stores it in `loaded_scenes` with key `name` and `transform`
+    /// once all its meshes and textures are resident. The frame loop keeps running in the meantime, `update_model_loads` inserts the model.
+    ///
+    /// Returns:
+    /// * `std::shared_ptr<model_load_t>` - handle whose `state` tells whether the model is resident or failed to load
+    std::shared_ptr<model_load_t> load_model_async(std::string path, std::string name, vertex_format_e format = vertex_format_e::FLOAT,
+            std::vector<glm::mat4> transform = { glm::mat4(1.f) });
+    std::shared_ptr<model_load_t> load_model_async(std::string path, std::string name, gltf_metallic_roughness_t& material,
+            vertex_format_e format = vertex_format_e::FLOAT, std::vector<glm::mat4> transform = { glm::mat4(1.f) });
+    /// Inserts the models of `load_model_async` whose uploads are done into `loaded_scenes` and destroys the ones that failed.
+    /// Called by `update_scene` every frame.
+    void update_model_loads();
+    /// Points streamed textures whose uploads are done at a view of their new levels and records the uploads of finer levels
+    /// of the textures drawn last frame within `texture_stream_budget`, coarsest textures first.
+    void update_texture_streaming();
+    /// Registers a view of the levels of `texture` from `uploaded_level` on, in `pending_image` if it is set, and gives its materials
+    /// new slots that sample it. The replaced view, image and slots are retired.
+    ///
+    /// Returns:
+    /// * `false` - if the view could not be created or the bindless arrays are full, the texture keeps its current view
+    /// * `true` - if the texture and its materials use the new view
+    bool update_streamed_view(loaded_gltf_t& file, streamed_texture_t& texture);
+    /// Measures device local memory and, if it is over the residency budget, moves the least recently drawn streamed textures
+    /// back into images of their smallest levels until the evicted memory covers the overshoot. Streamed textures drawn last
+    /// frame that only have their smallest levels are moved into an image of every level if it fits into the budget.
+    void update_residency();
+    /// Registers `view` and gives `materials` new slots that sample it instead of the texture in slot `texture_index`.
+    /// The slots are replaced in the lists of `file` and the replaced ones are retired.
+    ///
+    /// Returns:
+    /// * `std::uint32_t` - slot of `view`
+    /// * `std::nullopt` - if the bindless arrays are full, the materials keep their slots
+    std::optional<std::uint32_t> replace_texture(loaded_gltf_t& file, std::uint32_t texture_index, vk::ImageView view,
+            const std::vector<std::shared_ptr<gltf_material_t>>& materials);
+    /// Runs one pass of the texture defragmentation per frame if `defrag.enabled` is set. A pass ends once the frame that recorded
+    /// its copies is done, the next one begins in the frame after. Every moved texture is created again in its new place, its
+    /// resident levels are copied in `cmd` and its materials are pointed at the copy before anything is drawn. Textures with
+    /// uploads in flight are skipped. Called by `draw` right after `cmd` began recording.
+    void update_defragmentation(vk::CommandBuffer cmd);
+    /// Ends the open pass and the defragmentation. Expects the device to be idle.
+    void end_defragmentation();
+    /// Runs `function` once every frame submitted so far and the upload of `ticket` are done, e.g. to destroy resources they
+    /// may still use.
+    void retire(std::function<void()>&& function, upload_ticket_t ticket = 0);
+    /// Runs the retired functions whose frames and uploads are done, every one of them if `all` is set.
+    void collect_retired(bool all = false);
 
     bool create_swapchain(std::uint32_t width, std::uint32_t height);
     bool resize_swapchain();
+    /// Creates `draw_image` and the TAA history at `extent`, points `draw_descriptor` at the new draw image and recreates the
+    /// transient images at the start of the next frame.
+    bool create_render_targets(vk::Extent2D extent);
+    void destroy_render_targets();
+    /// Reallocates the render targets with `RENDER_TARGET_HEADROOM` if the swapchain outgrew them or shrank below half of their
+    /// area. Expects the device to be idle.
+    ///
+    /// Returns:
+    /// * `false` - if creating the new render targets failed
+    /// * `true` - if the render targets fit the swapchain
+    bool update_render_targets();
     void destroy_swapchain();
 
-    std::optional<allocated_buffer_t> create_buffer(std::size_t alloc_size, vk::BufferUsageFlags buffer_usage, VmaMemoryUsage memory_usage);
+    /// `host_access` are `VMA_ALLOCATION_CREATE_HOST_ACCESS_*` flags. Buffers with host access are persistently mapped and coherent,
+    /// unless `VMA_ALLOCATION_CREATE_HOST_ACCESS_ALLOW_TRANSFER_INSTEAD_BIT` let VMA pick memory that is not host visible,
+    /// in which case `info.pMappedData` is null.
+    /// `shared` resources can be used by the graphics and the transfer queue without queue family ownership transfers.
+    std::optional<allocated_buffer_t> create_buffer(std::size_t alloc_size, vk::BufferUsageFlags buffer_usage, VmaAllocationCreateFlags host_access = 0,
+            bool shared = false);
     void destroy_buffer(const allocated_buffer_t& buf);
 
-    std::optional<allocated_image_t> create_image(vk::Extent3D size, vk::Format format, vk::ImageUsageFlags usage, bool mipmapped = false);
-    std::optional<allocated_image_t> create_image(void* data, vk::Extent3D size, vk::Format format, vk::ImageUsageFlags usage, bool mipmapped = false);
+    std::optional<allocated_image_t> create_image(vk::Extent3D size, vk::Format format, vk::ImageUsageFlags usage, bool mipmapped = false,
+            bool shared = false);
+    /// `movable` images are allocated from `defrag.pool` if it exists, so defragmentation may move them. They get transfer usage
+    /// for the copies of the moves.
+    std::optional<allocated_image_t> create_image(vk::Extent3D size, vk::Format format, vk::ImageUsageFlags usage, std::uint32_t mip_levels,
+            bool shared, bool movable = false);
+    /// Creates the image and fills it with `data`, tightly packed texels with 4 bytes each.
+    /// If the device can copy `format` from host memory, the texels and mip levels are copied on the calling thread and the image
+    /// can be sampled right away. Otherwise the upload is recorded into the open batch of `uploads`, staged in `group` if it is given,
+    /// and the image may only be sampled once its `ticket` is ready. Mip levels are reduced with `filter`.
+    std::optional<allocated_image_t> create_image(void* data, vk::Extent3D size, vk::Format format, vk::ImageUsageFlags usage, bool mipmapped = false,
+            upload_group_t* group = nullptr, mip_filter_e filter = mip_filter_e::AVERAGE);
+    /// Creates an image with the format and every level of `texture`, e.g. a block compressed texture with prebuilt mip levels.
+    /// Copied from host memory if the device supports it for the format, otherwise uploaded like the other `create_image` overload.
+    std::optional<allocated_image_t> create_image(const texture_data_t& texture, vk::ImageUsageFlags usage, upload_group_t* group = nullptr);
+    /// Creates an image of the levels of `texture` from `image_level` on and uploads the ones from `upload_level` on into it.
+    std::optional<allocated_image_t> create_texture_image(const texture_data_t& texture, std::uint32_t image_level, std::uint32_t upload_level,
+            vk::ImageUsageFlags usage, upload_group_t* group = nullptr);
+    /// Creates an image of the levels of `texture` up to `TEXTURE_STREAM_TAIL_SIZE` texels and uploads them.
+    /// The returned view covers those levels, `texture_index` has to be set once it is registered and the texture has to be added
+    /// to the `streamed_textures` of its file, which `update_texture_streaming` uploads the remaining levels of.
+    std::optional<streamed_texture_t> create_streamed_image(texture_data_t&& texture, vk::ImageUsageFlags usage, upload_group_t* group = nullptr);
     void destroy_image(const allocated_image_t& img);
+    /// Counts `allocation` to `category` until it is destroyed by `destroy_image`, `destroy_buffer` or `untrack_allocation`.
+    /// `name` shows up in the detailed JSON report and the leak report.
+    void track_allocation(VmaAllocation allocation, memory_category_e category, const char* name = nullptr);
+    void untrack_allocation(VmaAllocation allocation);
+    /// Heap budgets and statistics of VMA, tracked allocations per category and the memory of every loaded scene.
+    memory_report_t memory_report();
+    /// `memory_report` as JSON. If `detailed` is set, the statistics string of VMA with every allocation is added as `vma`.
+    std::string memory_report_json(bool detailed = false);
+    /// Writes `memory_report_json` to `path`.
+    ///
+    /// Returns:
+    /// * `false` - if the file could not be written
+    /// * `true` - if the report was written
+    bool dump_memory_report(const std::string& path, bool detailed = true);
+    /// Prints the allocations that are still alive, called right before the allocator is destroyed.
+    void report_leaks();
+    /// Declares `*image` as a transient image, its format and extent are set right away and the image is created at the start
+    /// of the next frame. `image` has to stay valid as long as the engine, e.g. point into a vector that is not resized.
+    void declare_transient_image(allocated_image_t* image, const transient_image_info_t& info);
+    /// Creates the declared transient images and retires the previous ones. Images are placed largest first at the lowest
+    /// offset of the shared allocation that no image with overlapping passes occupies.
+    ///
+    /// Returns:
+    /// * `false` - if creating an image or allocating the memory failed
+    /// * `true` - if every declared image was created
+    bool create_transient_images();
+    void destroy_transient_images();
+    /// Returns whether images of `format` and `usage` can be filled with `copy_image_from_host` without making device access slower.
+    bool supports_host_image_copy(vk::Format format, vk::ImageUsageFlags usage);
+    /// Copies tightly packed 4 channel 8 bit texels into the first mip level of `image` with `VK_EXT_host_image_copy` and box filters
+    /// the remaining levels on the CPU, in linear space if `filter` is `mip_filter_e::AVERAGE_SRGB`.
+    /// Leaves the image in `vk::ImageLayout::eShaderReadOnlyOptimal`.
+    /// Expects `image` to be created with `vk::ImageUsageFlagBits::eHostTransferEXT` and to not be in use.
+    ///
+    /// Returns:
+    /// * `false` - if the layout transition or a copy failed
+    /// * `true` - if every mip level of the image was written
+    bool copy_image_from_host(const allocated_image_t& image, const void* data, bool mipmapped, mip_filter_e filter = mip_filter_e::AVERAGE);
 
-    std::optional<gpu_mesh_buffer_t> upload_mesh(std::span<std::uint32_t> indicies, std::span<vertex_t> vertices);
+    /// Writes the image view into a free slot of the bindless texture array.
+    ///
+    /// Returns:
+    /// * `std::uint32_t` - index of the texture in the bindless texture array
+    /// * `std::nullopt` - if the texture array is full
+    std::optional<std::uint32_t> register_texture(vk::ImageView view);
+    /// Writes the sampler into a free slot of the bindless sampler array.
+    ///
+    /// Returns:
+    /// * `std::uint32_t` - index of the sampler in the bindless sampler array
+    /// * `std::nullopt` - if the sampler array is full
+    std::optional<std::uint32_t> register_sampler(vk::Sampler sampler);
+    /// Copies the material constants into a free slot of the bindless material buffer.
+    ///
+    /// Returns:
+    /// * `std::uint32_t` - index of the material in the material buffer
+    /// * `std::nullopt` - if the material buffer is full
+    std::optional<std::uint32_t> register_material(const gltf_metallic_roughness_t::material_constants_t& constants);
+    void release_texture(std::uint32_t index);
+    void release_sampler(std::uint32_t index);
+    void release_material(std::uint32_t index);
+
+    /// Uploads the mesh into ranges of the geometry pool. The vertices are converted into `format` before the upload.
+    /// Indices are stored as 16 bit if every vertex can be addressed with them.
+    /// If the geometry pool is host visible the mesh is written in place and ready right away. Otherwise the copies are recorded
+    /// into the open batch of `uploads` and staged in `group` if it is given, the mesh may only be drawn once its `ticket` is ready.
+    ///
+    /// Returns:
+    /// * `gpu_mesh_buffer_t` - ranges, vertex format and dequantisation transform of the mesh
+    /// * `std::nullopt` - if the geometry pool is full or the upload could not be recorded
+    std::optional<gpu_mesh_buffer_t> upload_mesh(std::span<std::uint32_t> indicies, std::span<vertex_t> vertices,
+            vertex_format_e format = vertex_format_e::FLOAT, upload_group_t* group = nullptr);
+    /// Returns the ranges of the mesh to the geometry pool once the frames in flight and the upload of the mesh are done.
+    void release_mesh(const gpu_mesh_buffer_t& mesh);
 
     frame_data_t& get_current_frame();
 
     void update_scene();
+    /// Stores the unjittered and previous view projection for motion vectors and offsets the projection by the next sub-pixel jitter
+    /// if the temporal upscaler is used. Expects `update` to rewrite `proj` and `viewproj` every frame.
+    void jitter_projection();
 
     // TODO: Seperating compute and geometry into only two functions might not be a good idea.
     //       See deferred shading, shadow mapping etc.
     void draw_geometry(vk::CommandBuffer cmd, std::vector<vk::RenderingAttachmentInfo> color_attachments, vk::RenderingAttachmentInfo depth_attachment);
     void draw_background(vk::CommandBuffer cmd);
     void draw_imgui(vk::CommandBuffer cmd, vk::ImageView target_image_view);
+    /// ImGui window of the cached `memory_report` and the heap budgets, shown with the stats.
+    void draw_memory_window();
+    /// Upscales the `draw_extent` region of `draw_image` to the swapchain image. `draw_image` has to be in `vk::ImageLayout::eColorAttachmentOptimal`,
+    /// as does `upscaler.motion_image` if `upscaler.motion_written` is set.
+    ///
+    /// Returns:
+    /// * `vk::ImageLayout` - layout the swapchain image was left in
+    vk::ImageLayout draw_upscale(vk::CommandBuffer cmd, std::uint32_t swapchain_img_idx);
 
-    std::function<vk::ImageLayout(vk::CommandBuffer cmd, std::uint32_t swapchain_img_idx)> draw_cmd = [this](vk::CommandBuffer cmd, std::uint32_t swapchain_img_idx) -> vk::ImageLayout
+    /// Compute work of the frame that can run on the compute queue. Recorded into the graphics command buffer by `draw_cmd`
+    /// if `compute_submitted` is not set. Resources used by both queues have to be created with concurrent sharing.
+    std::function<void(vk::CommandBuffer cmd)> compute_cmd = [this](vk::CommandBuffer cmd)
     {
         vkutil::transition_image(cmd, this->draw_image.image, vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral);
-
         this->draw_background(cmd);
-
         vkutil::transition_image(cmd, this->draw_image.image, vk::ImageLayout::eGeneral, vk::ImageLayout::eColorAttachmentOptimal);
+    };
+
+    std::function<vk::ImageLayout(vk::CommandBuffer cmd, std::uint32_t swapchain_img_idx)> draw_cmd = [this](vk::CommandBuffer cmd, std::uint32_t swapchain_img_idx) -> vk::ImageLayout
+    {
+        if (!this->compute_submitted) this->compute_cmd(cmd);
         vkutil::transition_image(cmd, this->depth_image.image, vk::ImageLayout::eUndefined, vk::ImageLayout::eDepthAttachmentOptimal);
+        vkutil::transition_image(cmd, this->upscaler.motion_image.image, vk::ImageLayout::eUndefined, vk::ImageLayout::eColorAttachmentOptimal);
 
         vk::ClearValue clear_value;
         clear_value.depthStencil.depth = 1.f;
-        this->draw_geometry(cmd, { vk::RenderingAttachmentInfo(this->draw_image.view, vk::ImageLayout::eColorAttachmentOptimal) },
+        this->draw_geometry(cmd, { vk::RenderingAttachmentInfo(this->draw_image.view, vk::ImageLayout::eColorAttachmentOptimal),
+                    vk::RenderingAttachmentInfo(this->upscaler.motion_image.view, vk::ImageLayout::eColorAttachmentOptimal, {}, {}, {},
+                        vk::AttachmentLoadOp::eClear, vk::AttachmentStoreOp::eStore, vk::ClearValue(vk::ClearColorValue(std::array<float, 4>{0}))) },
                 vk::RenderingAttachmentInfo(this->depth_image.view, vk::ImageLayout::eDepthAttachmentOptimal, {}, {}, {},
-                    vk::AttachmentLoadOp::eClear, vk::AttachmentStoreOp::eStore, clear_value));
-
-        vkutil::transition_image(cmd, this->draw_image.image, vk::ImageLayout::eColorAttachmentOptimal, vk::ImageLayout::eTransferSrcOptimal);
-        vkutil::transition_image(cmd, this->swapchain.images[swapchain_img_idx], vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal);
+                    vk::AttachmentLoadOp::eClear, vk::AttachmentStoreOp::eDontCare, clear_value));
+        this->upscaler.motion_written = true;
 
-        vkutil::copy_image_to_image(cmd, this->draw_image.image, this->swapchain.images[swapchain_img_idx], this->draw_extent, this->swapchain.extent);
-        return vk::ImageLayout::eTransferDstOptimal;
+        return this->draw_upscale(cmd, swapchain_img_idx);
     };
 
     bool draw();
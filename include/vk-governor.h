@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A setting the governor scales with the current quality level.
+// The value is interpolated between `low` at quality 0 and `high` at quality 1, so `low` may be larger than `high`
+// e.g. for a LOD bias where larger values are cheaper.
+struct quality_knob_t
+{
+    std::string name;
+    float* value;
+    float low;
+    float high;
+};
+
+// Drives the registered knobs so the GPU frame time converges on `target_frame_time`.
+// The measured frame time is smoothed exponentially. Quality is only changed while the smoothed frame time lies outside of
+// the band `[target * (1 - lower_margin), target * (1 + upper_margin)]` and not more often than every `cooldown_frames` frames,
+// since the effect of a change is only measured once the frames in flight have retired.
+struct quality_governor_t
+{
+    bool enabled = false;
+    // milliseconds
+    float target_frame_time = 1000.f / 60.f;
+    float upper_margin = .05f;
+    float lower_margin = .15f;
+    // fraction of the frame time error that is applied to the quality level per adjustment
+    float gain = .25f;
+    float max_step = .05f;
+    std::uint32_t cooldown_frames = 4;
+    float smoothing = .1f;
+
+    float quality = 1.f;
+    float smoothed_frame_time = 0.f;
+    std::uint32_t frames_since_change = 0;
+
+    std::vector<quality_knob_t> knobs;
+
+    /// Registers a knob and sets it to the value of the current quality level.
+    ///
+    /// Params:
+    /// * `name`  - name shown in the stats window
+    /// * `value` - setting to drive, has to outlive the governor
+    /// * `low`   - value at the lowest quality
+    /// * `high`  - value at the highest quality
+    void register_knob(std::string name, float* value, float low, float high);
+    void remove_knob(const float* value);
+
+    /// Feeds the GPU time of a finished frame into the governor and updates the knobs if the quality level changed.
+    ///
+    /// Returns:
+    /// * `true` - if the quality level changed
+    /// * `false` - if the governor is disabled or the frame time is within the hysteresis band
+    bool update(float gpu_frame_time);
+    void apply_knobs();
+};
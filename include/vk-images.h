@@ -1,9 +1,21 @@
 #pragma once
 
+#include <cstdint>
+#include <vector>
 #include <vulkan/vulkan.hpp>
 
 namespace vkutil {
-    void transition_image(vk::CommandBuffer cmd, vk::Image img, vk::ImageLayout current, vk::ImageLayout target);
+    /// Transitions the mip levels [`base_level`, `base_level + level_count`) of `img`, every level by default.
+    void transition_image(vk::CommandBuffer cmd, vk::Image img, vk::ImageLayout current, vk::ImageLayout target, std::uint32_t base_level = 0,
+            std::uint32_t level_count = VK_REMAINING_MIP_LEVELS);
     void copy_image_to_image(vk::CommandBuffer cmd, vk::Image src, vk::Image dst, vk::Extent2D src_size, vk::Extent2D dst_size);
+    /// Number of mip levels of a full mip chain down to 1x1 texels.
+    std::uint32_t mip_level_count(vk::Extent2D size);
+    /// Blits every mip level from the one above, expects the image in `vk::ImageLayout::eTransferDstOptimal`
+    /// and leaves it in `vk::ImageLayout::eShaderReadOnlyOptimal`. See `mip_generator_t` for the compute shader variant.
     void generate_mipmaps(vk::CommandBuffer cmd, vk::Image image, vk::Extent2D image_size);
+    /// Box filters tightly packed 4 channel 8 bit texels into the next mip level, whose size is half of `size` but at least 1.
+    /// Odd rows and columns are folded into the last texel of the next level.
+    /// If `srgb` is set, the color channels are averaged in linear space and encoded again.
+    std::vector<std::uint8_t> downsample_rgba8(const std::uint8_t* texels, vk::Extent2D size, bool srgb = false);
 };
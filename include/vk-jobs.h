@@ -0,0 +1,32 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads that run jobs in submission order.
+// Jobs must not submit to Vulkan queues, those are only used by the render thread.
+struct job_pool_t
+{
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping = false;
+
+    /// Params:
+    /// * `thread_count` - number of workers, if 0 one less than the hardware threads so the render thread keeps its core
+    void init(std::uint32_t thread_count = 0);
+    /// Discards the jobs that have not started yet and joins the workers once their current jobs are done.
+    void destroy();
+    void submit(std::function<void()>&& job);
+    /// Calls `function` for every index in `[0, count)` on the workers and the calling thread and returns once all calls are done.
+    /// The calling thread takes indices itself, so this makes progress even if it is called from a job while every worker is busy.
+    void parallel_for(std::size_t count, const std::function<void(std::size_t)>& function);
+
+    void work();
+};
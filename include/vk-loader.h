@@ -2,6 +2,7 @@
 
 #include <vk-types.h>
 #include <vk-descriptors.h>
+#include <vk-textures.h>
 #include <optional>
 #include <memory>
 #include <unordered_map>
@@ -33,6 +34,36 @@ struct mesh_asset_t
     gpu_mesh_buffer_t mesh_buffer;
 };
 
+// Texture whose mip levels become resident from the smallest to the largest, see `engine_t::update_texture_streaming`.
+// The bindless slot holds a view of the resident levels only, so samplers never reach a level that is still being copied.
+//
+// Textures start out in an image of their levels up to `TEXTURE_STREAM_TAIL_SIZE` texels. Once they are drawn, they are moved
+// into an image of every level and the finer levels are streamed in. Textures that have not been drawn for a while are
+// moved back into an image of the small levels if device memory runs over budget.
+struct streamed_texture_t
+{
+    // image the view samples, holds the levels of `texture` from `image_level` on
+    allocated_image_t image;
+    std::uint32_t image_level;
+    // Replaces `image` once `ticket` is ready, holds the levels from `pending_level` on.
+    std::optional<allocated_image_t> pending_image;
+    std::uint32_t pending_level = 0;
+    // kept on the CPU so levels can be uploaded again after they were evicted
+    texture_data_t texture;
+    vk::ImageView view;
+    std::uint32_t texture_index;
+    // first level `view` covers
+    std::uint32_t resident_level;
+    // first level whose upload has been recorded, resident once `ticket` is ready
+    std::uint32_t uploaded_level;
+    upload_ticket_t ticket = 0;
+    // materials that sample the texture, they are pointed at every new view
+    std::vector<std::shared_ptr<gltf_material_t>> materials;
+
+    /// Frame the texture was last drawn in, according to its materials.
+    std::uint64_t last_used_frame() const;
+};
+
 struct engine_t;
 struct gltf_metallic_roughness_t;
 
@@ -40,15 +71,23 @@ struct loaded_gltf_t : public renderable_i
 {
     std::unordered_map<std::string, std::shared_ptr<mesh_asset_t>> meshes;
     std::unordered_map<std::string, std::shared_ptr<node_t>> nodes;
+    // images that are not streamed, those are owned by `streamed_textures`
     std::unordered_map<std::string, allocated_image_t> images;
+    // bindless slot of each of `images`
+    std::unordered_map<std::string, std::uint32_t> image_texture_indices;
     std::unordered_map<std::string, std::shared_ptr<gltf_material_t>> materials;
 
     std::vector<std::shared_ptr<node_t>> top_nodes;
     std::vector<vk::Sampler> samplers;
 
-    descriptor_allocator_growable_t descriptor_pool;
-    allocated_buffer_t material_data_buffer;
+    // slots in the bindless descriptor set owned by this file
+    std::vector<std::uint32_t> texture_indices;
+    std::vector<std::uint32_t> sampler_indices;
+    std::vector<std::uint32_t> material_indices;
+    std::vector<streamed_texture_t> streamed_textures;
     engine_t* creator;
+    // last upload of the file, its meshes and textures are resident once it is ready
+    upload_ticket_t ticket = 0;
 
     std::vector<glm::mat4> transform = {};
 
@@ -60,4 +99,12 @@ struct loaded_gltf_t : public renderable_i
 };
 
 std::optional<std::shared_ptr<loaded_gltf_t>> load_gltf(engine_t* engine, std::string_view filepath, gltf_metallic_roughness_t& material,
-        std::array<std::uint32_t, 3> bindings = { 0, 1, 2 });
+        vertex_format_e format = vertex_format_e::FLOAT);
+/// Loads the glTF file at `filepath` into `file`, whose `creator` has to be set. Uploads are recorded but not submitted,
+/// so this may run on a worker thread.
+///
+/// Returns:
+/// * `false` - if loading failed, `file` keeps what was created so far and has to be destroyed on the render thread
+/// * `true` - if the file was loaded, it can be drawn once `file.ticket` is ready
+bool load_gltf(engine_t* engine, loaded_gltf_t& file, std::string_view filepath, gltf_metallic_roughness_t& material,
+        vertex_format_e format = vertex_format_e::FLOAT);
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+#include <vk-types.h>
+
+// Size of the simulated post-transform vertex cache used for optimisation and analysis.
+constexpr std::uint32_t VERTEX_CACHE_SIZE = 16;
+
+struct vertex_cache_stats_t
+{
+    std::size_t triangle_count = 0;
+    std::size_t vertex_count = 0;
+    std::size_t miss_count = 0;
+
+    // average cache miss ratio: transformed vertices per triangle, 0.5 is optimal
+    float acmr() const;
+    // average transform to vertex ratio: transformed vertices per vertex, 1 is optimal
+    float atvr() const;
+    vertex_cache_stats_t& operator+=(const vertex_cache_stats_t& other);
+};
+
+namespace vkutil {
+    std::size_t vertex_stride(vertex_format_e format);
+
+    /// Converts the vertices into the layout of the given vertex format.
+    ///
+    /// Params:
+    /// * `vertices`        - vertices to convert
+    /// * `format`          - target vertex format
+    /// * `position_offset` - set to the dequantisation offset of the mesh if the format is `vertex_format_e::QUANTIZED`
+    /// * `position_scale`  - set to the dequantisation scale of the mesh if the format is `vertex_format_e::QUANTIZED`
+    ///
+    /// Returns:
+    /// * `std::vector<std::byte>` - tightly packed vertices with a stride of `vertex_stride(format)`
+    std::vector<std::byte> pack_vertices(std::span<const vertex_t> vertices, vertex_format_e format, glm::vec3& position_offset, glm::vec3& position_scale);
+
+    std::uint32_t encode_octahedral(glm::vec3 normal);
+
+    /// Simulates a FIFO post-transform vertex cache for the given triangle list.
+    vertex_cache_stats_t analyze_vertex_cache(std::span<const std::uint32_t> indices, std::size_t vertex_count,
+            std::uint32_t cache_size = VERTEX_CACHE_SIZE);
+
+    /// Merges bitwise identical vertices and remaps the indices.
+    ///
+    /// Returns:
+    /// * `std::size_t` - number of removed vertices
+    std::size_t weld_vertices(std::vector<std::uint32_t>& indices, std::vector<vertex_t>& vertices);
+
+    /// Reorders the triangles for post-transform vertex cache locality (Tipsify).
+    ///
+    /// Returns:
+    /// * `std::vector<std::size_t>` - first triangle of every cluster, clusters start where the reordering hit a dead end
+    std::vector<std::size_t> optimize_vertex_cache(std::vector<std::uint32_t>& indices, std::size_t vertex_count,
+            std::uint32_t cache_size = VERTEX_CACHE_SIZE);
+
+    /// Reorders the clusters returned by `optimize_vertex_cache` so outward facing clusters are drawn first.
+    void optimize_overdraw(std::vector<std::uint32_t>& indices, std::span<const vertex_t> vertices, std::span<const std::size_t> clusters);
+
+    /// Reorders the vertices in the order they are first referenced by the indices. Unreferenced vertices are removed.
+    void optimize_vertex_fetch(std::vector<std::uint32_t>& indices, std::vector<vertex_t>& vertices);
+
+    /// Runs all of the above optimisations on a triangle list.
+    void optimize_mesh(std::vector<std::uint32_t>& indices, std::vector<vertex_t>& vertices);
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.hpp>
+#include <vk-types.h>
+
+// levels the downsampler writes per dispatch, limited by the 64x64 texels a workgroup reduces
+constexpr std::uint32_t MIP_LEVELS_PER_PASS = 6;
+
+// How 2x2 texels are reduced into one texel of the next mip level.
+// `AVERAGE_SRGB` averages sRGB encoded colors in linear space. `MIN` and `MAX` build depth pyramids, e.g. for occlusion culling.
+enum struct mip_filter_e : std::uint32_t
+{
+    AVERAGE,
+    AVERAGE_SRGB,
+    MIN,
+    MAX
+};
+
+struct mip_push_constants_t
+{
+    glm::ivec2 source_extent;
+    std::int32_t base_level;
+    std::int32_t level_count;
+    mip_filter_e filter;
+};
+
+// Generates mip levels with a compute shader instead of blitting every level.
+//
+// Each dispatch reduces 64x64 texels of one level per workgroup into up to `MIP_LEVELS_PER_PASS` levels, so an image needs a
+// single dispatch up to 64x64 texels and two up to 4096x4096 texels, each pass waiting only on the one before it.
+// Levels that follow an odd sized level start a new pass, so images without a power of two size need more of them.
+// The last texel of an odd dimension covers 3 texels of the level above, so no texel is dropped.
+//
+// Requires push descriptors and storage image writes without a format. The image needs storage and sampled usage and a format
+// storage images support, sRGB formats have to be stored as UNORM and filtered with `mip_filter_e::AVERAGE_SRGB`.
+struct mip_generator_t
+{
+    vk::Device device;
+    const vk::DispatchLoaderDynamic* dispatch = nullptr;
+    vk::DescriptorSetLayout layout;
+    vk::PipelineLayout pipeline_layout;
+    vk::Pipeline pipeline;
+
+    /// Params:
+    /// * `shader_path` - path of the compiled downsampling shader, the variant without quad subgroup operations has to be used
+    ///                   if compute shaders do not support them
+    ///
+    /// Returns:
+    /// * `false` - if creation of the descriptor set layout or the pipeline failed, the created objects can be destroyed with `destroy`
+    /// * `true` - if the mip generator was initialized successfully
+    bool init(vk::Device device, const vk::DispatchLoaderDynamic& dispatch, const std::string& shader_path);
+    void destroy();
+
+    /// Records the generation of mip levels `[1, mip_levels)` of `image` from its first level. Expects every level to be in
+    /// `vk::ImageLayout::eGeneral` and leaves them in it, the caller has to synchronize later reads.
+    /// The views of single levels are appended to `views` and have to be destroyed once the commands are done, even if this fails.
+    ///
+    /// Returns:
+    /// * `false` - if creating a view failed, nothing was recorded
+    /// * `true` - if the mip levels were recorded
+    bool generate(vk::CommandBuffer cmd, const allocated_image_t& image, std::uint32_t mip_levels, mip_filter_e filter,
+            std::vector<vk::ImageView>& views);
+};
@@ -22,11 +22,15 @@ struct pipeline_builder_t
     vk::Format                                       color_attachment_format;
     std::vector<vk::VertexInputAttributeDescription> vertex_input_attribute_descriptions;
     std::vector<vk::VertexInputBindingDescription>   vertex_input_binding_descriptions;
+    vk::PipelineCreateFlags                          flags;
+    // color attachments that keep their contents regardless of the blend state
+    std::vector<std::uint32_t>                       write_disabled_attachments;
 
     pipeline_builder_t();
 
     void clear();
     pipeline_builder_t& set_shaders(const vk::ShaderModule vertex_shader, const vk::ShaderModule fragment_shader);
+    pipeline_builder_t& set_vertex_shader(const vk::ShaderModule vertex_shader);
     pipeline_builder_t& set_input_topology(const vk::PrimitiveTopology topology);
     pipeline_builder_t& set_polygon_mode(const vk::PolygonMode mode);
     pipeline_builder_t& set_cull_mode(const vk::CullModeFlags cull_mode, const vk::FrontFace front_face);
@@ -34,6 +38,7 @@ struct pipeline_builder_t
     pipeline_builder_t& disable_blending();
     pipeline_builder_t& enable_blending_additive();
     pipeline_builder_t& enable_blending_alphablend();
+    pipeline_builder_t& disable_color_write(std::uint32_t attachment);
     pipeline_builder_t& set_color_attachment_format(const vk::Format format);
     pipeline_builder_t& set_color_attachment_count(const std::size_t count, const std::vector<vk::Format>& formats);
     pipeline_builder_t& set_depth_format(const vk::Format format);
@@ -41,5 +46,6 @@ struct pipeline_builder_t
     pipeline_builder_t& enable_depthtest(const bool depth_write_enable, const vk::CompareOp op);
     pipeline_builder_t& add_vertex_input_binding(std::uint32_t binding, std::size_t stride, vk::VertexInputRate input_rate);
     pipeline_builder_t& add_vertex_input_attribute(std::uint32_t binding, std::uint32_t location, vk::Format format, std::size_t offset);
+    pipeline_builder_t& set_flags(const vk::PipelineCreateFlags flags);
     std::optional<vk::Pipeline> build(vk::Device dev);
 };
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+struct job_pool_t;
+
+struct texture_level_t
+{
+    // offset of the level in `texture_data_t::data`
+    vk::DeviceSize offset;
+    vk::DeviceSize size;
+    vk::Extent3D extent;
+};
+
+// Texels of every mip level of a texture, ready to be copied into an image of `format`.
+// The levels are tightly packed back to back, starting with the largest one.
+struct texture_data_t
+{
+    vk::Format format;
+    vk::Extent3D extent;
+    std::vector<texture_level_t> levels;
+    std::vector<std::uint8_t> data;
+};
+
+namespace vkutil {
+    /// Bytes of a 4x4 block of a block compressed format.
+    ///
+    /// Returns:
+    /// * `0` - if `format` is not one of the BC1, BC3, BC4, BC5 or BC7 formats
+    std::uint32_t bc_block_size(vk::Format format);
+
+    bool is_ktx2(std::span<const std::uint8_t> bytes);
+    /// Reads a 2D KTX2 texture with a BC1, BC3, BC4, BC5 or BC7 payload and the mip levels it contains.
+    /// sRGB formats are returned as their UNORM counterpart, so they are sampled like every other texture.
+    ///
+    /// Returns:
+    /// * `texture_data_t` - levels of the texture
+    /// * `std::nullopt` - if the file is malformed, supercompressed, not 2D or of another format
+    std::optional<texture_data_t> load_ktx2(std::span<const std::uint8_t> bytes);
+
+    /// Encodes tightly packed 4 channel 8 bit texels into 4x4 blocks of `format`, which has to be the UNORM variant of BC1, BC3,
+    /// BC4 or BC5. BC4 takes the red channel and BC5 the red and green channels. Rows of blocks are encoded on `jobs` if it is given.
+    std::vector<std::uint8_t> encode_bc(const std::uint8_t* texels, vk::Extent2D size, vk::Format format, job_pool_t* jobs = nullptr);
+    /// Builds the full mip chain of tightly packed 4 channel 8 bit texels and encodes every level to BC1, or to BC3 if any texel
+    /// is not opaque. If `srgb` is set, the mip levels are averaged in linear space.
+    texture_data_t compress_texture(const std::uint8_t* texels, vk::Extent2D size, bool srgb, job_pool_t* jobs = nullptr);
+    /// Builds the full mip chain of tightly packed 4 channel 8 bit texels as `vk::Format::eR8G8B8A8Unorm` levels.
+    /// If `srgb` is set, the mip levels are averaged in linear space.
+    texture_data_t build_mip_chain(const std::uint8_t* texels, vk::Extent2D size, bool srgb);
+    /// Returns the first level of `texture` that is at most `max_size` texels wide and high, or its last level if none is.
+    std::uint32_t first_level_within(const texture_data_t& texture, std::uint32_t max_size);
+
+    /// 64 bit FNV-1a hash of `bytes`, starting from `seed`.
+    std::uint64_t hash_bytes(std::span<const std::uint8_t> bytes, std::uint64_t seed = 14695981039346656037ull);
+    /// Returns:
+    /// * `texture_data_t` - texture written by `write_texture_cache`
+    /// * `std::nullopt` - if the file does not exist or is not a valid cache file
+    std::optional<texture_data_t> read_texture_cache(const std::string& path);
+    /// Writes `texture` to `path`, creating its directory if needed. The file is written under a temporary name and renamed,
+    /// so concurrent readers never see a partial file.
+    ///
+    /// Returns:
+    /// * `false` - if the file could not be written
+    /// * `true` - if the texture was cached
+    bool write_texture_cache(const std::string& path, const texture_data_t& texture);
+};
@@ -5,6 +5,9 @@
 #include <vulkan/vulkan.hpp>
 #include <vk_mem_alloc.h>
 
+// Value of the upload timeline the contents of a resource are ready at, see `upload_manager_t`. 0 if the resource was not uploaded.
+using upload_ticket_t = std::uint64_t;
+
 struct allocated_image_t
 {
     vk::Image image;
@@ -12,6 +15,11 @@ struct allocated_image_t
     VmaAllocation allocation;
     vk::Extent3D extent;
     vk::Format format;
+    upload_ticket_t ticket = 0;
+    // parameters the image was created with, to create it again when defragmentation moves its memory
+    std::uint32_t mip_levels = 1;
+    vk::ImageUsageFlags usage;
+    bool shared = false;
 };
 
 struct allocated_buffer_t
@@ -29,22 +37,79 @@ struct vertex_t
     alignas(16) glm::vec4 color;
 };
 
+// Layout of the vertices in the vertex buffer of a mesh. Has to match the VERTEX_FORMAT_* constants in `input_structures.glsl`.
+enum struct vertex_format_e : std::uint32_t
+{
+    // `vertex_t`
+    FLOAT = 0,
+    // `packed_vertex_t`
+    PACKED = 1,
+    // `quantized_vertex_t`
+    QUANTIZED = 2
+};
+
+// size: 24 bytes
+struct packed_vertex_t
+{
+    glm::vec3 position;
+    // octahedral encoded, snorm16x2
+    std::uint32_t normal;
+    // half2
+    std::uint32_t uv;
+    // unorm8x4
+    std::uint32_t color;
+};
+
+// size: 20 bytes
+struct quantized_vertex_t
+{
+    // unorm16x3 relative to the bounds of the mesh, position = offset + position * scale
+    std::uint16_t position[4];
+    // octahedral encoded, snorm16x2
+    std::uint32_t normal;
+    // half2
+    std::uint32_t uv;
+    // unorm8x4
+    std::uint32_t color;
+};
+
+// Ranges of a mesh in the geometry pool of the engine.
 struct gpu_mesh_buffer_t
 {
-    allocated_buffer_t index_buffer;
-    allocated_buffer_t vertex_buffer;
+    VmaVirtualAllocation vertex_allocation = VK_NULL_HANDLE;
+    VmaVirtualAllocation index_allocation = VK_NULL_HANDLE;
+    // index buffer of the geometry pool
+    vk::Buffer index_buffer;
     vk::DeviceAddress vertex_buffer_address;
+    // offset of the mesh into the index buffer in units of `index_type`
+    std::uint32_t first_index = 0;
+    // 16 bit if all vertices of the mesh can be addressed with it
+    vk::IndexType index_type = vk::IndexType::eUint32;
+
+    vertex_format_e vertex_format = vertex_format_e::FLOAT;
+    // dequantisation transform, only used with `vertex_format_e::QUANTIZED`
+    glm::vec3 position_offset = glm::vec3(0.f);
+    glm::vec3 position_scale = glm::vec3(1.f);
+
+    upload_ticket_t ticket = 0;
 };
 
+// size: 112 bytes
 struct gpu_draw_push_constants_t
 {
     glm::mat4 world;
     vk::DeviceAddress vertex_buffer;
+    std::uint32_t material_index;
+    vertex_format_e vertex_format;
+    glm::vec4 position_offset;
+    glm::vec4 position_scale;
 };
 
 enum struct material_pass_e : std::uint8_t
 {
     MAIN_COLOR,
+    // opaque with alpha testing
+    MASKED,
     TRANSPARENT,
     OTHER
 };
@@ -53,13 +118,22 @@ struct material_pipeline_t
 {
     vk::Pipeline pipeline;
     vk::PipelineLayout layout;
+    // Variants for the depth pre-pass. `depth_pipeline` only writes depth and `equal_pipeline` is used by the main pass afterwards
+    // (eEqual, no depth writes). Both are null if the pipeline does not take part in the pre-pass.
+    vk::Pipeline depth_pipeline;
+    vk::Pipeline equal_pipeline;
 };
 
 struct material_instance_t
 {
     material_pipeline_t* pipeline;
-    vk::DescriptorSet material_set;
+    // index into the material buffer of the bindless descriptor set
+    std::uint32_t material_index;
     material_pass_e pass_type;
+    // upload of the textures the material samples
+    upload_ticket_t ticket = 0;
+    // `engine_t::frame_count` of the last frame a surface with this material was drawn in
+    std::uint64_t last_used_frame = 0;
 };
 
 struct draw_context_t;
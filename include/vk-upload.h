@@ -0,0 +1,195 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <vk_mem_alloc.h>
+#include <vk-types.h>
+#include <vk-mips.h>
+#include <vk-textures.h>
+
+constexpr vk::DeviceSize UPLOAD_RING_SIZE = 64 * 1024 * 1024;
+// NOTE: 16 bytes satisfy the offset alignment of buffer copies and of image copies for every uncompressed and block compressed format.
+constexpr vk::DeviceSize UPLOAD_STAGING_ALIGNMENT = 16;
+
+// Uploads that are submitted together. Batch `k` is done once the timeline reaches its ticket `2k`.
+struct upload_batch_t
+{
+    vk::CommandPool pool;
+    vk::CommandBuffer cmd;
+    // Only used if the transfer queue is not the graphics queue, for work transfer queues can not do e.g. blitting mip levels.
+    vk::CommandPool graphics_pool;
+    vk::CommandBuffer graphics_cmd;
+    bool graphics_recorded = false;
+
+    upload_ticket_t ticket = 0;
+    // position of the staging ring after the last upload of the batch, becomes free once the batch is done
+    std::uint64_t ring_end = 0;
+    // staging buffers of uploads that do not fit into the ring
+    std::vector<allocated_buffer_t> dedicated_buffers;
+    // views of single mip levels written by the mip generator
+    std::vector<vk::ImageView> views;
+};
+
+// Contiguous range of mapped staging memory. Groups reserve one range for many uploads, e.g. every mesh and texture of a glTF file,
+// so they are staged without going back to the ring for each of them.
+struct upload_group_t
+{
+    vk::Buffer buffer;
+    std::uint8_t* data = nullptr;
+    // offset of the range in `buffer`
+    vk::DeviceSize offset = 0;
+    vk::DeviceSize size = 0;
+    // bytes of the range already handed out to uploads
+    vk::DeviceSize used = 0;
+};
+
+// Copies data into device local buffers and images on the transfer queue without waiting for the copies.
+//
+// Uploads are staged in a persistently mapped ring buffer and recorded into the open batch, which is submitted by `flush`.
+// Every upload returns the ticket of its batch, the resource may be used once `is_ready` returns true for it.
+// The queues that use the resources have to wait on `timeline` with a value of at least `completed`, which never blocks
+// since the value has already been reached, but makes the copies visible to them.
+//
+// Batch `k` signals `2k - 1` on the transfer queue and `2k` once its graphics work is done. Batches without graphics work
+// signal `2k` right away. Each batch waits for `2k - 2`, so the values are always signaled in order.
+//
+// If the ring is full, uploads get a dedicated staging buffer instead of waiting for older batches.
+// Uploads between `begin_group` and `end_group` are staged in the range reserved by the group and all end up in the same batch.
+// Uploads can be recorded from any thread. `flush`, and `wait` for a ticket that has not been submitted yet, have to be called
+// from the thread that submits to the queues.
+struct upload_manager_t
+{
+    vk::Device device;
+    VmaAllocator allocator;
+    vk::Queue queue;
+    std::uint32_t family_index;
+    vk::Queue graphics_queue;
+    std::uint32_t graphics_family_index;
+
+    vk::Semaphore timeline;
+    // highest ticket that has been observed as done, updated by `collect`
+    std::atomic<upload_ticket_t> completed = 0;
+    upload_ticket_t last_submitted = 0;
+
+    allocated_buffer_t staging;
+    vk::DeviceSize ring_size = 0;
+    // Monotonic byte positions, the offset into the ring is `position % ring_size`.
+    std::uint64_t ring_head = 0;
+    std::uint64_t ring_tail = 0;
+
+    std::optional<upload_batch_t> open_batch;
+    std::deque<upload_batch_t> in_flight;
+    std::vector<upload_batch_t> free_batches;
+    // the open batch is not submitted while groups are recording into it
+    std::uint32_t open_groups = 0;
+    // Generates mip levels with a compute shader if set, mipmapped images then need storage usage. Levels are blitted otherwise.
+    mip_generator_t* mips = nullptr;
+    // guards everything but `completed`
+    std::mutex mutex;
+
+    /// Params:
+    /// * `queue`          - transfer queue the copies are submitted to, may be the graphics queue
+    /// * `graphics_queue` - queue mip levels are generated on
+    /// * `ring_size`      - size of the staging ring, larger uploads get a dedicated staging buffer
+    ///
+    /// Returns:
+    /// * `false` - if creation of the timeline semaphore or the staging ring failed
+    /// * `true` - if the upload manager was initialized successfully
+    bool init(vk::Device device, VmaAllocator allocator, vk::Queue queue, std::uint32_t family_index, vk::Queue graphics_queue,
+            std::uint32_t graphics_family_index, vk::DeviceSize ring_size = UPLOAD_RING_SIZE);
+    /// Expects the queues to be idle.
+    void destroy();
+
+    /// Copies `size` bytes of `data` to `offset` in `dst`. The data is staged in the range of `group` if it still fits into it.
+    ///
+    /// Returns:
+    /// * `upload_ticket_t` - ticket of the batch the copy was recorded into
+    /// * `std::nullopt` - if staging memory could not be allocated or recording failed
+    std::optional<upload_ticket_t> upload_buffer(vk::Buffer dst, vk::DeviceSize offset, const void* data, vk::DeviceSize size,
+            upload_group_t* group = nullptr);
+    /// Copies tightly packed texels of the first mip level into `image` and leaves it in `vk::ImageLayout::eShaderReadOnlyOptimal`.
+    /// The remaining mip levels are generated on the graphics queue with `filter` if `mipmapped` is set.
+    /// The texels are staged in the range of `group` if they still fit into it.
+    ///
+    /// Returns:
+    /// * `upload_ticket_t` - ticket of the batch the copy was recorded into
+    /// * `std::nullopt` - if staging memory could not be allocated or recording failed
+    std::optional<upload_ticket_t> upload_image(const allocated_image_t& image, const void* data, vk::DeviceSize size, bool mipmapped,
+            upload_group_t* group = nullptr, mip_filter_e filter = mip_filter_e::AVERAGE);
+    /// Copies the levels [`first_level`, `first_level + level_count`) of `texture`, every level by default, into the mip levels
+    /// of `image` and leaves them in `vk::ImageLayout::eShaderReadOnlyOptimal`. Mip level 0 of `image` holds level `image_level`
+    /// of `texture`. The other levels are not touched, so they may be sampled meanwhile. No mip levels are generated, so no
+    /// graphics work is recorded. The levels are staged in one range, in the range of `group` if they still fit into it.
+    ///
+    /// Returns:
+    /// * `upload_ticket_t` - ticket of the batch the copies were recorded into
+    /// * `std::nullopt` - if staging memory could not be allocated or recording failed
+    std::optional<upload_ticket_t> upload_texture(const allocated_image_t& image, const texture_data_t& texture, upload_group_t* group = nullptr,
+            std::uint32_t first_level = 0, std::uint32_t level_count = VK_REMAINING_MIP_LEVELS, std::uint32_t image_level = 0);
+
+    /// Reserves `size` bytes of staging memory for the uploads of a group and keeps the open batch from being submitted until
+    /// `end_group` is called. Sum `staging_size` over the uploads of the group to get `size`.
+    ///
+    /// Returns:
+    /// * `upload_group_t` - reserved staging range, uploads that do not fit into it are staged on their own
+    /// * `std::nullopt` - if beginning the batch or allocating the staging memory failed
+    std::optional<upload_group_t> begin_group(vk::DeviceSize size);
+    /// Lets the batch of the group be submitted by the next `flush`. Has to be called for every group `begin_group` returned,
+    /// even if its uploads failed.
+    ///
+    /// Returns:
+    /// * `upload_ticket_t` - ticket of the batch all uploads of the group were recorded into
+    std::optional<upload_ticket_t> end_group(upload_group_t& group);
+    /// Staging memory an upload of `size` bytes takes up in a group.
+    static vk::DeviceSize staging_size(vk::DeviceSize size)
+    {
+        return (size + UPLOAD_STAGING_ALIGNMENT - 1) / UPLOAD_STAGING_ALIGNMENT * UPLOAD_STAGING_ALIGNMENT;
+    }
+
+    /// Submits the open batch unless groups are still recording into it.
+    ///
+    /// Returns:
+    /// * `false` - if recording or submission failed, the uploads of the batch are lost
+    /// * `true` - if the batch was submitted or there was nothing to submit
+    bool flush();
+    /// Updates `completed` and recycles the staging memory and command buffers of batches that are done.
+    void collect();
+    bool is_ready(upload_ticket_t ticket) const { return ticket <= this->completed; }
+    /// Staging buffers that are alive, the ring and the dedicated buffers of the open batch and the batches in flight.
+    ///
+    /// Returns:
+    /// * `std::pair<std::uint32_t, vk::DeviceSize>` - number of staging buffers and their size in bytes
+    std::pair<std::uint32_t, vk::DeviceSize> staging_memory();
+    /// Blocks until the batch of `ticket` is done, submitting it first if it is still open.
+    ///
+    /// Returns:
+    /// * `false` - if submission or waiting failed or the batch of `ticket` is held open by a group
+    /// * `true` - if the uploads of `ticket` are done
+    bool wait(upload_ticket_t ticket, std::uint64_t timeout = 9999999999);
+
+    /// Begins recording the open batch if there is none. Expects `mutex` to be locked.
+    ///
+    /// Returns:
+    /// * `false` - if creating or beginning the command buffers failed
+    /// * `true` - if `open_batch` is recording
+    bool begin_batch();
+    /// Allocates `size` bytes from the staging ring or a dedicated staging buffer of the open batch if the ring is full.
+    /// Expects `mutex` to be locked and the open batch to be recording.
+    ///
+    /// Returns:
+    /// * `upload_group_t` - allocated staging range
+    /// * `std::nullopt` - if a dedicated staging buffer could not be created
+    std::optional<upload_group_t> reserve(vk::DeviceSize size);
+    /// Copies `data` into the range of `group` if it fits, otherwise into a range allocated by `reserve`.
+    /// Expects `mutex` to be locked and the open batch to be recording.
+    ///
+    /// Returns:
+    /// * `std::pair<vk::Buffer, vk::DeviceSize>` - staging buffer and offset of the data in it
+    /// * `std::nullopt` - if a dedicated staging buffer could not be created
+    std::optional<std::pair<vk::Buffer, vk::DeviceSize>> stage(const void* data, vk::DeviceSize size, upload_group_t* group);
+};
@@ -1,26 +1,40 @@
 #include <vk-descriptors.h>
 #include <error_fmt.h>
 
-descriptor_layout_builder_t& descriptor_layout_builder_t::add_binding(std::uint32_t binding, vk::DescriptorType type)
+descriptor_layout_builder_t& descriptor_layout_builder_t::add_binding(std::uint32_t binding, vk::DescriptorType type, std::uint32_t count,
+        vk::DescriptorBindingFlags flags)
 {
-    vk::DescriptorSetLayoutBinding new_bind(binding, type, 1);
+    vk::DescriptorSetLayoutBinding new_bind(binding, type, count);
     this->bindings.push_back(new_bind);
+    this->binding_flags.push_back(flags);
     return *this;
 }
 
 void descriptor_layout_builder_t::clear()
 {
     this->bindings.clear();
+    this->binding_flags.clear();
 }
 
-std::optional<vk::DescriptorSetLayout> descriptor_layout_builder_t::build(vk::Device device, vk::ShaderStageFlags shader_stages)
+std::optional<vk::DescriptorSetLayout> descriptor_layout_builder_t::build(vk::Device device, vk::ShaderStageFlags shader_stages,
+        vk::DescriptorSetLayoutCreateFlags flags)
 {
     for (auto& bind : this->bindings)
     {
         bind.stageFlags |= shader_stages;
     }
 
-    vk::DescriptorSetLayoutCreateInfo info({}, this->bindings);
+    vk::DescriptorSetLayoutCreateInfo info(flags, this->bindings);
+    // NOTE: Binding flags are only chained if any binding requests them, so plain layouts do not depend on descriptor indexing.
+    vk::DescriptorSetLayoutBindingFlagsCreateInfo flags_info(this->binding_flags);
+    for (auto f : this->binding_flags)
+    {
+        if (f)
+        {
+            info.pNext = &flags_info;
+            break;
+        }
+    }
     auto [result, set] = device.createDescriptorSetLayout(info);
     if (result != vk::Result::eSuccess)
     {
@@ -30,13 +44,13 @@ std::optional<vk::DescriptorSetLayout> descriptor_layout_builder_t::build(vk::De
     return set;
 }
 
-bool descriptor_allocator_t::init_pool(vk::Device device, std::uint32_t max_sets, std::span<pool_size_ratio_t> pool_ratios)
+bool descriptor_allocator_t::init_pool(vk::Device device, std::uint32_t max_sets, std::span<pool_size_ratio_t> pool_ratios, vk::DescriptorPoolCreateFlags flags)
 {
     std::vector<vk::DescriptorPoolSize> pool_sizes;
     for (pool_size_ratio_t ratio : pool_ratios)
         pool_sizes.push_back(vk::DescriptorPoolSize(ratio.type, std::uint32_t(ratio.ratio * max_sets)));
 
-    vk::DescriptorPoolCreateInfo pool_info({}, max_sets, pool_sizes);
+    vk::DescriptorPoolCreateInfo pool_info(flags, max_sets, pool_sizes);
     vk::Result result;
     std::tie(result, this->pool) = device.createDescriptorPool(pool_info);
     if (result != vk::Result::eSuccess)
@@ -176,17 +190,19 @@ std::optional<vk::DescriptorPool> descriptor_allocator_growable_t::create_pool(v
     return pool;
 }
 
-void descriptor_writer_t::write_buffer(std::int32_t binding, vk::Buffer buffer, std::size_t size, std::size_t offset, vk::DescriptorType type)
+void descriptor_writer_t::write_buffer(std::int32_t binding, vk::Buffer buffer, std::size_t size, std::size_t offset, vk::DescriptorType type,
+        std::uint32_t array_element)
 {
     vk::DescriptorBufferInfo& info = this->buffer_infos.emplace_back(vk::DescriptorBufferInfo(buffer, offset, size));
-    vk::WriteDescriptorSet write({}, binding, {}, 1, type, {}, &info);
+    vk::WriteDescriptorSet write({}, binding, array_element, 1, type, {}, &info);
     this->writes.push_back(write);
 }
 
-void descriptor_writer_t::write_image(std::int32_t binding, vk::ImageView image, vk::Sampler sampler, vk::ImageLayout layout, vk::DescriptorType type)
+void descriptor_writer_t::write_image(std::int32_t binding, vk::ImageView image, vk::Sampler sampler, vk::ImageLayout layout, vk::DescriptorType type,
+        std::uint32_t array_element)
 {
     vk::DescriptorImageInfo& info = this->image_infos.emplace_back(vk::DescriptorImageInfo(sampler, image, layout));
-    vk::WriteDescriptorSet write({}, binding, {}, 1, type, &info);
+    vk::WriteDescriptorSet write({}, binding, array_element, 1, type, &info);
     this->writes.push_back(write);
 }
 
@@ -203,3 +219,121 @@ void descriptor_writer_t::update_set(vk::Device device, vk::DescriptorSet set)
         write.dstSet = set;
     device.updateDescriptorSets(this->writes, {});
 }
+
+std::optional<std::uint32_t> descriptor_index_allocator_t::allocate()
+{
+    if (this->free_list.size() != 0)
+    {
+        std::uint32_t index = this->free_list.back();
+        this->free_list.pop_back();
+        return index;
+    }
+    if (this->next >= this->capacity)
+    {
+        fmt::print(stderr, "[ {} ]\tDescriptor array is full ({} slots)!\n", ERROR_FMT("ERROR"), this->capacity);
+        return std::nullopt;
+    }
+    return this->next++;
+}
+
+void descriptor_index_allocator_t::release(std::uint32_t index)
+{
+    this->free_list.push_back(index);
+}
+
+void descriptor_buffer_t::init(vk::Device device, allocated_buffer_t buffer, vk::BufferUsageFlags usage,
+        const vk::PhysicalDeviceDescriptorBufferPropertiesEXT& properties, vk::DeviceSize base, vk::DeviceSize size)
+{
+    this->buffer = buffer;
+    this->usage = usage;
+    this->properties = properties;
+    this->properties.pNext = nullptr;
+    this->base = base;
+    this->size = size;
+    this->head = base;
+
+    vk::BufferDeviceAddressInfo address_info(buffer.buffer);
+    this->address = device.getBufferAddress(&address_info);
+}
+
+void descriptor_buffer_t::reset()
+{
+    this->head = this->base;
+}
+
+std::optional<vk::DeviceSize> descriptor_buffer_t::allocate(vk::Device device, vk::DescriptorSetLayout layout, const vk::DispatchLoaderDynamic& dispatch)
+{
+    vk::DeviceSize alignment = this->properties.descriptorBufferOffsetAlignment;
+    vk::DeviceSize offset = (this->head + alignment - 1) / alignment * alignment;
+    vk::DeviceSize set_size = device.getDescriptorSetLayoutSizeEXT(layout, dispatch);
+    if (offset + set_size > this->base + this->size)
+    {
+        fmt::print(stderr, "[ {} ]\tDescriptor buffer is full!\n", ERROR_FMT("ERROR"));
+        return std::nullopt;
+    }
+    this->head = offset + set_size;
+    return offset;
+}
+
+void descriptor_buffer_t::write_image(vk::Device device, vk::DescriptorSetLayout layout, vk::DeviceSize set_offset, std::uint32_t binding, vk::ImageView image,
+        vk::Sampler sampler, vk::ImageLayout image_layout, vk::DescriptorType type, const vk::DispatchLoaderDynamic& dispatch, std::uint32_t array_element)
+{
+    vk::DescriptorImageInfo image_info(sampler, image, image_layout);
+    vk::DescriptorGetInfoEXT get_info(type);
+    std::size_t descriptor_size;
+    switch (type)
+    {
+        case vk::DescriptorType::eSampler:
+            get_info.data.pSampler = &sampler;
+            descriptor_size = this->properties.samplerDescriptorSize;
+            break;
+        case vk::DescriptorType::eCombinedImageSampler:
+            get_info.data.pCombinedImageSampler = &image_info;
+            descriptor_size = this->properties.combinedImageSamplerDescriptorSize;
+            break;
+        case vk::DescriptorType::eSampledImage:
+            get_info.data.pSampledImage = &image_info;
+            descriptor_size = this->properties.sampledImageDescriptorSize;
+            break;
+        case vk::DescriptorType::eStorageImage:
+            get_info.data.pStorageImage = &image_info;
+            descriptor_size = this->properties.storageImageDescriptorSize;
+            break;
+        default:
+            fmt::print(stderr, "[ {} ]\tUnsupported image descriptor type for descriptor buffer!\n", ERROR_FMT("ERROR"));
+            return;
+    }
+
+    vk::DeviceSize offset = set_offset + device.getDescriptorSetLayoutBindingOffsetEXT(layout, binding, dispatch) + array_element * descriptor_size;
+    device.getDescriptorEXT(&get_info, descriptor_size, (char*)this->buffer.info.pMappedData + offset, dispatch);
+}
+
+void descriptor_buffer_t::write_buffer(vk::Device device, vk::DescriptorSetLayout layout, vk::DeviceSize set_offset, std::uint32_t binding,
+        vk::DeviceAddress buffer_address, std::size_t size, vk::DescriptorType type, const vk::DispatchLoaderDynamic& dispatch, std::uint32_t array_element)
+{
+    vk::DescriptorAddressInfoEXT address_info(buffer_address, size);
+    vk::DescriptorGetInfoEXT get_info(type);
+    std::size_t descriptor_size;
+    switch (type)
+    {
+        case vk::DescriptorType::eUniformBuffer:
+            get_info.data.pUniformBuffer = &address_info;
+            descriptor_size = this->properties.uniformBufferDescriptorSize;
+            break;
+        case vk::DescriptorType::eStorageBuffer:
+            get_info.data.pStorageBuffer = &address_info;
+            descriptor_size = this->properties.storageBufferDescriptorSize;
+            break;
+        default:
+            fmt::print(stderr, "[ {} ]\tUnsupported buffer descriptor type for descriptor buffer!\n", ERROR_FMT("ERROR"));
+            return;
+    }
+
+    vk::DeviceSize offset = set_offset + device.getDescriptorSetLayoutBindingOffsetEXT(layout, binding, dispatch) + array_element * descriptor_size;
+    device.getDescriptorEXT(&get_info, descriptor_size, (char*)this->buffer.info.pMappedData + offset, dispatch);
+}
+
+vk::DescriptorBufferBindingInfoEXT descriptor_buffer_t::binding_info() const
+{
+    return vk::DescriptorBufferBindingInfoEXT(this->address, this->usage);
+}
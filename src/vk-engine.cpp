@@ -1,5 +1,6 @@
 #include <vk-engine.h>
 #include <vk-images.h>
+#include <vk-mesh.h>
 #include <error_fmt.h>
 
 #include <imgui.h>
@@ -7,7 +8,10 @@
 #include <backends/imgui_impl_vulkan.h>
 
 #include <glm/gtx/transform.hpp>
+#include <algorithm>
 #include <chrono>
+#include <fstream>
+#include <limits>
 
 #ifndef BASE_DIR
 #define BASE_DIR ""
@@ -81,29 +85,39 @@ void sort_surfaces(std::vector<std::uint32_t>& opaque_draws, std::vector<render_
     std::sort(opaque_draws.begin(), opaque_draws.end(), [&](const auto& i, const auto& j) {
             const render_object_t& a = opaque_surfaces[i];
             const render_object_t& b = opaque_surfaces[j];
-            if (a.material == b.material) return a.index_buffer < b.index_buffer;
-            return a.material < b.material;
+            if (a.material->pipeline == b.material->pipeline) return a.index_type < b.index_type;
+            return a.material->pipeline < b.material->pipeline;
             });
 }
 
 void mesh_node_t::draw(const glm::mat4& top_matrix, draw_context_t& ctx)
 {
     glm::mat4 node_matrix = top_matrix * this->world_transform;
+    std::vector<glm::mat4> transforms = { node_matrix };
+    // NOTE: Instances without a previous transform, e.g. in the first frame, have no motion of their own.
+    if (this->previous_transforms.size() != transforms.size()) this->previous_transforms = transforms;
     for (auto& s : mesh->surfaces)
     {
         render_object_t def{ .index_count = s.count,
-            .first_index = s.start_index,
-            .index_buffer = this->mesh->mesh_buffer.index_buffer.buffer,
+            .first_index = this->mesh->mesh_buffer.first_index + s.start_index,
+            .index_buffer = this->mesh->mesh_buffer.index_buffer,
+            .index_type = this->mesh->mesh_buffer.index_type,
             .material = &s.material->data,
             .bounds = s.bounds,
-            .transform = { node_matrix },
-            .vertex_buffer_address = mesh->mesh_buffer.vertex_buffer_address
+            .transform = transforms,
+            .previous_transform = this->previous_transforms,
+            .vertex_buffer_address = mesh->mesh_buffer.vertex_buffer_address,
+            .vertex_format = mesh->mesh_buffer.vertex_format,
+            .position_offset = mesh->mesh_buffer.position_offset,
+            .position_scale = mesh->mesh_buffer.position_scale,
+            .ticket = std::max(mesh->mesh_buffer.ticket, s.material->data.ticket)
         };
         if (s.material->data.pass_type == material_pass_e::TRANSPARENT)
             ctx.transparent_surfaces.push_back(def);
         else
             ctx.opaque_surfaces.push_back(def);
     }
+    this->previous_transforms = transforms;
     node_t::draw(top_matrix, ctx);
 }
 
@@ -114,28 +128,35 @@ void mesh_node_t::draw(const std::vector<glm::mat4>& top_matrix, draw_context_t&
     {
         transforms.push_back(mat * this->world_transform);
     }
+    if (this->previous_transforms.size() != transforms.size()) this->previous_transforms = transforms;
     for (auto& s : mesh->surfaces)
     {
         render_object_t def{ .index_count = s.count,
-            .first_index = s.start_index,
-            .index_buffer = this->mesh->mesh_buffer.index_buffer.buffer,
+            .first_index = this->mesh->mesh_buffer.first_index + s.start_index,
+            .index_buffer = this->mesh->mesh_buffer.index_buffer,
+            .index_type = this->mesh->mesh_buffer.index_type,
             .material = &s.material->data,
             .bounds = s.bounds,
             .transform = transforms,
-            .vertex_buffer_address = mesh->mesh_buffer.vertex_buffer_address
+            .previous_transform = this->previous_transforms,
+            .vertex_buffer_address = mesh->mesh_buffer.vertex_buffer_address,
+            .vertex_format = mesh->mesh_buffer.vertex_format,
+            .position_offset = mesh->mesh_buffer.position_offset,
+            .position_scale = mesh->mesh_buffer.position_scale,
+            .ticket = std::max(mesh->mesh_buffer.ticket, s.material->data.ticket)
         };
         if (s.material->data.pass_type == material_pass_e::TRANSPARENT)
             ctx.transparent_surfaces.push_back(def);
         else
             ctx.opaque_surfaces.push_back(def);
     }
+    this->previous_transforms = transforms;
     node_t::draw(top_matrix, ctx);
 }
 
-bool gltf_metallic_roughness_t::build_pipelines(engine_t* engine, std::string vertex, std::string fragment,
-        std::size_t push_constants_size, std::vector<std::tuple<std::uint32_t, vk::DescriptorType>> bindings,
-        std::vector<vk::DescriptorSetLayout> external_layouts, std::vector<vk::VertexInputBindingDescription> input_bindings,
-        std::vector<vk::VertexInputAttributeDescription> input_attributes, std::vector<vk::Format> formats)
+bool gltf_metallic_roughness_t::build_pipelines(engine_t* engine, std::string vertex, std::string fragment, std::size_t push_constants_size,
+        std::vector<vk::VertexInputBindingDescription> input_bindings, std::vector<vk::VertexInputAttributeDescription> input_attributes,
+        std::vector<vk::Format> formats)
 {
     auto vert_shader = vkutil::load_shader_module(vertex.c_str(), engine->device.dev);
     if (!vert_shader.has_value()) return false;
@@ -143,16 +164,8 @@ bool gltf_metallic_roughness_t::build_pipelines(engine_t* engine, std::string ve
     if (!frag_shader.has_value()) return false;
 
     vk::PushConstantRange matrix_range(vk::ShaderStageFlagBits::eVertex, 0, push_constants_size);
-    descriptor_layout_builder_t layout_builder;
-    for (const auto& [bind, type] : bindings) layout_builder.add_binding(bind, type);
-    // TODO: Should the stages also be an input?
-    auto ret_layout = layout_builder
-        .build(engine->device.dev, vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment);
-    if (!ret_layout.has_value()) return false;
-    this->material_layout = ret_layout.value();
-
-    external_layouts.push_back(this->material_layout);
-    vk::PipelineLayoutCreateInfo mesh_layout_info({}, external_layouts, matrix_range);
+    std::array<vk::DescriptorSetLayout, 2> layouts = { engine->scene_data.layout, engine->bindless.layout };
+    vk::PipelineLayoutCreateInfo mesh_layout_info({}, layouts, matrix_range);
 
     auto [result, new_layout] = engine->device.dev.createPipelineLayout(mesh_layout_info);
     if (result != vk::Result::eSuccess)
@@ -166,6 +179,7 @@ bool gltf_metallic_roughness_t::build_pipelines(engine_t* engine, std::string ve
 
     pipeline_builder_t pipeline_builder;
     pipeline_builder.pipeline_layout = new_layout;
+    if (engine->descriptor_backend == descriptor_backend_e::BUFFER) pipeline_builder.set_flags(vk::PipelineCreateFlagBits::eDescriptorBufferEXT);
     // TODO: Pipeline settings should probably be an input too
     pipeline_builder.set_shaders(vert_shader.value(), frag_shader.value())
         .set_input_topology(vk::PrimitiveTopology::eTriangleList)
@@ -176,10 +190,10 @@ bool gltf_metallic_roughness_t::build_pipelines(engine_t* engine, std::string ve
         .enable_depthtest(true, vk::CompareOp::eLess)
         .set_depth_format(engine->depth_image.format);
 
-    if (formats.size() == 0)
-        pipeline_builder.set_color_attachment_format(engine->draw_image.format);
-    else
-        pipeline_builder.set_color_attachment_count(formats.size(), formats);
+    // NOTE: The default attachments are the ones of the default `draw_cmd`: the draw image and the motion vectors of the upscaler.
+    bool default_formats = formats.size() == 0;
+    if (default_formats) formats = { engine->draw_image.format, engine->upscaler.motion_image.format };
+    pipeline_builder.set_color_attachment_count(formats.size(), formats);
 
     for (auto ib : input_bindings) pipeline_builder.add_vertex_input_binding(ib.binding, ib.stride, ib.inputRate);
     for (auto ia : input_attributes) pipeline_builder.add_vertex_input_attribute(ia.binding, ia.location, ia.format, ia.offset);
@@ -187,6 +201,11 @@ bool gltf_metallic_roughness_t::build_pipelines(engine_t* engine, std::string ve
     auto ret_pipeline = pipeline_builder.build(engine->device.dev);
     if (!ret_pipeline.has_value()) return false;
     this->opaque_pipeline.pipeline = ret_pipeline.value();
+    ret_pipeline = pipeline_builder.enable_depthtest(false, vk::CompareOp::eEqual).build(engine->device.dev);
+    if (!ret_pipeline.has_value()) return false;
+    this->opaque_pipeline.equal_pipeline = ret_pipeline.value();
+    // NOTE: Transparent surfaces must not blend into the motion vectors of the opaque surfaces behind them.
+    if (default_formats) pipeline_builder.disable_color_write(1);
     ret_pipeline = pipeline_builder.enable_blending_additive()
         .enable_depthtest(false, vk::CompareOp::eLess)
         .build(engine->device.dev);
@@ -196,33 +215,64 @@ bool gltf_metallic_roughness_t::build_pipelines(engine_t* engine, std::string ve
     engine->device.dev.destroyShaderModule(vert_shader.value());
     engine->device.dev.destroyShaderModule(frag_shader.value());
 
+    // NOTE: The depth-only variants keep the vertex input, layout and rasterizer state of the material pipelines.
+    std::string base_dir = BASE_DIR;
+    auto depth_vert_shader = vkutil::load_shader_module((base_dir + "/tests/build/shaders/depth.vert.spv").c_str(), engine->device.dev);
+    if (!depth_vert_shader.has_value()) return false;
+    auto masked_vert_shader = vkutil::load_shader_module((base_dir + "/tests/build/shaders/depth_masked.vert.spv").c_str(), engine->device.dev);
+    if (!masked_vert_shader.has_value()) return false;
+    auto masked_frag_shader = vkutil::load_shader_module((base_dir + "/tests/build/shaders/depth_masked.frag.spv").c_str(), engine->device.dev);
+    if (!masked_frag_shader.has_value()) return false;
+
+    std::vector<vk::Format> no_formats;
+    ret_pipeline = pipeline_builder.set_vertex_shader(depth_vert_shader.value())
+        .set_color_attachment_count(0, no_formats)
+        .disable_blending()
+        .enable_depthtest(true, vk::CompareOp::eLess)
+        .build(engine->device.dev);
+    if (!ret_pipeline.has_value()) return false;
+    this->opaque_pipeline.depth_pipeline = ret_pipeline.value();
+    ret_pipeline = pipeline_builder.set_shaders(masked_vert_shader.value(), masked_frag_shader.value()).build(engine->device.dev);
+    if (!ret_pipeline.has_value()) return false;
+
+    this->masked_pipeline = this->opaque_pipeline;
+    this->masked_pipeline.depth_pipeline = ret_pipeline.value();
+
+    engine->device.dev.destroyShaderModule(depth_vert_shader.value());
+    engine->device.dev.destroyShaderModule(masked_vert_shader.value());
+    engine->device.dev.destroyShaderModule(masked_frag_shader.value());
+
     engine->main_deletion_queue.push_function([=, this]() {
-            engine->device.dev.destroyDescriptorSetLayout(this->material_layout);
             engine->device.dev.destroyPipelineLayout(this->opaque_pipeline.layout);
             engine->device.dev.destroyPipeline(this->opaque_pipeline.pipeline);
+            engine->device.dev.destroyPipeline(this->opaque_pipeline.equal_pipeline);
+            engine->device.dev.destroyPipeline(this->opaque_pipeline.depth_pipeline);
+            engine->device.dev.destroyPipeline(this->masked_pipeline.depth_pipeline);
             engine->device.dev.destroyPipeline(this->transparent_pipeline.pipeline);
             });
 
     return true;
 }
 
-std::optional<material_instance_t> gltf_metallic_roughness_t::write_material(vk::Device device, material_pass_e pass, const material_resources_t& resources,
-        descriptor_allocator_growable_t& descriptor_allocator)
+std::optional<material_instance_t> gltf_metallic_roughness_t::write_material(engine_t* engine, material_pass_e pass, const material_constants_t& constants)
 {
     material_instance_t material;
     material.pass_type = pass;
-    material.pipeline = (pass == material_pass_e::TRANSPARENT) ? &this->transparent_pipeline : &this->opaque_pipeline;
-    auto ret = descriptor_allocator.allocate(device, this->material_layout);
+    switch (pass)
+    {
+        case material_pass_e::TRANSPARENT:
+            material.pipeline = &this->transparent_pipeline;
+            break;
+        case material_pass_e::MASKED:
+            material.pipeline = &this->masked_pipeline;
+            break;
+        default:
+            material.pipeline = &this->opaque_pipeline;
+            break;
+    }
+    auto ret = engine->register_material(constants);
     if (!ret.has_value()) return std::nullopt;
-    material.material_set = ret.value();
-
-    this->writer.clear();
-    for (const auto& buf : resources.buffers)
-        this->writer.write_buffer(buf.binding, buf.buffer, buf.size, buf.offset, buf.type);
-    for (const auto& img : resources.images)
-        this->writer.write_image(img.binding, img.image.view, img.sampler, img.layout, img.type);
-
-    this->writer.update_set(device, material.material_set);
+    material.material_index = ret.value();
 
     return material;
 }
@@ -263,12 +313,15 @@ engine_t::engine_t(std::uint32_t width, std::uint32_t height, std::string app_na
     glfwSetFramebufferSizeCallback(this->window.win, engine_t::framebuffer_size_callback);
     glfwSetCursorPosCallback(this->window.win, cursor_pos_callback);
     this->show_stats = show_stats;
+    this->texture_cache_dir = std::string(BASE_DIR) + "/tests/build/texture_cache";
 }
 
 engine_t::~engine_t()
 {
     if (this->initialized)
     {
+        this->jobs.destroy();
+
         vk::Result result;
         if ((result = this->device.dev.waitIdle()) != vk::Result::eSuccess)
         {
@@ -276,11 +329,17 @@ engine_t::~engine_t()
             abort();
         }
 
+        this->end_defragmentation();
+        this->pending_loads.clear();
         this->loaded_scenes.clear();
+        this->collect_retired(true);
 
         for (std::size_t i = 0; i < FRAME_OVERLAP; ++i)
         {
             this->device.dev.destroyCommandPool(this->frames[i].pool);
+            if (this->frames[i].compute_pool) this->device.dev.destroyCommandPool(this->frames[i].compute_pool);
+            if (this->frames[i].compute_semaphore) this->device.dev.destroySemaphore(this->frames[i].compute_semaphore);
+            if (this->frames[i].timestamp_pool) this->device.dev.destroyQueryPool(this->frames[i].timestamp_pool);
 
             this->device.dev.destroyFence(this->frames[i].render_fence);
             this->device.dev.destroySemaphore(this->frames[i].render_semaphore);
@@ -330,12 +389,32 @@ bool engine_t::run()
                 if (ImGui::Begin("Stats"))
                 {
                     ImGui::Text("Frametime:   %f ms", this->stats.fram_time);
+                    ImGui::Text("GPU time:    %f ms", this->stats.gpu_frame_time);
                     ImGui::Text("Draw time:   %f ms", this->stats.mesh_draw_time);
                     ImGui::Text("Update time: %f ms", this->stats.scene_update_time);
                     ImGui::Text("Triangles:   %i", this->stats.triangle_count);
                     ImGui::Text("Draws:       %i", this->stats.drawcall_count);
+                    ImGui::Text("Descriptors: %s", this->descriptor_backend == descriptor_backend_e::BUFFER ? "buffer" : "pool");
+                    ImGui::Checkbox("Depth pre-pass", &this->depth_prepass);
+                    if (this->device.compute.family_index != this->device.graphics.family_index)
+                        ImGui::Checkbox("Async compute", &this->use_async_compute);
+                    const char* upscale_modes[] = { "linear", "spatial", "temporal" };
+                    int upscale_mode = static_cast<int>(this->upscaler.mode);
+                    if (ImGui::Combo("Upscaler", &upscale_mode, upscale_modes, IM_ARRAYSIZE(upscale_modes)))
+                        this->upscaler.mode = static_cast<upscale_mode_e>(upscale_mode);
+                    ImGui::Text("Upscaler output: %s", this->swapchain.storage ? "direct" : "intermediate");
+                    ImGui::SliderFloat("Sharpness", &this->upscaler.sharpness, 0.f, 2.f, "%.2f stops");
+                    ImGui::SliderFloat("History blend", &this->upscaler.blend, .02f, 1.f);
+                    if (this->timestamp_period > 0.f)
+                    {
+                        ImGui::Checkbox("Quality governor", &this->governor.enabled);
+                        ImGui::SliderFloat("Target GPU time", &this->governor.target_frame_time, 1.f, 50.f, "%.2f ms");
+                        ImGui::Text("Quality:     %f", this->governor.quality);
+                        for (const quality_knob_t& knob : this->governor.knobs) ImGui::Text("%s: %f", knob.name.c_str(), *knob.value);
+                    }
                     ImGui::End();
                 }
+                this->draw_memory_window();
             }
 
             ImGui::Render();
@@ -356,6 +435,7 @@ void engine_t::update_scene()
     auto start = std::chrono::system_clock::now();
 
     this->update();
+    this->update_model_loads();
 
     this->main_draw_context.opaque_surfaces.clear();
     this->main_draw_context.transparent_surfaces.clear();
@@ -365,6 +445,11 @@ void engine_t::update_scene()
         v->draw(v->transform, this->main_draw_context);
     }
 
+    // NOTE: Surfaces are only drawn once the uploads of their mesh and textures are done, the frame loop never waits for them.
+    auto uploading = [this](const render_object_t& obj) { return !this->uploads.is_ready(obj.ticket); };
+    std::erase_if(this->main_draw_context.opaque_surfaces, uploading);
+    std::erase_if(this->main_draw_context.transparent_surfaces, uploading);
+
     auto end = std::chrono::system_clock::now();
     auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
     this->stats.scene_update_time = elapsed.count() / 1000.f;
@@ -380,74 +465,107 @@ void engine_t::draw_geometry(vk::CommandBuffer cmd, std::vector<vk::RenderingAtt
     std::vector<std::uint32_t> opaque_draws = frustum_culling(this->main_draw_context.opaque_surfaces, this->scene_data.gpu_data.viewproj);
     sort_surfaces(opaque_draws, this->main_draw_context.opaque_surfaces);
     
-    // TODO: Used attachment should not be static.
-    vk::RenderingInfo render_info({}, { vk::Offset2D(0, 0), this->draw_extent }, 1, {}, color_attachments, &depth_attachment);
-    cmd.beginRendering(render_info);
-
     // TODO: Scene data should not be restricted to this one struct.
-    auto ret_buf = create_buffer(sizeof(gpu_scene_data_t), vk::BufferUsageFlagBits::eUniformBuffer, VMA_MEMORY_USAGE_CPU_TO_GPU);
-    if (!ret_buf.has_value()) return;
+    // NOTE: The scene buffer of this frame is no longer in use since the render fence of the frame has been waited on.
+    frame_data_t& frame = this->get_current_frame();
+    gpu_scene_data_t* scene_uniform_data = (gpu_scene_data_t*)frame.scene_buffer.info.pMappedData;
+    *scene_uniform_data = this->scene_data.gpu_data;
 
-    allocated_buffer_t gpu_scene_data_buffer = ret_buf.value();
-    this->get_current_frame().deletion_queue.push_function([=, this]() {
-            this->destroy_buffer(gpu_scene_data_buffer);
-        });
+    vk::DescriptorBufferInfo scene_buffer_info(frame.scene_buffer.buffer, 0, sizeof(gpu_scene_data_t));
+    vk::WriteDescriptorSet scene_write({}, 0, 0, 1, vk::DescriptorType::eUniformBuffer, {}, &scene_buffer_info);
 
-    gpu_scene_data_t* scene_uniform_data = (gpu_scene_data_t*)gpu_scene_data_buffer.info.pMappedData;
-    *scene_uniform_data = this->scene_data.gpu_data;
+    vk::Pipeline last_pipeline = {};
+    vk::PipelineLayout last_layout = {};
+    // NOTE: Meshes share the index buffer of the geometry pool, so it is mostly rebound when the index type changes. Render objects
+    // of other index buffers still get theirs bound.
+    vk::Buffer last_index_buffer = {};
+    std::optional<vk::IndexType> last_index_type;
+    std::array<vk::DescriptorSet, 2> descriptor_sets = { frame.scene_set, this->bindless.set };
 
-    auto ret = this->get_current_frame().frame_descriptors.allocate(this->device.dev, this->scene_data.layout);
-    if (!ret.has_value())
+    // NOTE: With descriptor buffers the per-frame churn is writing the scene descriptor into the ring of this frame.
+    std::array<std::uint32_t, 2> buffer_indices = { 0, 0 };
+    std::array<vk::DeviceSize, 2> buffer_offsets = { 0, this->bindless.buffer_offset };
+    if (this->descriptor_backend == descriptor_backend_e::BUFFER)
     {
-        cmd.endRendering();
-        return;
-    }
+        auto ret = frame.descriptor_ring.allocate(this->device.dev, this->scene_data.layout, this->dispatch);
+        if (!ret.has_value()) return;
+        buffer_offsets[0] = ret.value();
 
-    vk::DescriptorSet global_descriptor = ret.value();
-    descriptor_writer_t writer;
-    writer.write_buffer(0, gpu_scene_data_buffer.buffer, sizeof(gpu_scene_data_t), 0, vk::DescriptorType::eUniformBuffer);
-    writer.update_set(this->device.dev, global_descriptor);
+        vk::BufferDeviceAddressInfo address_info(frame.scene_buffer.buffer);
+        frame.descriptor_ring.write_buffer(this->device.dev, this->scene_data.layout, buffer_offsets[0], 0, this->device.dev.getBufferAddress(&address_info),
+                sizeof(gpu_scene_data_t), vk::DescriptorType::eUniformBuffer, this->dispatch);
+        cmd.bindDescriptorBuffersEXT(this->bindless.descriptor_buffer.binding_info(), this->dispatch);
+    }
 
-    material_pipeline_t* last_pipeline = nullptr;
-    material_instance_t* last_material = nullptr;
-    vk::Buffer last_index_buffer = {};
+    // NOTE: The instance transforms of an object are uploaded once per frame and shared by the pre-pass and the main pass.
+    std::unordered_map<const render_object_t*, vk::Buffer> instance_buffers;
 
-    auto draw = [&](const render_object_t& obj)
+    auto draw = [&](const render_object_t& obj, vk::Pipeline pipeline)
     {
-        if (obj.material != last_material)
+        // NOTE: Materials only differ by their index into the bindless material buffer, so only pipeline changes require binds.
+        if (pipeline != last_pipeline)
         {
-            last_material = obj.material;
-            if (obj.material->pipeline != last_pipeline)
+            last_pipeline = pipeline;
+            cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+
+            // NOTE: Bound and pushed descriptors stay valid across pipelines with the same layout.
+            if (obj.material->pipeline->layout != last_layout)
             {
-                last_pipeline = obj.material->pipeline;
-                cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, obj.material->pipeline->pipeline);
-                cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, obj.material->pipeline->layout, 0, global_descriptor, {});
-
-                vk::Viewport viewport(0, 0, this->draw_extent.width, this->draw_extent.height, 0, 1);
-                cmd.setViewport(0, viewport);
-                vk::Rect2D scissor(vk::Offset2D(0, 0), this->draw_extent);
-                cmd.setScissor(0, scissor);
+                last_layout = obj.material->pipeline->layout;
+                if (this->descriptor_backend == descriptor_backend_e::BUFFER)
+                {
+                    cmd.setDescriptorBufferOffsetsEXT(vk::PipelineBindPoint::eGraphics, last_layout, 0, buffer_indices, buffer_offsets, this->dispatch);
+                }
+                else if (this->device.extensions.push_descriptor)
+                {
+                    cmd.pushDescriptorSetKHR(vk::PipelineBindPoint::eGraphics, last_layout, 0, scene_write, this->dispatch);
+                    cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, last_layout, 1, this->bindless.set, {});
+                }
+                else
+                {
+                    cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, last_layout, 0, descriptor_sets, {});
+                }
             }
 
-            cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, obj.material->pipeline->layout, 1, obj.material->material_set, {});
+            vk::Viewport viewport(0, 0, this->draw_extent.width, this->draw_extent.height, 0, 1);
+            cmd.setViewport(0, viewport);
+            vk::Rect2D scissor(vk::Offset2D(0, 0), this->draw_extent);
+            cmd.setScissor(0, scissor);
         }
-        if (obj.index_buffer != last_index_buffer)
+        if (obj.index_buffer != last_index_buffer || obj.index_type != last_index_type)
         {
             last_index_buffer = obj.index_buffer;
-            cmd.bindIndexBuffer(obj.index_buffer, 0, vk::IndexType::eUint32);
+            last_index_type = obj.index_type;
+            cmd.bindIndexBuffer(obj.index_buffer, 0, obj.index_type);
         }
 
         // TODO: Push constants should not be restricted to this one struct.
-        gpu_draw_push_constants_t push_constants{ .world = glm::mat4(1), .vertex_buffer = obj.vertex_buffer_address };
+        gpu_draw_push_constants_t push_constants{ .world = glm::mat4(1), .vertex_buffer = obj.vertex_buffer_address,
+            .material_index = obj.material->material_index, .vertex_format = obj.vertex_format,
+            .position_offset = glm::vec4(obj.position_offset, 0.f), .position_scale = glm::vec4(obj.position_scale, 0.f) };
         cmd.pushConstants(obj.material->pipeline->layout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(gpu_draw_push_constants_t), &push_constants);
+        // NOTE: Read by the residency manager, culled objects do not keep their textures resident.
+        obj.material->last_used_frame = this->frame_count;
         
-        auto ret = this->create_buffer(sizeof(glm::mat4) * obj.transform.size(), vk::BufferUsageFlagBits::eVertexBuffer, VMA_MEMORY_USAGE_CPU_TO_GPU);
-        if (!ret.has_value()) return;
-        allocated_buffer_t vtx_buf = ret.value();
-        this->get_current_frame().deletion_queue.push_function([=, this]() { this->destroy_buffer(vtx_buf); });
-        std::memcpy(vtx_buf.info.pMappedData, obj.transform.data(), sizeof(glm::mat4) * obj.transform.size());
-        vk::DeviceSize offsets[1] = { 0 };
-        cmd.bindVertexBuffers(0, vtx_buf.buffer, offsets);
+        // NOTE: The current transforms are bound to binding 0 and the transforms of the last frame to binding 1.
+        std::size_t transforms_size = sizeof(glm::mat4) * obj.transform.size();
+        auto instance_buffer = instance_buffers.find(&obj);
+        if (instance_buffer == instance_buffers.end())
+        {
+            auto ret = this->create_buffer(2 * transforms_size, vk::BufferUsageFlagBits::eVertexBuffer,
+                    VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
+            if (!ret.has_value()) return;
+            allocated_buffer_t vtx_buf = ret.value();
+            this->track_allocation(vtx_buf.allocation, memory_category_e::FRAME, "instance buffer");
+            this->get_current_frame().deletion_queue.push_function([=, this]() { this->destroy_buffer(vtx_buf); });
+            std::memcpy(vtx_buf.info.pMappedData, obj.transform.data(), transforms_size);
+            const std::vector<glm::mat4>& previous = (obj.previous_transform.size() == obj.transform.size()) ? obj.previous_transform : obj.transform;
+            std::memcpy((std::uint8_t*)vtx_buf.info.pMappedData + transforms_size, previous.data(), transforms_size);
+            instance_buffer = instance_buffers.emplace(&obj, vtx_buf.buffer).first;
+        }
+        std::array<vk::Buffer, 2> buffers = { instance_buffer->second, instance_buffer->second };
+        std::array<vk::DeviceSize, 2> offsets = { 0, transforms_size };
+        cmd.bindVertexBuffers(0, buffers, offsets);
         
         cmd.drawIndexed(obj.index_count, obj.transform.size(), obj.first_index, 0, 0);
 
@@ -455,19 +573,113 @@ void engine_t::draw_geometry(vk::CommandBuffer cmd, std::vector<vk::RenderingAtt
         this->stats.triangle_count += obj.transform.size() * obj.index_count / 3;
     };
 
+    // NOTE: The pre-pass lays down the closest depth of all opaque and masked surfaces, so the main pass shades every pixel
+    // at most once with an equal depth test. Surfaces without a depth-only variant are skipped here and drawn normally.
+    if (this->depth_prepass)
+    {
+        // NOTE: The main pass loads the depth of the pre-pass, whatever the caller stores at its end.
+        vk::RenderingAttachmentInfo prepass_depth = depth_attachment;
+        prepass_depth.storeOp = vk::AttachmentStoreOp::eStore;
+        vk::RenderingInfo prepass_info({}, { vk::Offset2D(0, 0), this->draw_extent }, 1, {}, {}, &prepass_depth);
+        cmd.beginRendering(prepass_info);
+        for (auto& r : opaque_draws)
+        {
+            const render_object_t& obj = this->main_draw_context.opaque_surfaces[r];
+            if (obj.material->pipeline->depth_pipeline) draw(obj, obj.material->pipeline->depth_pipeline);
+        }
+        cmd.endRendering();
+
+        vk::MemoryBarrier2 depth_barrier(vk::PipelineStageFlagBits2::eLateFragmentTests, vk::AccessFlagBits2::eDepthStencilAttachmentWrite,
+                vk::PipelineStageFlagBits2::eEarlyFragmentTests | vk::PipelineStageFlagBits2::eLateFragmentTests,
+                vk::AccessFlagBits2::eDepthStencilAttachmentRead | vk::AccessFlagBits2::eDepthStencilAttachmentWrite);
+        vk::DependencyInfo dependency_info({}, depth_barrier);
+        cmd.pipelineBarrier2(dependency_info);
+        depth_attachment.loadOp = vk::AttachmentLoadOp::eLoad;
+    }
+
+    // TODO: Used attachment should not be static.
+    vk::RenderingInfo render_info({}, { vk::Offset2D(0, 0), this->draw_extent }, 1, {}, color_attachments, &depth_attachment);
+    cmd.beginRendering(render_info);
+
     for (auto& r : opaque_draws)
     {
-        draw(this->main_draw_context.opaque_surfaces[r]);
+        const render_object_t& obj = this->main_draw_context.opaque_surfaces[r];
+        bool use_equal = this->depth_prepass && obj.material->pipeline->depth_pipeline && obj.material->pipeline->equal_pipeline;
+        draw(obj, use_equal ? obj.material->pipeline->equal_pipeline : obj.material->pipeline->pipeline);
     }
-    for (auto& r : this->main_draw_context.transparent_surfaces) draw(r);
+    for (auto& r : this->main_draw_context.transparent_surfaces) draw(r, r.material->pipeline->pipeline);
 
     cmd.endRendering();
 
     auto end = std::chrono::system_clock::now();
-    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    // NOTE: Microsecond resolution so the descriptor backends can be compared.
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
     this->stats.mesh_draw_time = elapsed.count() / 1000.f;
 }
 
+void engine_t::draw_memory_window()
+{
+    if (!ImGui::Begin("Memory"))
+    {
+        ImGui::End();
+        return;
+    }
+
+    // NOTE: Budgets are cheap to query every frame, the statistics of the report are not.
+    std::array<VmaBudget, VK_MAX_MEMORY_HEAPS> budgets;
+    vmaGetHeapBudgets(this->allocator, budgets.data());
+    const VkPhysicalDeviceMemoryProperties* memory_props;
+    vmaGetMemoryProperties(this->allocator, &memory_props);
+    for (std::uint32_t i = 0; i < memory_props->memoryHeapCount; ++i)
+    {
+        std::string label = fmt::format("{} / {} MiB", budgets[i].usage >> 20, budgets[i].budget >> 20);
+        ImGui::Text("Heap %u%s", i, (memory_props->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) ? " (device local)" : "");
+        ImGui::ProgressBar(budgets[i].budget > 0 ? float(budgets[i].usage) / budgets[i].budget : 0.f, ImVec2(-1.f, 0.f), label.c_str());
+    }
+
+    double now = glfwGetTime();
+    bool refresh = ImGui::Button("Refresh");
+    if (refresh || !this->memory.report.has_value() || now - this->memory.report_time >= this->memory.report_interval)
+    {
+        this->memory.report = this->memory_report();
+        this->memory.report_time = now;
+    }
+    const memory_report_t& report = this->memory.report.value();
+    ImGui::SameLine();
+    ImGui::Text("Statistics of %.1f s ago", now - this->memory.report_time);
+    ImGui::Text("Allocations: %u, %.1f MiB in %.1f MiB of blocks", report.allocations, report.allocation_bytes / 1048576.f,
+            report.block_bytes / 1048576.f);
+    ImGui::Text("Geometry pool: %.1f / %.1f MiB", report.geometry_used / 1048576.f, report.geometry_size / 1048576.f);
+    ImGui::Text("Residency: %.1f / %.1f MiB, %u evictions", this->residency.usage / 1048576.f, this->residency.effective_budget / 1048576.f,
+            this->residency.evictions);
+    if (this->defrag.pool)
+    {
+        ImGui::Checkbox("Defragment textures", &this->defrag.enabled);
+        ImGui::Text("Defragmentation: %u textures, %.1f MiB moved%s", this->defrag.moved_allocations, this->defrag.moved_bytes / 1048576.f,
+                this->defrag.context ? ", running" : "");
+    }
+
+    ImGui::Separator();
+    ImGui::Text("Categories");
+    for (std::size_t i = 0; i < MEMORY_CATEGORY_COUNT; ++i)
+    {
+        ImGui::Text("%-15s %5u  %9.1f MiB", MEMORY_CATEGORY_NAMES[i], report.categories[i].allocations, report.categories[i].bytes / 1048576.f);
+    }
+
+    ImGui::Separator();
+    ImGui::Text("Scenes");
+    for (const memory_report_t::scene_t& scene : report.scenes)
+    {
+        ImGui::Text("%s: %u images %.1f MiB, %u meshes %.1f MiB", scene.name.c_str(), scene.images, scene.image_bytes / 1048576.f, scene.meshes,
+                scene.mesh_bytes / 1048576.f);
+    }
+
+    if (ImGui::Button("Dump JSON")) this->dump_memory_report(this->memory.dump_path);
+    ImGui::SameLine();
+    ImGui::Text("%s", this->memory.dump_path.c_str());
+    ImGui::End();
+}
+
 void engine_t::draw_background(vk::CommandBuffer cmd)
 {
     compute_effect_t& selected = this->background_effects[this->current_bg_effect];
@@ -487,8 +699,163 @@ void engine_t::draw_imgui(vk::CommandBuffer cmd, vk::ImageView target_image_view
     cmd.endRendering();
 }
 
+static float halton(std::uint32_t index, std::uint32_t base)
+{
+    float f = 1.f;
+    float result = 0.f;
+    while (index > 0)
+    {
+        f /= base;
+        result += f * (index % base);
+        index /= base;
+    }
+    return result;
+}
+
+void engine_t::jitter_projection()
+{
+    gpu_scene_data_t& data = this->scene_data.gpu_data;
+    if (!this->scene_data.prev_valid) this->scene_data.prev_viewproj = data.viewproj;
+    data.unjittered_viewproj = data.viewproj;
+    data.prev_viewproj = this->scene_data.prev_viewproj;
+    this->scene_data.prev_viewproj = data.viewproj;
+    this->scene_data.prev_valid = true;
+
+    if (this->upscaler.mode != upscale_mode_e::TEMPORAL)
+    {
+        this->upscaler.jitter = glm::vec2(0.f);
+        data.jitter = glm::vec4(0.f);
+        return;
+    }
+
+    // NOTE: Every output pixel should be covered by a few samples per cycle, so the cycle grows with the upscaling ratio.
+    float ratio = float(this->swapchain.extent.width) / float(this->draw_extent.width);
+    std::uint32_t phase_count = std::max(8u, std::uint32_t(std::ceil(8.f * ratio * ratio)));
+    std::uint32_t phase = this->upscaler.jitter_index++ % phase_count;
+    this->upscaler.jitter = glm::vec2(halton(phase + 1, 2) - .5f, halton(phase + 1, 3) - .5f);
+    data.jitter = glm::vec4(this->upscaler.jitter, 0.f, 0.f);
+
+    glm::mat4 offset = glm::translate(glm::mat4(1.f), glm::vec3(2.f * this->upscaler.jitter.x / this->draw_extent.width,
+                2.f * this->upscaler.jitter.y / this->draw_extent.height, 0.f));
+    data.proj = offset * data.proj;
+    data.viewproj = offset * data.viewproj;
+}
+
+vk::ImageLayout engine_t::draw_upscale(vk::CommandBuffer cmd, std::uint32_t swapchain_img_idx)
+{
+    vk::Image swapchain_image = this->swapchain.images[swapchain_img_idx];
+    frame_data_t& frame = this->get_current_frame();
+
+    bool temporal = this->upscaler.mode == upscale_mode_e::TEMPORAL && this->upscaler.motion_written;
+    if (!temporal) this->upscaler.history_valid = false;
+
+    std::optional<vk::DescriptorSet> resolve_set, rcas_set;
+    if (this->upscaler.mode != upscale_mode_e::LINEAR)
+    {
+        resolve_set = frame.frame_descriptors.allocate(this->device.dev, temporal ? this->upscaler.taa_layout : this->upscaler.layout);
+        rcas_set = frame.frame_descriptors.allocate(this->device.dev, this->upscaler.layout);
+    }
+    if (!resolve_set.has_value() || !rcas_set.has_value())
+    {
+        vkutil::transition_image(cmd, this->draw_image.image, vk::ImageLayout::eColorAttachmentOptimal, vk::ImageLayout::eTransferSrcOptimal);
+        vkutil::transition_image(cmd, swapchain_image, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal);
+        vkutil::copy_image_to_image(cmd, this->draw_image.image, swapchain_image, this->draw_extent, this->swapchain.extent);
+        return vk::ImageLayout::eTransferDstOptimal;
+    }
+
+    // NOTE: `update_render_targets` keeps the intermediate images at least the size of the swapchain, the clamp only guards the final blit.
+    vk::Extent2D output_extent(std::min(this->swapchain.extent.width, this->upscaler.image.extent.width),
+            std::min(this->swapchain.extent.height, this->upscaler.image.extent.height));
+    bool direct = this->swapchain.storage && output_extent == this->swapchain.extent;
+    std::uint32_t group_x = (output_extent.width + 15) / 16;
+    std::uint32_t group_y = (output_extent.height + 15) / 16;
+
+    vkutil::transition_image(cmd, this->draw_image.image, vk::ImageLayout::eColorAttachmentOptimal, vk::ImageLayout::eGeneral);
+
+    // the image the sharpening pass reads from
+    allocated_image_t& resolved = temporal ? this->upscaler.history[this->upscaler.history_index] : this->upscaler.image;
+    if (temporal)
+    {
+        allocated_image_t& history = this->upscaler.history[this->upscaler.history_index ^ 1];
+        bool reset = !this->upscaler.history_valid;
+
+        descriptor_writer_t writer;
+        writer.write_image(0, this->draw_image.view, VK_NULL_HANDLE, vk::ImageLayout::eGeneral, vk::DescriptorType::eStorageImage);
+        writer.write_image(1, this->upscaler.motion_image.view, this->upscaler.sampler, vk::ImageLayout::eGeneral, vk::DescriptorType::eCombinedImageSampler);
+        writer.write_image(2, history.view, this->upscaler.sampler, vk::ImageLayout::eGeneral, vk::DescriptorType::eCombinedImageSampler);
+        writer.write_image(3, resolved.view, VK_NULL_HANDLE, vk::ImageLayout::eGeneral, vk::DescriptorType::eStorageImage);
+        writer.update_set(this->device.dev, resolve_set.value());
+
+        vkutil::transition_image(cmd, this->upscaler.motion_image.image, vk::ImageLayout::eColorAttachmentOptimal, vk::ImageLayout::eGeneral);
+        vkutil::transition_image(cmd, resolved.image, vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral);
+        if (reset) vkutil::transition_image(cmd, history.image, vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral);
+
+        taa_push_constants_t push_constants{ .input_extent = glm::ivec2(this->draw_extent.width, this->draw_extent.height),
+            .output_extent = glm::ivec2(output_extent.width, output_extent.height), .jitter = this->upscaler.jitter,
+            .blend = this->upscaler.blend, .reset = reset ? 1u : 0u };
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, this->upscaler.taa_pipeline);
+        cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, this->upscaler.taa_pipeline_layout, 0, resolve_set.value(), {});
+        cmd.pushConstants(this->upscaler.taa_pipeline_layout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(taa_push_constants_t), &push_constants);
+        cmd.dispatch(group_x, group_y, 1);
+
+        this->upscaler.history_index ^= 1;
+        this->upscaler.history_valid = true;
+    }
+    else
+    {
+        descriptor_writer_t writer;
+        writer.write_image(0, this->draw_image.view, VK_NULL_HANDLE, vk::ImageLayout::eGeneral, vk::DescriptorType::eStorageImage);
+        writer.write_image(1, resolved.view, VK_NULL_HANDLE, vk::ImageLayout::eGeneral, vk::DescriptorType::eStorageImage);
+        writer.update_set(this->device.dev, resolve_set.value());
+
+        vkutil::transition_image(cmd, resolved.image, vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral);
+
+        upscale_push_constants_t push_constants{ .input_extent = glm::ivec2(this->draw_extent.width, this->draw_extent.height),
+            .output_extent = glm::ivec2(output_extent.width, output_extent.height), .sharpness = this->upscaler.sharpness };
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, this->upscaler.easu_pipeline);
+        cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, this->upscaler.pipeline_layout, 0, resolve_set.value(), {});
+        cmd.pushConstants(this->upscaler.pipeline_layout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(upscale_push_constants_t), &push_constants);
+        cmd.dispatch(group_x, group_y, 1);
+    }
+
+    {
+        descriptor_writer_t writer;
+        writer.write_image(0, resolved.view, VK_NULL_HANDLE, vk::ImageLayout::eGeneral, vk::DescriptorType::eStorageImage);
+        writer.write_image(1, direct ? this->swapchain.views[swapchain_img_idx] : this->draw_image.view, VK_NULL_HANDLE, vk::ImageLayout::eGeneral,
+                vk::DescriptorType::eStorageImage);
+        writer.update_set(this->device.dev, rcas_set.value());
+    }
+
+    vkutil::transition_image(cmd, resolved.image, vk::ImageLayout::eGeneral, vk::ImageLayout::eGeneral);
+    if (direct)
+    {
+        vkutil::transition_image(cmd, swapchain_image, vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral);
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, this->upscaler.rcas_present_pipeline);
+    }
+    else
+    {
+        // NOTE: The draw image has been consumed by the resolve, so it is reused as the target of the sharpening pass.
+        vkutil::transition_image(cmd, this->draw_image.image, vk::ImageLayout::eGeneral, vk::ImageLayout::eGeneral);
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, this->upscaler.rcas_pipeline);
+    }
+    upscale_push_constants_t push_constants{ .input_extent = glm::ivec2(this->draw_extent.width, this->draw_extent.height),
+        .output_extent = glm::ivec2(output_extent.width, output_extent.height), .sharpness = this->upscaler.sharpness };
+    cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, this->upscaler.pipeline_layout, 0, rcas_set.value(), {});
+    cmd.pushConstants(this->upscaler.pipeline_layout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(upscale_push_constants_t), &push_constants);
+    cmd.dispatch(group_x, group_y, 1);
+
+    if (direct) return vk::ImageLayout::eGeneral;
+
+    vkutil::transition_image(cmd, this->draw_image.image, vk::ImageLayout::eGeneral, vk::ImageLayout::eTransferSrcOptimal);
+    vkutil::transition_image(cmd, swapchain_image, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal);
+    vkutil::copy_image_to_image(cmd, this->draw_image.image, swapchain_image, output_extent, this->swapchain.extent);
+    return vk::ImageLayout::eTransferDstOptimal;
+}
+
 bool engine_t::draw()
 {
+    this->uploads.collect();
+    this->collect_retired();
     this->update_scene();
 
     vk::Result result = this->device.dev.waitForFences(this->get_current_frame().render_fence, true, 1000000000);
@@ -500,6 +867,32 @@ bool engine_t::draw()
 
     this->get_current_frame().deletion_queue.flush();
     this->get_current_frame().frame_descriptors.clear_pools(this->device.dev);
+    this->get_current_frame().descriptor_ring.reset();
+    this->update_residency();
+    this->update_texture_streaming();
+    // NOTE: The depth pre-pass stores depth for the main pass, so depth only stays in tile memory without it.
+    for (auto& [image, info] : this->transients.declared)
+    {
+        if (image != &this->depth_image || info.tile_only == !this->depth_prepass) continue;
+        info.tile_only = !this->depth_prepass;
+        this->transients.dirty = true;
+    }
+    if (this->transients.dirty && !this->create_transient_images()) return false;
+
+    // NOTE: The render fence has been waited on, so the timestamps of this frame are available without stalling.
+    frame_data_t& frame = this->get_current_frame();
+    if (frame.timestamps_written)
+    {
+        frame.timestamps_written = false;
+        std::array<std::uint64_t, 2> timestamps;
+        result = this->device.dev.getQueryPoolResults(frame.timestamp_pool, 0, timestamps.size(), sizeof(timestamps), timestamps.data(),
+                sizeof(std::uint64_t), vk::QueryResultFlagBits::e64);
+        if (result == vk::Result::eSuccess)
+        {
+            this->stats.gpu_frame_time = ((timestamps[1] - timestamps[0]) & this->timestamp_mask) * this->timestamp_period / 1000000.f;
+            this->governor.update(this->stats.gpu_frame_time);
+        }
+    }
 
     std::uint32_t swapchain_img_idx;
     std::tie(result, swapchain_img_idx) = this->device.dev.acquireNextImageKHR(this->swapchain.swapchain, 1000000000,
@@ -515,8 +908,10 @@ bool engine_t::draw()
         return false;
     }
 
-    this->draw_extent.width = std::min(this->swapchain.extent.width, this->draw_image.extent.width) * this->render_scale;
-    this->draw_extent.height = std::min(this->swapchain.extent.height, this->draw_image.extent.height) * this->render_scale;
+    this->render_scale = std::clamp(this->render_scale, MIN_RENDER_SCALE, 1.f);
+    this->draw_extent.width = std::max(1.f, std::min(this->swapchain.extent.width, this->draw_image.extent.width) * this->render_scale);
+    this->draw_extent.height = std::max(1.f, std::min(this->swapchain.extent.height, this->draw_image.extent.height) * this->render_scale);
+    this->jitter_projection();
 
     if ((result = this->device.dev.resetFences(this->get_current_frame().render_fence)) != vk::Result::eSuccess)
     {
@@ -538,6 +933,16 @@ bool engine_t::draw()
         return false;
     }
 
+    if (frame.timestamp_pool)
+    {
+        cmd.resetQueryPool(frame.timestamp_pool, 0, 2);
+        cmd.writeTimestamp2(vk::PipelineStageFlagBits2::eNone, frame.timestamp_pool, 0);
+    }
+
+    this->update_defragmentation(cmd);
+
+    this->compute_submitted = this->use_async_compute && frame.compute_buffer;
+    this->upscaler.motion_written = false;
     vk::ImageLayout final_layout = this->draw_cmd(cmd, swapchain_img_idx);
 
     if (this->use_imgui)
@@ -551,16 +956,69 @@ bool engine_t::draw()
         vkutil::transition_image(cmd, this->swapchain.images[swapchain_img_idx], final_layout, vk::ImageLayout::ePresentSrcKHR);
     }
 
+    if (frame.timestamp_pool)
+    {
+        cmd.writeTimestamp2(vk::PipelineStageFlagBits2::eAllCommands, frame.timestamp_pool, 1);
+        frame.timestamps_written = true;
+    }
+
     if (result = cmd.end(); result != vk::Result::eSuccess)
     {
         fmt::print(stderr, "[ {} ]\tFailed to end recording command buffer!\n", ERROR_FMT("ERROR"));
         return false;
     }
 
+    std::vector<vk::SemaphoreSubmitInfo> wait_infos = {
+        vk::SemaphoreSubmitInfo(this->get_current_frame().swapchain_semaphore, 1, vk::PipelineStageFlagBits2::eColorAttachmentOutput, 0)
+    };
+    if (this->compute_submitted)
+    {
+        vk::CommandBuffer compute_buffer = frame.compute_buffer;
+        if (result = compute_buffer.reset(); result != vk::Result::eSuccess)
+        {
+            fmt::print(stderr, "[ {} ]\tFailed to reset command buffer!\n", ERROR_FMT("ERROR"));
+            return false;
+        }
+        if (result = compute_buffer.begin(&begin_info); result != vk::Result::eSuccess)
+        {
+            fmt::print(stderr, "[ {} ]\tFailed to begin recording command buffer!\n", ERROR_FMT("ERROR"));
+            return false;
+        }
+        this->compute_cmd(compute_buffer);
+        if (result = compute_buffer.end(); result != vk::Result::eSuccess)
+        {
+            fmt::print(stderr, "[ {} ]\tFailed to end recording command buffer!\n", ERROR_FMT("ERROR"));
+            return false;
+        }
+
+        // NOTE: Resources like the draw image are shared by all frames, so the compute work has to wait for the graphics work
+        // of the previous frame. The graphics work of this frame only waits where the draw image is first rendered to, so
+        // e.g. the depth pre-pass overlaps with the compute work.
+        vk::CommandBufferSubmitInfo compute_cmd_info(compute_buffer);
+        vk::SemaphoreSubmitInfo compute_wait_info(this->frame_timeline, this->frame_timeline_value, vk::PipelineStageFlagBits2::eAllCommands, 0);
+        vk::SemaphoreSubmitInfo compute_signal_info(frame.compute_semaphore, 1, vk::PipelineStageFlagBits2::eAllCommands, 0);
+        vk::SubmitInfo2 compute_submit({}, compute_wait_info, compute_cmd_info, compute_signal_info);
+        if (result = this->device.compute.queue.submit2(compute_submit); result != vk::Result::eSuccess)
+        {
+            fmt::print(stderr, "[ {} ]\tFailed to submit to compute queue!\n", ERROR_FMT("ERROR"));
+            return false;
+        }
+        wait_infos.push_back(vk::SemaphoreSubmitInfo(frame.compute_semaphore, 1, vk::PipelineStageFlagBits2::eColorAttachmentOutput, 0));
+    }
+
+    // NOTE: Uploads recorded since the last frame, e.g. by `load_model`, are submitted once per frame.
+    if (!this->uploads.flush()) return false;
+    // NOTE: Drawn surfaces only use uploads up to `completed`, which has already been reached. The wait never blocks, it makes the copies
+    // of the transfer queue visible to this submission.
+    if (this->uploads.completed > 0)
+        wait_infos.push_back(vk::SemaphoreSubmitInfo(this->uploads.timeline, this->uploads.completed, vk::PipelineStageFlagBits2::eAllCommands, 0));
+
     vk::CommandBufferSubmitInfo cmd_info(cmd);
-    vk::SemaphoreSubmitInfo wait_info(this->get_current_frame().swapchain_semaphore, 1, vk::PipelineStageFlagBits2::eColorAttachmentOutput, 0);
-    vk::SemaphoreSubmitInfo signal_info(this->get_current_frame().render_semaphore, 1, vk::PipelineStageFlagBits2::eAllGraphics, 0);
-    vk::SubmitInfo2 submit({}, wait_info, cmd_info, signal_info);
+    std::array<vk::SemaphoreSubmitInfo, 2> signal_infos = {
+        vk::SemaphoreSubmitInfo(this->get_current_frame().render_semaphore, 1, vk::PipelineStageFlagBits2::eAllGraphics, 0),
+        vk::SemaphoreSubmitInfo(this->frame_timeline, ++this->frame_timeline_value, vk::PipelineStageFlagBits2::eAllCommands, 0)
+    };
+    vk::SubmitInfo2 submit({}, wait_infos, cmd_info, signal_infos);
     if (result = this->device.graphics.queue.submit2(submit, this->get_current_frame().render_fence); result != vk::Result::eSuccess)
     {
         fmt::print(stderr, "[ {} ]\tFailed to submit to graphics queue!\n", ERROR_FMT("ERROR"));
@@ -659,6 +1117,12 @@ bool engine_t::init_vulkan(std::string app_name)
                 .dynamicRendering = true })
         .set_required_features_12(VkPhysicalDeviceVulkan12Features{
                 .descriptorIndexing = true,
+                .shaderSampledImageArrayNonUniformIndexing = true,
+                .descriptorBindingSampledImageUpdateAfterBind = true,
+                .descriptorBindingUpdateUnusedWhilePending = true,
+                .descriptorBindingPartiallyBound = true,
+                .runtimeDescriptorArray = true,
+                .timelineSemaphore = true,
                 .bufferDeviceAddress = true })
         .select();
 
@@ -668,8 +1132,57 @@ bool engine_t::init_vulkan(std::string app_name)
         return false;
     }
 
-    this->physical_device = vk::PhysicalDevice(phys_ret.value());
-    vkb::DeviceBuilder device_builder{ phys_ret.value() };
+    vkb::PhysicalDevice vkb_physical_device = phys_ret.value();
+    this->device.extensions.push_descriptor = vkb_physical_device.enable_extension_if_present(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+    this->device.extensions.memory_budget = vkb_physical_device.enable_extension_if_present(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+    this->physical_device = vk::PhysicalDevice(vkb_physical_device);
+
+    // NOTE: Lets the upscaler write into the swapchain, whose format is not known when the shaders are compiled.
+    this->device.extensions.storage_write_without_format = this->physical_device.getFeatures().shaderStorageImageWriteWithoutFormat;
+    vkb_physical_device.features.shaderStorageImageWriteWithoutFormat = this->device.extensions.storage_write_without_format;
+    this->device.extensions.texture_compression_bc = this->physical_device.getFeatures().textureCompressionBC;
+    vkb_physical_device.features.textureCompressionBC = this->device.extensions.texture_compression_bc;
+
+    // NOTE: Has to outlive `device_builder.build()` since it is chained into the device create info.
+    vk::PhysicalDeviceDescriptorBufferFeaturesEXT descriptor_buffer_features;
+    if (this->descriptor_backend == descriptor_backend_e::BUFFER)
+    {
+        vk::PhysicalDeviceFeatures2 features({}, &descriptor_buffer_features);
+        this->physical_device.getFeatures2(&features);
+        this->device.extensions.descriptor_buffer = descriptor_buffer_features.descriptorBuffer
+            && vkb_physical_device.enable_extension_if_present(VK_EXT_DESCRIPTOR_BUFFER_EXTENSION_NAME);
+        if (!this->device.extensions.descriptor_buffer)
+        {
+            fmt::print("[ {} ]\tDescriptor buffers are not supported, falling back to descriptor pools.\n", WARN_FMT("WARNING"));
+            this->descriptor_backend = descriptor_backend_e::POOL;
+        }
+        descriptor_buffer_features = vk::PhysicalDeviceDescriptorBufferFeaturesEXT();
+        descriptor_buffer_features.descriptorBuffer = true;
+    }
+
+    // NOTE: Textures are only copied from host memory if they can be written in the layout they are sampled in.
+    vk::PhysicalDeviceHostImageCopyFeaturesEXT host_image_copy_features;
+    {
+        vk::PhysicalDeviceFeatures2 features({}, &host_image_copy_features);
+        this->physical_device.getFeatures2(&features);
+        vk::PhysicalDeviceHostImageCopyPropertiesEXT host_image_copy_props;
+        vk::PhysicalDeviceProperties2 props({}, &host_image_copy_props);
+        this->physical_device.getProperties2(&props);
+        std::vector<vk::ImageLayout> dst_layouts(host_image_copy_props.copyDstLayoutCount);
+        host_image_copy_props.pCopyDstLayouts = dst_layouts.data();
+        this->physical_device.getProperties2(&props);
+
+        bool read_only_dst = std::find(dst_layouts.begin(), dst_layouts.end(), vk::ImageLayout::eShaderReadOnlyOptimal) != dst_layouts.end();
+        this->device.extensions.host_image_copy = host_image_copy_features.hostImageCopy && read_only_dst
+            && vkb_physical_device.enable_extension_if_present(VK_EXT_HOST_IMAGE_COPY_EXTENSION_NAME);
+        host_image_copy_features = vk::PhysicalDeviceHostImageCopyFeaturesEXT();
+        host_image_copy_features.hostImageCopy = true;
+    }
+
+    vkb::DeviceBuilder device_builder{ vkb_physical_device };
+    if (this->device.extensions.descriptor_buffer) device_builder.add_pNext(&descriptor_buffer_features);
+    if (this->device.extensions.host_image_copy) device_builder.add_pNext(&host_image_copy_features);
     vkb::Result<vkb::Device> dev_ret = device_builder.build();
     if (!dev_ret)
     {
@@ -679,6 +1192,7 @@ bool engine_t::init_vulkan(std::string app_name)
 
     vkb::Device vkb_device = dev_ret.value();
     this->device.dev = vk::Device(vkb_device.device);
+    this->dispatch.init(this->instance, vkGetInstanceProcAddr, this->device.dev, vkGetDeviceProcAddr);
 
     vkb::Result<VkQueue> gq_ret = vkb_device.get_queue(vkb::QueueType::graphics);
     if (!gq_ret)
@@ -710,78 +1224,107 @@ bool engine_t::init_vulkan(std::string app_name)
     }
     this->device.present.family_index = gqi_ret.value();
 
+    // NOTE: vk-bootstrap only returns a compute queue of a family without graphics support, e.g. not on lavapipe.
+    vkb::Result<VkQueue> cq_ret = vkb_device.get_queue(vkb::QueueType::compute);
+    vkb::Result<std::uint32_t> cqi_ret = vkb_device.get_queue_index(vkb::QueueType::compute);
+    if (cq_ret && cqi_ret)
+    {
+        this->device.compute.queue = vk::Queue(cq_ret.value());
+        this->device.compute.family_index = cqi_ret.value();
+    }
+    else
+    {
+        fmt::print("[ {} ]\tNo separate compute queue, compute passes run on the graphics queue.\n", INFO_FMT("INFO"));
+        this->device.compute = this->device.graphics;
+    }
+
+    vkb::Result<VkQueue> tq_ret = vkb_device.get_queue(vkb::QueueType::transfer);
+    vkb::Result<std::uint32_t> tqi_ret = vkb_device.get_queue_index(vkb::QueueType::transfer);
+    if (tq_ret && tqi_ret)
+    {
+        this->device.transfer.queue = vk::Queue(tq_ret.value());
+        this->device.transfer.family_index = tqi_ret.value();
+    }
+    else
+    {
+        fmt::print("[ {} ]\tNo separate transfer queue, uploads run on the graphics queue.\n", INFO_FMT("INFO"));
+        this->device.transfer = this->device.graphics;
+    }
+
     VmaAllocatorCreateInfo allocator_info = {};
     allocator_info.physicalDevice = this->physical_device;
     allocator_info.device = this->device.dev;
     allocator_info.instance = this->instance;
+    allocator_info.vulkanApiVersion = VK_API_VERSION_1_3;
     allocator_info.flags = VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;
+    // NOTE: Without the extension the heap budgets are estimated from the allocations of VMA and a fraction of the heap sizes.
+    if (this->device.extensions.memory_budget) allocator_info.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
     vmaCreateAllocator(&allocator_info, &this->allocator);
 
     this->main_deletion_queue.push_function([&]() {
+            this->report_leaks();
             vmaDestroyAllocator(this->allocator);
             });
 
-    if (!this->create_swapchain(this->window.width, this->window.height)) return false;
-
-    // get screen resolution
-    const GLFWvidmode* mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
-
-    this->draw_image.extent = vk::Extent3D(mode->width, mode->height, 1);//this->window.width, this->window.height, 1);
-    this->draw_image.format = vk::Format::eR16G16B16A16Sfloat;
-    vk::ImageCreateInfo rimg_info({}, vk::ImageType::e2D, this->draw_image.format, this->draw_image.extent, 1, 1, vk::SampleCountFlagBits::e1, vk::ImageTiling::eOptimal,
-            vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eColorAttachment);
-    VmaAllocationCreateInfo rimg_alloc_info = {};
-    rimg_alloc_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
-    rimg_alloc_info.requiredFlags = VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    vmaCreateImage(this->allocator, (VkImageCreateInfo*)&rimg_info, &rimg_alloc_info, (VkImage*)&this->draw_image.image, &this->draw_image.allocation, nullptr);
-
-    vk::ImageViewCreateInfo rview_info({}, this->draw_image.image, vk::ImageViewType::e2D, this->draw_image.format, {},
-            vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1));
-    vk::Result result;
-    std::tie(result, this->draw_image.view) = this->device.dev.createImageView(rview_info);
-    if (result != vk::Result::eSuccess)
+    // NOTE: The pool takes the memory type of sampled optimal tiling images, textures of other memory types are not pooled.
+    if (this->defrag.enabled)
     {
-        fmt::print(stderr, "[ {} ]\tCreating render image view failed.\n", ERROR_FMT("ERROR"));
-        return false;
+        vk::ImageCreateInfo img_info({}, vk::ImageType::e2D, vk::Format::eR8G8B8A8Unorm, vk::Extent3D(1, 1, 1), 1, 1, vk::SampleCountFlagBits::e1,
+                vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eTransferSrc);
+        VmaAllocationCreateInfo alloc_info = { .usage = VMA_MEMORY_USAGE_AUTO, .requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT };
+        VmaPoolCreateInfo pool_info = {};
+        if (vmaFindMemoryTypeIndexForImageInfo(this->allocator, (VkImageCreateInfo*)&img_info, &alloc_info, &pool_info.memoryTypeIndex) != VK_SUCCESS
+                || vmaCreatePool(this->allocator, &pool_info, &this->defrag.pool) != VK_SUCCESS)
+        {
+            fmt::print(stderr, "[ {} ]\tFailed to create texture pool, textures are not defragmented!\n", WARN_FMT("WARNING"));
+            this->defrag.pool = nullptr;
+        }
+        else
+        {
+            vmaSetPoolName(this->allocator, this->defrag.pool, "textures");
+            this->main_deletion_queue.push_function([&]() { vmaDestroyPool(this->allocator, this->defrag.pool); });
+        }
     }
 
-    this->depth_image.format = vk::Format::eD32Sfloat;
-    this->depth_image.extent = this->draw_image.extent;
-    vk::ImageCreateInfo dimg_info({}, vk::ImageType::e2D, this->depth_image.format, this->depth_image.extent, 1, 1, vk::SampleCountFlagBits::e1,
-        vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eDepthStencilAttachment);
-    vmaCreateImage(this->allocator, (VkImageCreateInfo*)&dimg_info, &rimg_alloc_info, (VkImage*)&this->depth_image.image, &this->depth_image.allocation, nullptr);
+    if (!this->create_swapchain(this->window.width, this->window.height)) return false;
 
-    vk::ImageViewCreateInfo dview_info({}, this->depth_image.image, vk::ImageViewType::e2D, this->depth_image.format, {},
-            vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eDepth, 0, 1, 0, 1));
-    std::tie(result, this->depth_image.view) = this->device.dev.createImageView(dview_info);
-    if (result != vk::Result::eSuccess)
-    {
-        fmt::print(stderr, "[ {} ]\tCreating depth image view failed.\n", ERROR_FMT("ERROR"));
-        return false;
-    }
+    this->draw_image.format = vk::Format::eR16G16B16A16Sfloat;
+    if (!this->create_render_targets(this->swapchain.extent)) return false;
+
+    // NOTE: Depth is cleared and discarded within the geometry pass, so it never has to leave tile memory unless the depth
+    // pre-pass stores it for the main pass. `draw` keeps this in sync with `depth_prepass`.
+    this->declare_transient_image(&this->depth_image, transient_image_info_t{ .format = vk::Format::eD32Sfloat,
+            .usage = vk::ImageUsageFlagBits::eDepthStencilAttachment, .first_pass = frame_pass_e::GEOMETRY, .last_pass = frame_pass_e::GEOMETRY,
+            .tile_only = !this->depth_prepass });
 
     this->main_deletion_queue.push_function([=, this]() {
-            this->device.dev.destroyImageView(this->draw_image.view);
-            vmaDestroyImage(this->allocator, (VkImage)this->draw_image.image, this->draw_image.allocation);
-            
-            this->device.dev.destroyImageView(this->depth_image.view);
-            vmaDestroyImage(this->allocator, (VkImage)this->depth_image.image, this->depth_image.allocation);
+            this->destroy_render_targets();
+            this->destroy_transient_images();
             });
 
     if (!this->init_commands()) return false;
     if (!this->init_sync_structures()) return false;
+    if (!this->uploads.init(this->device.dev, this->allocator, this->device.transfer.queue, this->device.transfer.family_index,
+                this->device.graphics.queue, this->device.graphics.family_index)) return false;
+    this->main_deletion_queue.push_function([&]() { this->uploads.destroy(); });
+    if (!this->init_mip_generator()) return false;
     if (!this->init_descriptors()) return false;
+    if (!this->init_geometry_pool()) return false;
+    if (!this->init_upscaler()) return false;
     if (!this->init_pipelines()) return false;
     if (this->use_imgui)
     {
         if (!this->init_imgui()) return false;
     }
     if (!this->init_default_data()) return false;
+    this->jobs.init();
     
     this->scene_data.gpu_data.ambient_color = glm::vec4(.1f);
     this->scene_data.gpu_data.sunlight_color = glm::vec4(glm::vec3(.5f), 1.f);
     this->scene_data.gpu_data.sunlight_dir = glm::vec4(0, 1, 0.5, 1.f);
 
+    this->governor.register_knob("Render Scale", &this->render_scale, MIN_RENDER_SCALE, 1.f);
+
     this->initialized = true;
     return true;
 }
@@ -807,6 +1350,24 @@ bool engine_t::init_commands()
             return false;
         }
         this->frames[i].buffer = buf[0];
+
+        if (this->device.compute.family_index == this->device.graphics.family_index) continue;
+
+        vk::CommandPoolCreateInfo compute_pool_info(vk::CommandPoolCreateFlagBits::eResetCommandBuffer, this->device.compute.family_index);
+        std::tie(result, this->frames[i].compute_pool) = this->device.dev.createCommandPool(compute_pool_info);
+        if (result != vk::Result::eSuccess)
+        {
+            fmt::print(stderr, "[ {} ]\tFailed to create command pool!\n", ERROR_FMT("ERROR"));
+            return false;
+        }
+        vk::CommandBufferAllocateInfo compute_alloc_info(this->frames[i].compute_pool, vk::CommandBufferLevel::ePrimary, 1);
+        std::tie(result, buf) = this->device.dev.allocateCommandBuffers(compute_alloc_info);
+        if (result != vk::Result::eSuccess)
+        {
+            fmt::print(stderr, "[ {} ]\tFailed to create command buffer!\n", ERROR_FMT("ERROR"));
+            return false;
+        }
+        this->frames[i].compute_buffer = buf[0];
     }
 
     std::tie(result, this->imm_submit.pool) = this->device.dev.createCommandPool(pool_info);
@@ -828,6 +1389,26 @@ bool engine_t::init_commands()
             this->device.dev.destroyCommandPool(this->imm_submit.pool);
             });
 
+    std::uint32_t valid_bits = this->physical_device.getQueueFamilyProperties()[this->device.graphics.family_index].timestampValidBits;
+    if (valid_bits == 0)
+    {
+        fmt::print("[ {} ]\tThe graphics queue does not support timestamps, GPU frame times are not measured.\n", WARN_FMT("WARNING"));
+        return true;
+    }
+    this->timestamp_period = this->physical_device.getProperties().limits.timestampPeriod;
+    this->timestamp_mask = (valid_bits >= 64) ? ~std::uint64_t(0) : (std::uint64_t(1) << valid_bits) - 1;
+
+    vk::QueryPoolCreateInfo query_info({}, vk::QueryType::eTimestamp, 2);
+    for (std::size_t i = 0; i < FRAME_OVERLAP; ++i)
+    {
+        std::tie(result, this->frames[i].timestamp_pool) = this->device.dev.createQueryPool(query_info);
+        if (result != vk::Result::eSuccess)
+        {
+            fmt::print(stderr, "[ {} ]\tFailed to create timestamp query pool!\n", ERROR_FMT("ERROR"));
+            return false;
+        }
+    }
+
     return true;
 }
 
@@ -856,6 +1437,22 @@ bool engine_t::init_sync_structures()
             fmt::print(stderr, "[ {} ]\tFailed to create swapchain semaphore!\n", ERROR_FMT("ERROR"));
             return false;
         }
+        if (this->device.compute.family_index == this->device.graphics.family_index) continue;
+        std::tie(result, this->frames[i].compute_semaphore) = this->device.dev.createSemaphore(semaphore_info);
+        if (result != vk::Result::eSuccess)
+        {
+            fmt::print(stderr, "[ {} ]\tFailed to create compute semaphore!\n", ERROR_FMT("ERROR"));
+            return false;
+        }
+    }
+
+    vk::SemaphoreTypeCreateInfo timeline_type_info(vk::SemaphoreType::eTimeline, 0);
+    vk::SemaphoreCreateInfo timeline_info({}, &timeline_type_info);
+    std::tie(result, this->frame_timeline) = this->device.dev.createSemaphore(timeline_info);
+    if (result != vk::Result::eSuccess)
+    {
+        fmt::print(stderr, "[ {} ]\tFailed to create timeline semaphore!\n", ERROR_FMT("ERROR"));
+        return false;
     }
     
     std::tie(result, this->imm_submit.fence) = this->device.dev.createFence(fence_info);
@@ -866,6 +1463,7 @@ bool engine_t::init_sync_structures()
     }
     this->main_deletion_queue.push_function([=, this]() {
             this->device.dev.destroyFence(this->imm_submit.fence);
+            this->device.dev.destroySemaphore(this->frame_timeline);
             });
 
     return true;
@@ -873,7 +1471,10 @@ bool engine_t::init_sync_structures()
 
 bool engine_t::init_descriptors()
 {
-    std::vector<descriptor_allocator_growable_t::pool_size_ratio_t> sizes = { { vk::DescriptorType::eStorageImage, 1 } };
+    std::vector<descriptor_allocator_growable_t::pool_size_ratio_t> sizes = {
+        { vk::DescriptorType::eStorageImage, 1 },
+        { vk::DescriptorType::eUniformBuffer, 1 }
+    };
     if (!this->global_descriptor_allocator.init(this->device.dev, 10, sizes)) return false;
 
     {
@@ -884,13 +1485,18 @@ bool engine_t::init_descriptors()
     }
 
     {
+        vk::DescriptorSetLayoutCreateFlags flags = {};
+        if (this->descriptor_backend == descriptor_backend_e::BUFFER) flags = vk::DescriptorSetLayoutCreateFlagBits::eDescriptorBufferEXT;
+        else if (this->device.extensions.push_descriptor) flags = vk::DescriptorSetLayoutCreateFlagBits::ePushDescriptorKHR;
         descriptor_layout_builder_t builder;
         auto ret = builder.add_binding(0, vk::DescriptorType::eUniformBuffer)
-            .build(this->device.dev, vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment);
+            .build(this->device.dev, vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, flags);
         if (!ret.has_value()) return false;
         this->scene_data.layout = ret.value();
     }
 
+    if (!this->init_bindless_descriptors()) return false;
+
     auto ret = this->global_descriptor_allocator.allocate(this->device.dev, this->draw_descriptor.layout);
     if (!ret.has_value()) return false;
     this->draw_descriptor.set = ret.value();
@@ -913,7 +1519,26 @@ bool engine_t::init_descriptors()
         this->frames[i].frame_descriptors = descriptor_allocator_growable_t{};
         if (!this->frames[i].frame_descriptors.init(this->device.dev, 1000, frame_sizes)) return false;
 
+        auto ret_buf = this->create_buffer(sizeof(gpu_scene_data_t), vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eShaderDeviceAddress,
+                VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
+        if (!ret_buf.has_value()) return false;
+        this->frames[i].scene_buffer = ret_buf.value();
+        this->track_allocation(this->frames[i].scene_buffer.allocation, memory_category_e::FRAME, "scene buffer");
+
+        // NOTE: Without push descriptors every frame gets a persistent set that always points at its own scene buffer.
+        if (this->descriptor_backend == descriptor_backend_e::POOL && !this->device.extensions.push_descriptor)
+        {
+            auto ret_set = this->global_descriptor_allocator.allocate(this->device.dev, this->scene_data.layout);
+            if (!ret_set.has_value()) return false;
+            this->frames[i].scene_set = ret_set.value();
+
+            descriptor_writer_t writer;
+            writer.write_buffer(0, this->frames[i].scene_buffer.buffer, sizeof(gpu_scene_data_t), 0, vk::DescriptorType::eUniformBuffer);
+            writer.update_set(this->device.dev, this->frames[i].scene_set);
+        }
+
         this->main_deletion_queue.push_function([&, i]() {
+                this->destroy_buffer(this->frames[i].scene_buffer);
                 this->frames[i].frame_descriptors.destroy_pools(this->device.dev);
                 });
     }
@@ -927,16 +1552,190 @@ bool engine_t::init_descriptors()
     return true;
 }
 
-bool engine_t::init_background_pipelines()
+bool engine_t::init_bindless_descriptors()
 {
-    vk::Result result;
-    vk::PushConstantRange push_constant(vk::ShaderStageFlagBits::eCompute, 0, sizeof(compute_push_constants_t));
-    vk::PipelineLayoutCreateInfo compute_layout({}, this->draw_descriptor.layout, push_constant);
-    std::tie(result, this->gradient_pipeline.layout) = this->device.dev.createPipelineLayout(compute_layout);
-    if (result != vk::Result::eSuccess)
+    vk::PhysicalDeviceDescriptorBufferPropertiesEXT descriptor_buffer_props;
+    vk::PhysicalDeviceDescriptorIndexingProperties indexing_props;
+    vk::PhysicalDeviceProperties2 props({}, &indexing_props);
+    // NOTE: The descriptor buffer properties may only be chained if the extension is enabled.
+    if (this->descriptor_backend == descriptor_backend_e::BUFFER) indexing_props.pNext = &descriptor_buffer_props;
+    this->physical_device.getProperties2(&props);
+
+    this->bindless.materials.capacity = BINDLESS_MAX_MATERIALS;
+    if (this->descriptor_backend == descriptor_backend_e::BUFFER)
     {
-        fmt::print(stderr, "[ {} ]\tFailed to create pipeline layout!\n", ERROR_FMT("ERROR"));
-        return false;
+        // NOTE: Descriptor buffer layouts can not use update-after-bind, but are bound to the regular per-stage limits instead.
+        this->bindless.textures.capacity = std::min(BINDLESS_MAX_TEXTURES, props.properties.limits.maxPerStageDescriptorSampledImages);
+        this->bindless.samplers.capacity = std::min(BINDLESS_MAX_SAMPLERS, props.properties.limits.maxPerStageDescriptorSamplers);
+    }
+    else
+    {
+        this->bindless.textures.capacity = std::min(BINDLESS_MAX_TEXTURES, indexing_props.maxDescriptorSetUpdateAfterBindSampledImages);
+        this->bindless.samplers.capacity = std::min(BINDLESS_MAX_SAMPLERS, indexing_props.maxDescriptorSetUpdateAfterBindSamplers);
+    }
+
+    {
+        vk::DescriptorBindingFlags array_flags = vk::DescriptorBindingFlagBits::ePartiallyBound | vk::DescriptorBindingFlagBits::eUpdateAfterBind
+            | vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending;
+        vk::DescriptorSetLayoutCreateFlags layout_flags = vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool;
+        if (this->descriptor_backend == descriptor_backend_e::BUFFER)
+        {
+            array_flags = vk::DescriptorBindingFlagBits::ePartiallyBound;
+            layout_flags = vk::DescriptorSetLayoutCreateFlagBits::eDescriptorBufferEXT;
+        }
+        descriptor_layout_builder_t builder;
+        auto ret = builder.add_binding(0, vk::DescriptorType::eStorageBuffer)
+            .add_binding(1, vk::DescriptorType::eSampledImage, this->bindless.textures.capacity, array_flags)
+            .add_binding(2, vk::DescriptorType::eSampler, this->bindless.samplers.capacity, array_flags)
+            .build(this->device.dev, vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, layout_flags);
+        if (!ret.has_value()) return false;
+        this->bindless.layout = ret.value();
+    }
+
+    std::size_t material_buffer_size = sizeof(gltf_metallic_roughness_t::material_constants_t) * BINDLESS_MAX_MATERIALS;
+    auto ret_buf = this->create_buffer(material_buffer_size, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eShaderDeviceAddress,
+            VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
+    if (!ret_buf.has_value()) return false;
+    this->bindless.material_buffer = ret_buf.value();
+
+    if (this->descriptor_backend == descriptor_backend_e::BUFFER)
+    {
+        // NOTE: Everything lives in one buffer since devices may only support a single bound sampler and resource descriptor buffer.
+        // [ bindless set | ring of frame 0 | ring of frame 1 | ... ]
+        vk::DeviceSize alignment = descriptor_buffer_props.descriptorBufferOffsetAlignment;
+        vk::DeviceSize set_size = this->device.dev.getDescriptorSetLayoutSizeEXT(this->bindless.layout, this->dispatch);
+        vk::DeviceSize rings_offset = (set_size + alignment - 1) / alignment * alignment;
+
+        vk::BufferUsageFlags usage = vk::BufferUsageFlagBits::eResourceDescriptorBufferEXT | vk::BufferUsageFlagBits::eSamplerDescriptorBufferEXT;
+        auto ret_desc_buf = this->create_buffer(rings_offset + DESCRIPTOR_RING_SIZE * FRAME_OVERLAP, usage | vk::BufferUsageFlagBits::eShaderDeviceAddress,
+                VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
+        if (!ret_desc_buf.has_value()) return false;
+
+        this->bindless.descriptor_buffer.init(this->device.dev, ret_desc_buf.value(), usage, descriptor_buffer_props, 0, rings_offset);
+        auto ret_offset = this->bindless.descriptor_buffer.allocate(this->device.dev, this->bindless.layout, this->dispatch);
+        if (!ret_offset.has_value()) return false;
+        this->bindless.buffer_offset = ret_offset.value();
+
+        for (std::size_t i = 0; i < FRAME_OVERLAP; ++i)
+        {
+            this->frames[i].descriptor_ring.init(this->device.dev, ret_desc_buf.value(), usage, descriptor_buffer_props,
+                    rings_offset + DESCRIPTOR_RING_SIZE * i, DESCRIPTOR_RING_SIZE);
+        }
+
+        vk::BufferDeviceAddressInfo address_info(this->bindless.material_buffer.buffer);
+        this->bindless.descriptor_buffer.write_buffer(this->device.dev, this->bindless.layout, this->bindless.buffer_offset, 0,
+                this->device.dev.getBufferAddress(&address_info), material_buffer_size, vk::DescriptorType::eStorageBuffer, this->dispatch);
+
+        this->main_deletion_queue.push_function([&]() {
+                this->destroy_buffer(this->bindless.material_buffer);
+                this->destroy_buffer(this->bindless.descriptor_buffer.buffer);
+                this->device.dev.destroyDescriptorSetLayout(this->bindless.layout);
+                });
+
+        return true;
+    }
+
+    std::vector<descriptor_allocator_t::pool_size_ratio_t> sizes = {
+        { vk::DescriptorType::eStorageBuffer, 1 },
+        { vk::DescriptorType::eSampledImage, static_cast<float>(this->bindless.textures.capacity) },
+        { vk::DescriptorType::eSampler, static_cast<float>(this->bindless.samplers.capacity) }
+    };
+    if (!this->bindless.allocator.init_pool(this->device.dev, 1, sizes, vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind)) return false;
+
+    auto ret = this->bindless.allocator.allocate(this->device.dev, this->bindless.layout);
+    if (!ret.has_value()) return false;
+    this->bindless.set = ret.value();
+
+    descriptor_writer_t writer;
+    writer.write_buffer(0, this->bindless.material_buffer.buffer, material_buffer_size, 0, vk::DescriptorType::eStorageBuffer);
+    writer.update_set(this->device.dev, this->bindless.set);
+
+    this->main_deletion_queue.push_function([&]() {
+            this->destroy_buffer(this->bindless.material_buffer);
+            this->bindless.allocator.destroy_pool(this->device.dev);
+            this->device.dev.destroyDescriptorSetLayout(this->bindless.layout);
+            });
+
+    return true;
+}
+
+std::optional<std::uint32_t> engine_t::register_texture(vk::ImageView view)
+{
+    std::lock_guard<std::mutex> lock(this->resource_mutex);
+    auto ret = this->bindless.textures.allocate();
+    if (!ret.has_value()) return std::nullopt;
+
+    if (this->descriptor_backend == descriptor_backend_e::BUFFER)
+    {
+        this->bindless.descriptor_buffer.write_image(this->device.dev, this->bindless.layout, this->bindless.buffer_offset, 1, view, VK_NULL_HANDLE,
+                vk::ImageLayout::eShaderReadOnlyOptimal, vk::DescriptorType::eSampledImage, this->dispatch, ret.value());
+        return ret.value();
+    }
+
+    descriptor_writer_t writer;
+    writer.write_image(1, view, VK_NULL_HANDLE, vk::ImageLayout::eShaderReadOnlyOptimal, vk::DescriptorType::eSampledImage, ret.value());
+    writer.update_set(this->device.dev, this->bindless.set);
+    return ret.value();
+}
+
+std::optional<std::uint32_t> engine_t::register_sampler(vk::Sampler sampler)
+{
+    std::lock_guard<std::mutex> lock(this->resource_mutex);
+    auto ret = this->bindless.samplers.allocate();
+    if (!ret.has_value()) return std::nullopt;
+
+    if (this->descriptor_backend == descriptor_backend_e::BUFFER)
+    {
+        this->bindless.descriptor_buffer.write_image(this->device.dev, this->bindless.layout, this->bindless.buffer_offset, 2, VK_NULL_HANDLE, sampler,
+                vk::ImageLayout::eUndefined, vk::DescriptorType::eSampler, this->dispatch, ret.value());
+        return ret.value();
+    }
+
+    descriptor_writer_t writer;
+    writer.write_image(2, VK_NULL_HANDLE, sampler, vk::ImageLayout::eUndefined, vk::DescriptorType::eSampler, ret.value());
+    writer.update_set(this->device.dev, this->bindless.set);
+    return ret.value();
+}
+
+std::optional<std::uint32_t> engine_t::register_material(const gltf_metallic_roughness_t::material_constants_t& constants)
+{
+    std::lock_guard<std::mutex> lock(this->resource_mutex);
+    auto ret = this->bindless.materials.allocate();
+    if (!ret.has_value()) return std::nullopt;
+
+    auto* materials = (gltf_metallic_roughness_t::material_constants_t*)this->bindless.material_buffer.info.pMappedData;
+    materials[ret.value()] = constants;
+    return ret.value();
+}
+
+void engine_t::release_texture(std::uint32_t index)
+{
+    std::lock_guard<std::mutex> lock(this->resource_mutex);
+    this->bindless.textures.release(index);
+}
+
+void engine_t::release_sampler(std::uint32_t index)
+{
+    std::lock_guard<std::mutex> lock(this->resource_mutex);
+    this->bindless.samplers.release(index);
+}
+
+void engine_t::release_material(std::uint32_t index)
+{
+    std::lock_guard<std::mutex> lock(this->resource_mutex);
+    this->bindless.materials.release(index);
+}
+
+bool engine_t::init_background_pipelines()
+{
+    vk::Result result;
+    vk::PushConstantRange push_constant(vk::ShaderStageFlagBits::eCompute, 0, sizeof(compute_push_constants_t));
+    vk::PipelineLayoutCreateInfo compute_layout({}, this->draw_descriptor.layout, push_constant);
+    std::tie(result, this->gradient_pipeline.layout) = this->device.dev.createPipelineLayout(compute_layout);
+    if (result != vk::Result::eSuccess)
+    {
+        fmt::print(stderr, "[ {} ]\tFailed to create pipeline layout!\n", ERROR_FMT("ERROR"));
+        return false;
     }
 
     std::string base_dir = BASE_DIR;
@@ -984,6 +1783,132 @@ bool engine_t::init_background_pipelines()
     return true;
 }
 
+bool engine_t::init_upscaler()
+{
+    this->declare_transient_image(&this->upscaler.image, transient_image_info_t{ .format = this->draw_image.format,
+            .usage = vk::ImageUsageFlagBits::eStorage, .first_pass = frame_pass_e::UPSCALE, .last_pass = frame_pass_e::SHARPEN });
+
+    descriptor_layout_builder_t builder;
+    auto ret_layout = builder.add_binding(0, vk::DescriptorType::eStorageImage).add_binding(1, vk::DescriptorType::eStorageImage)
+        .build(this->device.dev, vk::ShaderStageFlagBits::eCompute);
+    if (!ret_layout.has_value()) return false;
+    this->upscaler.layout = ret_layout.value();
+
+    vk::Result result;
+    vk::PushConstantRange push_constant(vk::ShaderStageFlagBits::eCompute, 0, sizeof(upscale_push_constants_t));
+    vk::PipelineLayoutCreateInfo layout_info({}, this->upscaler.layout, push_constant);
+    std::tie(result, this->upscaler.pipeline_layout) = this->device.dev.createPipelineLayout(layout_info);
+    if (result != vk::Result::eSuccess)
+    {
+        fmt::print(stderr, "[ {} ]\tFailed to create pipeline layout!\n", ERROR_FMT("ERROR"));
+        return false;
+    }
+
+    this->declare_transient_image(&this->upscaler.motion_image, transient_image_info_t{ .format = vk::Format::eR16G16Sfloat,
+            .usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled, .first_pass = frame_pass_e::GEOMETRY,
+            .last_pass = frame_pass_e::UPSCALE });
+
+    vk::SamplerCreateInfo sampler_info({}, vk::Filter::eLinear, vk::Filter::eLinear, vk::SamplerMipmapMode::eNearest,
+            vk::SamplerAddressMode::eClampToEdge, vk::SamplerAddressMode::eClampToEdge, vk::SamplerAddressMode::eClampToEdge);
+    std::tie(result, this->upscaler.sampler) = this->device.dev.createSampler(sampler_info);
+    if (result != vk::Result::eSuccess)
+    {
+        fmt::print(stderr, "[ {} ]\tFailed to create sampler!\n", ERROR_FMT("ERROR"));
+        return false;
+    }
+
+    descriptor_layout_builder_t taa_builder;
+    ret_layout = taa_builder.add_binding(0, vk::DescriptorType::eStorageImage).add_binding(1, vk::DescriptorType::eCombinedImageSampler)
+        .add_binding(2, vk::DescriptorType::eCombinedImageSampler).add_binding(3, vk::DescriptorType::eStorageImage)
+        .build(this->device.dev, vk::ShaderStageFlagBits::eCompute);
+    if (!ret_layout.has_value()) return false;
+    this->upscaler.taa_layout = ret_layout.value();
+
+    vk::PushConstantRange taa_push_constant(vk::ShaderStageFlagBits::eCompute, 0, sizeof(taa_push_constants_t));
+    vk::PipelineLayoutCreateInfo taa_layout_info({}, this->upscaler.taa_layout, taa_push_constant);
+    std::tie(result, this->upscaler.taa_pipeline_layout) = this->device.dev.createPipelineLayout(taa_layout_info);
+    if (result != vk::Result::eSuccess)
+    {
+        fmt::print(stderr, "[ {} ]\tFailed to create pipeline layout!\n", ERROR_FMT("ERROR"));
+        return false;
+    }
+
+    this->main_deletion_queue.push_function([=, this]() {
+            this->device.dev.destroyPipeline(this->upscaler.taa_pipeline);
+            this->device.dev.destroyPipelineLayout(this->upscaler.taa_pipeline_layout);
+            this->device.dev.destroyDescriptorSetLayout(this->upscaler.taa_layout);
+            this->device.dev.destroySampler(this->upscaler.sampler);
+            this->device.dev.destroyPipeline(this->upscaler.easu_pipeline);
+            this->device.dev.destroyPipeline(this->upscaler.rcas_pipeline);
+            this->device.dev.destroyPipeline(this->upscaler.rcas_present_pipeline);
+            this->device.dev.destroyPipelineLayout(this->upscaler.pipeline_layout);
+            this->device.dev.destroyDescriptorSetLayout(this->upscaler.layout);
+            });
+
+    std::string base_dir = BASE_DIR;
+    auto create_pipeline = [&](const std::string& name, vk::PipelineLayout layout) -> std::optional<vk::Pipeline>
+    {
+        auto shader = vkutil::load_shader_module((base_dir + "/tests/build/shaders/" + name).c_str(), this->device.dev);
+        if (!shader.has_value()) return std::nullopt;
+
+        vk::PipelineShaderStageCreateInfo stage_info({}, vk::ShaderStageFlagBits::eCompute, shader.value(), "main");
+        vk::ComputePipelineCreateInfo pipeline_info({}, stage_info, layout);
+        auto [result, pipeline] = this->device.dev.createComputePipeline({}, pipeline_info);
+        this->device.dev.destroyShaderModule(shader.value());
+        if (result != vk::Result::eSuccess)
+        {
+            fmt::print(stderr, "[ {} ]\tFailed to create compute pipeline!\n", ERROR_FMT("ERROR"));
+            return std::nullopt;
+        }
+        return pipeline;
+    };
+
+    auto ret = create_pipeline("easu.comp.spv", this->upscaler.pipeline_layout);
+    if (!ret.has_value()) return false;
+    this->upscaler.easu_pipeline = ret.value();
+    ret = create_pipeline("rcas.comp.spv", this->upscaler.pipeline_layout);
+    if (!ret.has_value()) return false;
+    this->upscaler.rcas_pipeline = ret.value();
+    ret = create_pipeline("taa.comp.spv", this->upscaler.taa_pipeline_layout);
+    if (!ret.has_value()) return false;
+    this->upscaler.taa_pipeline = ret.value();
+
+    // NOTE: Writing without a format is only valid if the feature is enabled, the swapchain is never used as storage otherwise.
+    if (this->device.extensions.storage_write_without_format)
+    {
+        ret = create_pipeline("rcas_present.comp.spv", this->upscaler.pipeline_layout);
+        if (!ret.has_value()) return false;
+        this->upscaler.rcas_present_pipeline = ret.value();
+    }
+
+    return true;
+}
+
+bool engine_t::init_mip_generator()
+{
+    if (!this->device.extensions.push_descriptor || !this->device.extensions.storage_write_without_format) return true;
+
+    // NOTE: Quads are reduced through shared memory if compute shaders lack quad operations.
+    vk::PhysicalDeviceSubgroupProperties subgroup_props;
+    vk::PhysicalDeviceProperties2 props({}, &subgroup_props);
+    this->physical_device.getProperties2(&props);
+    bool subgroup_quad = (subgroup_props.supportedStages & vk::ShaderStageFlagBits::eCompute)
+        && (subgroup_props.supportedOperations & vk::SubgroupFeatureFlagBits::eQuad) && subgroup_props.subgroupSize >= 4;
+
+    std::string base_dir = BASE_DIR;
+    std::string shader_path = base_dir + (subgroup_quad ? "/tests/build/shaders/downsample.comp.spv" : "/tests/build/shaders/downsample_shared.comp.spv");
+    // NOTE: Without the mip generator, mip levels are blitted.
+    if (!this->mips.init(this->device.dev, this->dispatch, shader_path))
+    {
+        this->mips.destroy();
+        fmt::print(stderr, "[ {} ]\tFailed to initialize the mip generator, falling back to blits!\n", WARN_FMT("WARNING"));
+        return true;
+    }
+    this->main_deletion_queue.push_function([&]() { this->mips.destroy(); });
+    this->uploads.mips = &this->mips;
+    return true;
+}
+
 bool engine_t::init_imgui()
 {
     vk::DescriptorPoolSize pool_sizes[] = {
@@ -1061,6 +1986,8 @@ bool engine_t::init_default_data()
     auto err_img = this->create_image(pixels.data(), vk::Extent3D(16, 16, 1), vk::Format::eR8G8B8A8Unorm, vk::ImageUsageFlagBits::eSampled);
     if (!err_img.has_value()) return false;
     this->error_checkerboard_image = err_img.value();
+    // NOTE: Materials fall back to the default textures, so they have to be ready before anything is drawn.
+    if (!this->uploads.wait(this->error_checkerboard_image.ticket)) return false;
 
     vk::Result result;
     vk::SamplerCreateInfo sampler({}, vk::Filter::eNearest, vk::Filter::eNearest);
@@ -1079,6 +2006,19 @@ bool engine_t::init_default_data()
         return false;
     }
 
+    auto ret_idx = this->register_texture(this->white_image.view);
+    if (!ret_idx.has_value()) return false;
+    this->bindless.white_texture = ret_idx.value();
+    ret_idx = this->register_texture(this->error_checkerboard_image.view);
+    if (!ret_idx.has_value()) return false;
+    this->bindless.error_texture = ret_idx.value();
+    ret_idx = this->register_sampler(this->default_sampler_linear);
+    if (!ret_idx.has_value()) return false;
+    this->bindless.linear_sampler = ret_idx.value();
+    ret_idx = this->register_sampler(this->default_sampler_nearest);
+    if (!ret_idx.has_value()) return false;
+    this->bindless.nearest_sampler = ret_idx.value();
+
     this->main_deletion_queue.push_function([&]() {
             this->destroy_image(this->white_image);
             this->destroy_image(this->grey_image);
@@ -1091,154 +2031,847 @@ bool engine_t::init_default_data()
     return true;
 }
 
-bool engine_t::load_model(std::string path, std::string name, std::array<std::uint32_t, 3> bindings)
+bool engine_t::load_model(std::string path, std::string name, vertex_format_e format)
 {
-    auto structured_file = load_gltf(this, path, this->metal_rough_material, bindings);
+    auto structured_file = load_gltf(this, path, this->metal_rough_material, format);
     if (!structured_file.has_value()) return false;
     this->loaded_scenes[name] = structured_file.value();
     return true;
 }
 
-bool engine_t::load_model(std::string path, std::string name, gltf_metallic_roughness_t& material, std::array<std::uint32_t, 3> bindings)
+bool engine_t::load_model(std::string path, std::string name, gltf_metallic_roughness_t& material, vertex_format_e format)
 {
-    auto structured_file = load_gltf(this, path, material, bindings);
+    auto structured_file = load_gltf(this, path, material, format);
     if (!structured_file.has_value()) return false;
     this->loaded_scenes[name] = structured_file.value();
     return true;
 }
 
-bool engine_t::immediate_submit(std::function<void(vk::CommandBuffer cmd)>&& function)
+std::shared_ptr<model_load_t> engine_t::load_model_async(std::string path, std::string name, vertex_format_e format, std::vector<glm::mat4> transform)
 {
-    vk::Result result = this->device.dev.resetFences(this->imm_submit.fence);
-    if (result != vk::Result::eSuccess)
+    return this->load_model_async(path, name, this->metal_rough_material, format, transform);
+}
+
+std::shared_ptr<model_load_t> engine_t::load_model_async(std::string path, std::string name, gltf_metallic_roughness_t& material,
+        vertex_format_e format, std::vector<glm::mat4> transform)
+{
+    std::shared_ptr<model_load_t> load = std::make_shared<model_load_t>();
+    load->path = path;
+    load->name = name;
+    load->format = format;
+    load->material = &material;
+    load->transform = transform;
+    load->scene = std::make_shared<loaded_gltf_t>();
+    load->scene->creator = this;
+    this->pending_loads.push_back(load);
+
+    this->jobs.submit([this, load]() {
+            bool loaded = load_gltf(this, *load->scene.get(), load->path, *load->material, load->format);
+            load->state = loaded ? model_load_state_e::UPLOADING : model_load_state_e::FAILED;
+            });
+    return load;
+}
+
+void engine_t::update_model_loads()
+{
+    std::erase_if(this->pending_loads, [this](const std::shared_ptr<model_load_t>& load) {
+            model_load_state_e state = load->state;
+            if (state == model_load_state_e::FAILED)
+            {
+                fmt::print(stderr, "[ {} ]\tFailed to load model '{}'!\n", ERROR_FMT("ERROR"), load->path);
+                // NOTE: Releasing the resources may have to wait for and submit uploads, so it happens here and not on the worker.
+                load->scene.reset();
+                return true;
+            }
+            if (state != model_load_state_e::UPLOADING || !this->uploads.is_ready(load->scene->ticket)) return false;
+
+            load->scene->transform = load->transform;
+            this->loaded_scenes[load->name] = load->scene;
+            load->state = model_load_state_e::RESIDENT;
+            return true;
+            });
+}
+
+void engine_t::update_texture_streaming()
+{
+    std::vector<streamed_texture_t*> candidates;
+    for (auto& [name, scene] : this->loaded_scenes)
     {
-        fmt::print(stderr, "[ {} ]\tFailed to reset fence!\n", ERROR_FMT("ERROR"));
-        return false;
+        for (streamed_texture_t& texture : scene->streamed_textures)
+        {
+            bool pending = texture.pending_image.has_value() || texture.uploaded_level < texture.resident_level;
+            if (pending && this->uploads.is_ready(texture.ticket) && this->update_streamed_view(*scene, texture)) pending = false;
+
+            // NOTE: Only textures in an image of every level that were drawn last frame get finer levels.
+            bool drawn = texture.last_used_frame() + 1 >= this->frame_count;
+            if (!pending && drawn && texture.image_level == 0 && texture.resident_level > 0) candidates.push_back(&texture);
+        }
     }
-    if (result = this->imm_submit.cmd.reset(); result != vk::Result::eSuccess)
+
+    // NOTE: Coarsest first, so all textures sharpen at the same pace instead of one after another.
+    std::sort(candidates.begin(), candidates.end(), [](const streamed_texture_t* a, const streamed_texture_t* b) {
+            return a->resident_level > b->resident_level;
+            });
+    vk::DeviceSize recorded = 0;
+    for (streamed_texture_t* texture : candidates)
     {
-        fmt::print(stderr, "[ {} ]\tFailed to reset command buffer!\n", ERROR_FMT("ERROR"));
-        return false;
+        // NOTE: The first level of a frame is always recorded, so levels larger than the budget still get uploaded.
+        std::uint32_t level = texture->resident_level - 1;
+        vk::DeviceSize size = texture->texture.levels[level].size;
+        if (recorded > 0 && recorded + size > this->texture_stream_budget) break;
+
+        auto ticket = this->uploads.upload_texture(texture->image, texture->texture, nullptr, level, 1);
+        if (!ticket.has_value()) break;
+        texture->uploaded_level = level;
+        texture->ticket = ticket.value();
+        recorded += size;
     }
+}
 
-    vk::CommandBufferBeginInfo begin_info(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
-    if (result = this->imm_submit.cmd.begin(begin_info); result != vk::Result::eSuccess)
+bool engine_t::update_streamed_view(loaded_gltf_t& file, streamed_texture_t& texture)
+{
+    const allocated_image_t& image = texture.pending_image.has_value() ? texture.pending_image.value() : texture.image;
+    std::uint32_t image_level = texture.pending_image.has_value() ? texture.pending_level : texture.image_level;
+    std::uint32_t mip_levels = texture.texture.levels.size();
+    vk::ImageViewCreateInfo view_info({}, image.image, vk::ImageViewType::e2D, image.format, {}, vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor,
+                texture.uploaded_level - image_level, mip_levels - texture.uploaded_level, 0, 1));
+    auto [result, view] = this->device.dev.createImageView(view_info);
+    if (result != vk::Result::eSuccess)
     {
-        fmt::print(stderr, "[ {} ]\tFailed to begin recording command buffer!\n", ERROR_FMT("ERROR"));
+        fmt::print(stderr, "[ {} ]\tFailed to create image view!\n", ERROR_FMT("ERROR"));
         return false;
     }
-    function(this->imm_submit.cmd);
-    if (result = this->imm_submit.cmd.end(); result != vk::Result::eSuccess)
+    auto texture_index = this->replace_texture(file, texture.texture_index, view, texture.materials);
+    if (!texture_index.has_value())
     {
-        fmt::print(stderr, "[ {} ]\tFailed to end recording command buffer!\n", ERROR_FMT("ERROR"));
+        this->device.dev.destroyImageView(view);
         return false;
     }
 
-    vk::CommandBufferSubmitInfo cmd_info(this->imm_submit.cmd);
-    vk::SubmitInfo2 submit_info({}, {}, cmd_info);
+    vk::ImageView retired_view = texture.view;
+    std::optional<allocated_image_t> retired_image;
+    if (texture.pending_image.has_value())
+    {
+        retired_image = texture.image;
+        texture.image = texture.pending_image.value();
+        texture.image_level = texture.pending_level;
+        texture.pending_image.reset();
+    }
+    this->retire([=, this]() {
+            this->device.dev.destroyImageView(retired_view);
+            if (retired_image.has_value()) this->destroy_image(retired_image.value());
+            });
 
-    if (result = this->device.graphics.queue.submit2(submit_info, this->imm_submit.fence); result != vk::Result::eSuccess)
+    texture.view = view;
+    texture.texture_index = texture_index.value();
+    texture.resident_level = texture.uploaded_level;
+    return true;
+}
+
+std::optional<std::uint32_t> engine_t::replace_texture(loaded_gltf_t& file, std::uint32_t texture_index, vk::ImageView view,
+        const std::vector<std::shared_ptr<gltf_material_t>>& materials)
+{
+    auto new_index = this->register_texture(view);
+    if (!new_index.has_value()) return std::nullopt;
+
+    // NOTE: Frames in flight may still read the constants of a material, so every material gets a new slot instead of being
+    // rewritten. The constants are read back from the mapped material buffer.
+    auto* constants = (gltf_metallic_roughness_t::material_constants_t*)this->bindless.material_buffer.info.pMappedData;
+    std::vector<std::uint32_t> material_indices;
+    for (const std::shared_ptr<gltf_material_t>& material : materials)
     {
-        fmt::print(stderr, "[ {} ]\tFailed to submit command buffer!\n", ERROR_FMT("ERROR"));
-        return false;
+        gltf_metallic_roughness_t::material_constants_t material_constants = constants[material->data.material_index];
+        if (material_constants.texture_indices.x == texture_index) material_constants.texture_indices.x = new_index.value();
+        if (material_constants.texture_indices.z == texture_index) material_constants.texture_indices.z = new_index.value();
+        auto material_index = this->register_material(material_constants);
+        if (!material_index.has_value())
+        {
+            for (std::uint32_t index : material_indices) this->release_material(index);
+            this->release_texture(new_index.value());
+            return std::nullopt;
+        }
+        material_indices.push_back(material_index.value());
     }
 
-    if (result = this->device.dev.waitForFences(this->imm_submit.fence, true, 9999999999); result != vk::Result::eSuccess)
+    std::vector<std::uint32_t> retired_materials;
+    for (std::size_t i = 0; i < materials.size(); ++i)
     {
-        fmt::print(stderr, "[ {} ]\tFailed to wait for fences!\n", ERROR_FMT("ERROR"));
-        return false;
+        std::uint32_t& index = materials[i]->data.material_index;
+        retired_materials.push_back(index);
+        std::replace(file.material_indices.begin(), file.material_indices.end(), index, material_indices[i]);
+        index = material_indices[i];
     }
+    std::replace(file.texture_indices.begin(), file.texture_indices.end(), texture_index, new_index.value());
 
-    return true;
+    this->retire([=, this]() {
+            for (std::uint32_t index : retired_materials) this->release_material(index);
+            this->release_texture(texture_index);
+            });
+    return new_index.value();
 }
 
-bool engine_t::create_swapchain(std::uint32_t width, std::uint32_t height)
+void engine_t::update_residency()
 {
-    vkb::SwapchainBuilder builder{this->physical_device, this->device.dev, this->window.surface};
-    this->swapchain.format = vk::Format::eB8G8R8A8Unorm;
+    std::array<VmaBudget, VK_MAX_MEMORY_HEAPS> budgets;
+    vmaGetHeapBudgets(this->allocator, budgets.data());
+    const VkPhysicalDeviceMemoryProperties* memory_props;
+    vmaGetMemoryProperties(this->allocator, &memory_props);
+
+    vk::DeviceSize usage = 0;
+    vk::DeviceSize available = 0;
+    for (std::uint32_t heap = 0; heap < memory_props->memoryHeapCount; ++heap)
+    {
+        if (!(memory_props->memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)) continue;
+        usage += budgets[heap].usage;
+        available += budgets[heap].budget;
+    }
+    this->residency.usage = usage;
+    this->residency.effective_budget = this->residency.budget > 0 ? this->residency.budget : available / 10 * 9;
 
-    vkb::Result<vkb::Swapchain> sc_ret = builder
-        .set_desired_format((VkSurfaceFormatKHR)vk::SurfaceFormatKHR(this->swapchain.format, vk::ColorSpaceKHR::eSrgbNonlinear))
-        .set_desired_present_mode((VkPresentModeKHR)vk::PresentModeKHR::eFifo)
-        .set_desired_extent(width, height)
-        .add_image_usage_flags((VkImageUsageFlags)vk::ImageUsageFlagBits::eTransferDst)
-        .build();
+    bool near_budget = usage > available * this->memory.warn_ratio;
+    if (near_budget && !this->memory.warned)
+    {
+        fmt::print(stderr, "[ {} ]\tDevice local memory at {} of {} MiB, the budget is nearly used up!\n", WARN_FMT("WARNING"), usage >> 20,
+                available >> 20);
+    }
+    this->memory.warned = near_budget;
 
-    if (!sc_ret)
+    std::vector<streamed_texture_t*> evictable;
+    std::vector<streamed_texture_t*> expandable;
+    for (auto& [name, scene] : this->loaded_scenes)
     {
-        fmt::print(stderr, "[ {} ]\tCreating swapchain failed with error: {}\n", ERROR_FMT("ERROR"), sc_ret.error().message());
-        return false;
+        for (streamed_texture_t& texture : scene->streamed_textures)
+        {
+            if (texture.pending_image.has_value() || texture.uploaded_level < texture.resident_level) continue;
+            std::uint64_t last_used = texture.last_used_frame();
+            std::uint32_t tail = vkutil::first_level_within(texture.texture, TEXTURE_STREAM_TAIL_SIZE);
+            if (texture.image_level < tail && last_used + RESIDENCY_IDLE_FRAMES < this->frame_count) evictable.push_back(&texture);
+            if (texture.image_level > 0 && last_used + 1 >= this->frame_count) expandable.push_back(&texture);
+        }
     }
 
-    this->swapchain.swapchain = sc_ret.value().swapchain;
-    this->swapchain.extent = sc_ret.value().extent;
-    auto imgs = sc_ret.value().get_images().value();
-    auto views = sc_ret.value().get_image_views().value();
-    for (VkImage img : imgs)
-        this->swapchain.images.push_back(img);
-    for (VkImageView view : views)
-        this->swapchain.views.push_back(view);
+    // NOTE: Evicted images are retired and destroyed a few frames later, measuring before that would evict even more.
+    vk::DeviceSize budget = this->residency.effective_budget;
+    if (usage > budget && this->frame_count >= this->residency.settle_frame)
+    {
+        std::sort(evictable.begin(), evictable.end(), [](const streamed_texture_t* a, const streamed_texture_t* b) {
+                return a->last_used_frame() < b->last_used_frame();
+                });
 
-    return true;
-}
+        vk::DeviceSize evicted = 0;
+        for (streamed_texture_t* texture : evictable)
+        {
+            if (usage - evicted <= budget) break;
+            std::uint32_t tail = vkutil::first_level_within(texture->texture, TEXTURE_STREAM_TAIL_SIZE);
+            auto image = this->create_texture_image(texture->texture, tail, tail, vk::ImageUsageFlagBits::eSampled);
+            if (!image.has_value()) break;
+
+            VmaAllocationInfo alloc_info;
+            vmaGetAllocationInfo(this->allocator, texture->image.allocation, &alloc_info);
+            evicted += alloc_info.size;
+            texture->pending_image = image.value();
+            texture->pending_level = tail;
+            texture->uploaded_level = tail;
+            texture->ticket = image.value().ticket;
+            ++this->residency.evictions;
+        }
+        if (evicted > 0) this->residency.settle_frame = this->frame_count + FRAME_OVERLAP + 2;
+        return;
+    }
 
-bool engine_t::resize_swapchain()
-{
-    if (this->device.dev.waitIdle() != vk::Result::eSuccess)
+    for (streamed_texture_t* texture : expandable)
     {
-        fmt::print(stderr, "[ {} ]\tFaild to wait!\n", ERROR_FMT("ERROR"));
-        return false;
+        // NOTE: Estimated with the size of the texels, alignment and padding of the image may add a little.
+        if (usage + texture->texture.data.size() > budget) continue;
+        std::uint32_t tail = vkutil::first_level_within(texture->texture, TEXTURE_STREAM_TAIL_SIZE);
+        auto image = this->create_texture_image(texture->texture, 0, tail, vk::ImageUsageFlagBits::eSampled);
+        if (!image.has_value()) break;
+
+        usage += texture->texture.data.size();
+        texture->pending_image = image.value();
+        texture->pending_level = 0;
+        texture->uploaded_level = tail;
+        texture->ticket = image.value().ticket;
     }
-    this->destroy_swapchain();
-    int w, h;
-    glfwGetWindowSize(this->window.win, &w, &h);
-    this->window.width = w;
-    this->window.height = h;
-    
-    if (!this->create_swapchain(w, h)) return false;
-
-    this->window.resize_requested = false;
-    return true;
 }
 
-void engine_t::destroy_swapchain()
+void engine_t::retire(std::function<void()>&& function, upload_ticket_t ticket)
 {
-    for (vk::ImageView view : this->swapchain.views)
-        this->device.dev.destroyImageView(view);
-    this->device.dev.destroySwapchainKHR(this->swapchain.swapchain);
-    this->swapchain.images.clear();
-    this->swapchain.views.clear();
+    std::lock_guard<std::mutex> lock(this->resource_mutex);
+    this->retired.push_back(retired_t{ .frame_timeline_value = this->frame_timeline_value, .ticket = ticket, .function = std::move(function) });
 }
 
-std::optional<allocated_buffer_t> engine_t::create_buffer(std::size_t alloc_size, vk::BufferUsageFlags usage, VmaMemoryUsage memory_usage)
+void engine_t::collect_retired(bool all)
 {
-    vk::BufferCreateInfo buffer_info({}, alloc_size, usage);
-    VmaAllocationCreateInfo vma_alloc_info{ .flags = VMA_ALLOCATION_CREATE_MAPPED_BIT, .usage = memory_usage };
-    allocated_buffer_t buf;
-    if (vmaCreateBuffer(this->allocator, (VkBufferCreateInfo*)&buffer_info, &vma_alloc_info, (VkBuffer*)&buf.buffer, &buf.allocation, &buf.info) != VK_SUCCESS)
+    std::uint64_t value = std::numeric_limits<std::uint64_t>::max();
+    // NOTE: Allocations an open defragmentation pass moves must not be freed before it ends.
+    if (!all && this->defrag.pass_open) return;
+    if (!all)
     {
-        fmt::print(stderr, "[ {} ]\tFailed to create buffer!\n", ERROR_FMT("ERROR"));
-        return std::nullopt;
+        auto [result, counter] = this->device.dev.getSemaphoreCounterValue(this->frame_timeline);
+        if (result != vk::Result::eSuccess) return;
+        value = counter;
     }
-    return buf;
-}
+
+    // NOTE: Functions run in the order they were retired, one waiting on its upload holds back the ones after it.
+    std::vector<std::function<void()>> functions;
+    {
+        std::lock_guard<std::mutex> lock(this->resource_mutex);
+        while (!this->retired.empty() && this->retired.front().frame_timeline_value <= value
+                && (all || this->uploads.is_ready(this->retired.front().ticket)))
+        {
+            functions.push_back(std::move(this->retired.front().function));
+            this->retired.pop_front();
+        }
+    }
+    // NOTE: The functions release slots, which locks the mutex again.
+    for (std::function<void()>& function : functions) function();
+}
+
+void engine_t::update_defragmentation(vk::CommandBuffer cmd)
+{
+    if (this->defrag.pass_open)
+    {
+        auto [result, counter] = this->device.dev.getSemaphoreCounterValue(this->frame_timeline);
+        if (result != vk::Result::eSuccess || counter < this->defrag.pass_value) return;
+
+        for (vk::ImageView view : this->defrag.moved_views) this->device.dev.destroyImageView(view);
+        for (vk::Image image : this->defrag.moved_images) this->device.dev.destroyImage(image);
+        this->defrag.moved_views.clear();
+        this->defrag.moved_images.clear();
+        VkResult res = vmaEndDefragmentationPass(this->allocator, this->defrag.context, &this->defrag.pass);
+        this->defrag.pass_open = false;
+        // NOTE: Retired functions are held back while a pass is open.
+        this->collect_retired();
+        if (res == VK_SUCCESS) this->end_defragmentation();
+        return;
+    }
+
+    if (!this->defrag.enabled || !this->defrag.pool)
+    {
+        if (this->defrag.context) this->end_defragmentation();
+        return;
+    }
+    // NOTE: Loads in flight destroy the images they created if they fail, images of a pass must not be freed until it ends.
+    if (!this->pending_loads.empty()) return;
+    if (!this->defrag.context)
+    {
+        if (this->frame_count < this->defrag.next_frame) return;
+        VmaDefragmentationInfo info = { .pool = this->defrag.pool, .maxBytesPerPass = this->defrag.bytes_per_pass,
+            .maxAllocationsPerPass = this->defrag.moves_per_pass };
+        if (vmaBeginDefragmentation(this->allocator, &info, &this->defrag.context) != VK_SUCCESS)
+        {
+            fmt::print(stderr, "[ {} ]\tFailed to begin defragmentation!\n", ERROR_FMT("ERROR"));
+            this->defrag.context = nullptr;
+            this->defrag.next_frame = this->frame_count + this->defrag.interval;
+            return;
+        }
+    }
+
+    VkResult res = vmaBeginDefragmentationPass(this->allocator, this->defrag.context, &this->defrag.pass);
+    if (res != VK_INCOMPLETE)
+    {
+        if (res != VK_SUCCESS) fmt::print(stderr, "[ {} ]\tFailed to begin defragmentation pass!\n", ERROR_FMT("ERROR"));
+        this->end_defragmentation();
+        return;
+    }
+
+    // NOTE: Only textures of loaded models without uploads in flight are moved. Everything else in the pool, e.g. the default
+    // images, keeps its place.
+    struct target_t
+    {
+        loaded_gltf_t* file;
+        allocated_image_t* image;
+        std::uint32_t* texture_index;
+        streamed_texture_t* texture = nullptr;
+    };
+    std::unordered_map<VmaAllocation, target_t> targets;
+    for (auto& [name, scene] : this->loaded_scenes)
+    {
+        for (auto& [image_name, image] : scene->images)
+        {
+            auto texture_index = scene->image_texture_indices.find(image_name);
+            if (texture_index == scene->image_texture_indices.end() || !this->uploads.is_ready(image.ticket)) continue;
+            targets[image.allocation] = target_t{ .file = scene.get(), .image = &image, .texture_index = &texture_index->second };
+        }
+        for (streamed_texture_t& texture : scene->streamed_textures)
+        {
+            bool pending = texture.pending_image.has_value() || texture.uploaded_level < texture.resident_level;
+            if (pending || !this->uploads.is_ready(texture.ticket)) continue;
+            targets[texture.image.allocation] = target_t{ .file = scene.get(), .image = &texture.image, .texture_index = &texture.texture_index,
+                .texture = &texture };
+        }
+    }
+
+    auto* constants = (gltf_metallic_roughness_t::material_constants_t*)this->bindless.material_buffer.info.pMappedData;
+    std::array<std::uint32_t, 2> families = { this->device.graphics.family_index, this->device.transfer.family_index };
+    auto move_texture = [&](const target_t& target, VmaAllocation allocation) -> bool
+    {
+        allocated_image_t& image = *target.image;
+        vk::ImageCreateInfo img_info({}, vk::ImageType::e2D, image.format, image.extent, image.mip_levels, 1, vk::SampleCountFlagBits::e1,
+                vk::ImageTiling::eOptimal, image.usage);
+        if (image.shared && this->device.transfer.family_index != this->device.graphics.family_index)
+        {
+            img_info.sharingMode = vk::SharingMode::eConcurrent;
+            img_info.setQueueFamilyIndices(families);
+        }
+        auto [result, new_image] = this->device.dev.createImage(img_info);
+        if (result != vk::Result::eSuccess || vmaBindImageMemory(this->allocator, allocation, new_image) != VK_SUCCESS)
+        {
+            fmt::print(stderr, "[ {} ]\tFailed to create image!\n", ERROR_FMT("ERROR"));
+            if (new_image) this->device.dev.destroyImage(new_image);
+            return false;
+        }
+
+        // NOTE: Streamed textures only hold their resident levels, the levels above them are written by later uploads.
+        std::uint32_t first_level = target.texture ? target.texture->resident_level - target.texture->image_level : 0;
+        vk::ImageViewCreateInfo view_info({}, new_image, vk::ImageViewType::e2D, image.format, {},
+                vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, image.mip_levels, 0, 1));
+        vk::ImageView view;
+        std::tie(result, view) = this->device.dev.createImageView(view_info);
+        vk::ImageView sampled_view = view;
+        if (result == vk::Result::eSuccess && target.texture)
+        {
+            view_info.subresourceRange.baseMipLevel = first_level;
+            view_info.subresourceRange.levelCount = image.mip_levels - first_level;
+            std::tie(result, sampled_view) = this->device.dev.createImageView(view_info);
+            if (result != vk::Result::eSuccess) this->device.dev.destroyImageView(view);
+        }
+        if (result != vk::Result::eSuccess)
+        {
+            fmt::print(stderr, "[ {} ]\tFailed to create image view!\n", ERROR_FMT("ERROR"));
+            this->device.dev.destroyImage(new_image);
+            return false;
+        }
+
+        // NOTE: Images that are not streamed do not know their materials, so they are found by their slot.
+        std::vector<std::shared_ptr<gltf_material_t>> materials;
+        if (target.texture) materials = target.texture->materials;
+        else
+        {
+            for (auto& [name, material] : target.file->materials)
+            {
+                glm::uvec4 indices = constants[material->data.material_index].texture_indices;
+                if (indices.x == *target.texture_index || indices.z == *target.texture_index) materials.push_back(material);
+            }
+        }
+        auto texture_index = this->replace_texture(*target.file, *target.texture_index, sampled_view, materials);
+        if (!texture_index.has_value())
+        {
+            if (sampled_view != view) this->device.dev.destroyImageView(sampled_view);
+            this->device.dev.destroyImageView(view);
+            this->device.dev.destroyImage(new_image);
+            return false;
+        }
+
+        std::vector<vk::ImageCopy> regions;
+        for (std::uint32_t level = first_level; level < image.mip_levels; ++level)
+        {
+            vk::Extent3D extent(std::max(image.extent.width >> level, 1u), std::max(image.extent.height >> level, 1u), 1);
+            vk::ImageSubresourceLayers subresource(vk::ImageAspectFlagBits::eColor, level, 0, 1);
+            regions.push_back(vk::ImageCopy(subresource, {}, subresource, {}, extent));
+        }
+        vkutil::transition_image(cmd, image.image, vk::ImageLayout::eShaderReadOnlyOptimal, vk::ImageLayout::eTransferSrcOptimal, first_level);
+        vkutil::transition_image(cmd, new_image, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal, first_level);
+        cmd.copyImage(image.image, vk::ImageLayout::eTransferSrcOptimal, new_image, vk::ImageLayout::eTransferDstOptimal, regions);
+        vkutil::transition_image(cmd, new_image, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal, first_level);
+
+        this->defrag.moved_images.push_back(image.image);
+        this->defrag.moved_views.push_back(image.view);
+        if (target.texture)
+        {
+            this->defrag.moved_views.push_back(target.texture->view);
+            target.texture->view = sampled_view;
+        }
+        image.image = new_image;
+        image.view = view;
+        *target.texture_index = texture_index.value();
+        return true;
+    };
+
+    for (std::uint32_t i = 0; i < this->defrag.pass.moveCount; ++i)
+    {
+        VmaDefragmentationMove& move = this->defrag.pass.pMoves[i];
+        auto target = targets.find(move.srcAllocation);
+        if (target == targets.end() || !move_texture(target->second, move.dstTmpAllocation))
+        {
+            move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+        }
+    }
+    // NOTE: The copies are recorded into the frame that is submitted next.
+    this->defrag.pass_open = true;
+    this->defrag.pass_value = this->frame_timeline_value + 1;
+}
+
+void engine_t::end_defragmentation()
+{
+    if (this->defrag.pass_open)
+    {
+        for (vk::ImageView view : this->defrag.moved_views) this->device.dev.destroyImageView(view);
+        for (vk::Image image : this->defrag.moved_images) this->device.dev.destroyImage(image);
+        this->defrag.moved_views.clear();
+        this->defrag.moved_images.clear();
+        vmaEndDefragmentationPass(this->allocator, this->defrag.context, &this->defrag.pass);
+        this->defrag.pass_open = false;
+    }
+    if (!this->defrag.context) return;
+
+    VmaDefragmentationStats stats = {};
+    vmaEndDefragmentation(this->allocator, this->defrag.context, &stats);
+    this->defrag.context = nullptr;
+    this->defrag.next_frame = this->frame_count + this->defrag.interval;
+    this->defrag.moved_allocations += stats.allocationsMoved;
+    this->defrag.moved_bytes += stats.bytesMoved;
+#ifdef DEBUG
+    fmt::print("[ {} ]\tDefragmentation moved {} textures, {} KiB, and freed {} blocks\n", INFO_FMT("INFO"), stats.allocationsMoved,
+            stats.bytesMoved >> 10, stats.deviceMemoryBlocksFreed);
+#endif
+}
+
+bool engine_t::immediate_submit(std::function<void(vk::CommandBuffer cmd)>&& function)
+{
+    vk::Result result = this->device.dev.resetFences(this->imm_submit.fence);
+    if (result != vk::Result::eSuccess)
+    {
+        fmt::print(stderr, "[ {} ]\tFailed to reset fence!\n", ERROR_FMT("ERROR"));
+        return false;
+    }
+    if (result = this->imm_submit.cmd.reset(); result != vk::Result::eSuccess)
+    {
+        fmt::print(stderr, "[ {} ]\tFailed to reset command buffer!\n", ERROR_FMT("ERROR"));
+        return false;
+    }
+
+    vk::CommandBufferBeginInfo begin_info(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+    if (result = this->imm_submit.cmd.begin(begin_info); result != vk::Result::eSuccess)
+    {
+        fmt::print(stderr, "[ {} ]\tFailed to begin recording command buffer!\n", ERROR_FMT("ERROR"));
+        return false;
+    }
+    function(this->imm_submit.cmd);
+    if (result = this->imm_submit.cmd.end(); result != vk::Result::eSuccess)
+    {
+        fmt::print(stderr, "[ {} ]\tFailed to end recording command buffer!\n", ERROR_FMT("ERROR"));
+        return false;
+    }
+
+    vk::CommandBufferSubmitInfo cmd_info(this->imm_submit.cmd);
+    vk::SubmitInfo2 submit_info({}, {}, cmd_info);
+
+    if (result = this->device.graphics.queue.submit2(submit_info, this->imm_submit.fence); result != vk::Result::eSuccess)
+    {
+        fmt::print(stderr, "[ {} ]\tFailed to submit command buffer!\n", ERROR_FMT("ERROR"));
+        return false;
+    }
+
+    if (result = this->device.dev.waitForFences(this->imm_submit.fence, true, 9999999999); result != vk::Result::eSuccess)
+    {
+        fmt::print(stderr, "[ {} ]\tFailed to wait for fences!\n", ERROR_FMT("ERROR"));
+        return false;
+    }
+
+    return true;
+}
+
+bool engine_t::create_swapchain(std::uint32_t width, std::uint32_t height)
+{
+    vkb::SwapchainBuilder builder{this->physical_device, this->device.dev, this->window.surface};
+    this->swapchain.format = vk::Format::eB8G8R8A8Unorm;
+
+    // NOTE: The upscaler writes into the swapchain directly if its images can be used as storage images.
+    vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eTransferDst;
+    auto [caps_result, capabilities] = this->physical_device.getSurfaceCapabilitiesKHR(this->window.surface);
+    this->swapchain.storage = this->device.extensions.storage_write_without_format && caps_result == vk::Result::eSuccess
+        && (capabilities.supportedUsageFlags & vk::ImageUsageFlagBits::eStorage)
+        && (this->physical_device.getFormatProperties(this->swapchain.format).optimalTilingFeatures & vk::FormatFeatureFlagBits::eStorageImage);
+    if (this->swapchain.storage) usage |= vk::ImageUsageFlagBits::eStorage;
+
+    vkb::Result<vkb::Swapchain> sc_ret = builder
+        .set_desired_format((VkSurfaceFormatKHR)vk::SurfaceFormatKHR(this->swapchain.format, vk::ColorSpaceKHR::eSrgbNonlinear))
+        .set_desired_present_mode((VkPresentModeKHR)vk::PresentModeKHR::eFifo)
+        .set_desired_extent(width, height)
+        .add_image_usage_flags((VkImageUsageFlags)usage)
+        .build();
+
+    if (!sc_ret)
+    {
+        fmt::print(stderr, "[ {} ]\tCreating swapchain failed with error: {}\n", ERROR_FMT("ERROR"), sc_ret.error().message());
+        return false;
+    }
+
+    this->swapchain.swapchain = sc_ret.value().swapchain;
+    this->swapchain.extent = sc_ret.value().extent;
+    auto imgs = sc_ret.value().get_images().value();
+    auto views = sc_ret.value().get_image_views().value();
+    for (VkImage img : imgs)
+        this->swapchain.images.push_back(img);
+    for (VkImageView view : views)
+        this->swapchain.views.push_back(view);
+
+    return true;
+}
+
+bool engine_t::resize_swapchain()
+{
+    if (this->device.dev.waitIdle() != vk::Result::eSuccess)
+    {
+        fmt::print(stderr, "[ {} ]\tFaild to wait!\n", ERROR_FMT("ERROR"));
+        return false;
+    }
+    this->destroy_swapchain();
+    int w, h;
+    glfwGetWindowSize(this->window.win, &w, &h);
+    this->window.width = w;
+    this->window.height = h;
+    
+    if (!this->create_swapchain(w, h)) return false;
+    if (!this->update_render_targets()) return false;
+
+    this->upscaler.history_valid = false;
+    this->window.resize_requested = false;
+    return true;
+}
+
+bool engine_t::create_render_targets(vk::Extent2D extent)
+{
+    this->draw_image.extent = vk::Extent3D(extent, 1);
+    vk::ImageCreateInfo rimg_info({}, vk::ImageType::e2D, this->draw_image.format, this->draw_image.extent, 1, 1, vk::SampleCountFlagBits::e1, vk::ImageTiling::eOptimal,
+            vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eColorAttachment);
+    // NOTE: The background is written on the compute queue, concurrent sharing avoids queue family ownership transfers every frame.
+    std::array<std::uint32_t, 2> draw_image_families = { this->device.graphics.family_index, this->device.compute.family_index };
+    if (this->device.compute.family_index != this->device.graphics.family_index)
+    {
+        rimg_info.sharingMode = vk::SharingMode::eConcurrent;
+        rimg_info.setQueueFamilyIndices(draw_image_families);
+    }
+    VmaAllocationCreateInfo rimg_alloc_info = {};
+    rimg_alloc_info.usage = VMA_MEMORY_USAGE_AUTO;
+    rimg_alloc_info.requiredFlags = VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    if (vmaCreateImage(this->allocator, (VkImageCreateInfo*)&rimg_info, &rimg_alloc_info, (VkImage*)&this->draw_image.image, &this->draw_image.allocation,
+                nullptr) != VK_SUCCESS)
+    {
+        fmt::print(stderr, "[ {} ]\tCreating render image failed.\n", ERROR_FMT("ERROR"));
+        return false;
+    }
+    this->track_allocation(this->draw_image.allocation, memory_category_e::RENDER_TARGETS, "draw image");
+
+    vk::ImageViewCreateInfo rview_info({}, this->draw_image.image, vk::ImageViewType::e2D, this->draw_image.format, {},
+            vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1));
+    vk::Result result;
+    std::tie(result, this->draw_image.view) = this->device.dev.createImageView(rview_info);
+    if (result != vk::Result::eSuccess)
+    {
+        fmt::print(stderr, "[ {} ]\tCreating render image view failed.\n", ERROR_FMT("ERROR"));
+        return false;
+    }
+
+    vk::ImageUsageFlags history_usage = vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled;
+    for (allocated_image_t& history : this->upscaler.history)
+    {
+        auto ret_img = this->create_image(this->draw_image.extent, this->draw_image.format, history_usage);
+        if (!ret_img.has_value()) return false;
+        history = ret_img.value();
+        this->track_allocation(history.allocation, memory_category_e::RENDER_TARGETS, "taa history");
+    }
+
+    // NOTE: The transient images follow at the start of the next frame.
+    for (auto& [image, info] : this->transients.declared) image->extent = this->draw_image.extent;
+    if (!this->transients.declared.empty()) this->transients.dirty = true;
+
+    if (this->draw_descriptor.set)
+    {
+        descriptor_writer_t writer;
+        writer.write_image(0, this->draw_image.view, VK_NULL_HANDLE, vk::ImageLayout::eGeneral, vk::DescriptorType::eStorageImage);
+        writer.update_set(this->device.dev, this->draw_descriptor.set);
+    }
+
+#ifdef DEBUG
+    fmt::print("[ {} ]\tRender targets: {}x{}\n", INFO_FMT("INFO"), extent.width, extent.height);
+#endif
+    return true;
+}
+
+void engine_t::destroy_render_targets()
+{
+    this->destroy_image(this->draw_image);
+    for (const allocated_image_t& history : this->upscaler.history) this->destroy_image(history);
+    this->draw_image = allocated_image_t{ .format = this->draw_image.format };
+    for (allocated_image_t& history : this->upscaler.history) history = {};
+}
+
+bool engine_t::update_render_targets()
+{
+    vk::Extent2D target(this->draw_image.extent.width, this->draw_image.extent.height);
+    vk::Extent2D extent = this->swapchain.extent;
+    if (extent.width == 0 || extent.height == 0) return true;
+
+    bool grown = extent.width > target.width || extent.height > target.height;
+    bool shrunk = std::uint64_t(extent.width) * extent.height * 2 < std::uint64_t(target.width) * target.height;
+    if (!grown && !shrunk) return true;
+
+    this->destroy_render_targets();
+    return this->create_render_targets(vk::Extent2D(extent.width * RENDER_TARGET_HEADROOM, extent.height * RENDER_TARGET_HEADROOM));
+}
+
+void engine_t::destroy_swapchain()
+{
+    for (vk::ImageView view : this->swapchain.views)
+        this->device.dev.destroyImageView(view);
+    this->device.dev.destroySwapchainKHR(this->swapchain.swapchain);
+    this->swapchain.images.clear();
+    this->swapchain.views.clear();
+}
+
+bool engine_t::init_geometry_pool()
+{
+    // NOTE: VMA picks device local memory that is also host visible if there is any and falls back to memory that is only device local,
+    // which is filled through the upload manager instead. VMA may still end up in memory that is only host visible, e.g. if the
+    // device local heaps are full, the pool is then created again without host access.
+    VmaAllocationCreateFlags host_access = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_ALLOW_TRANSFER_INSTEAD_BIT;
+    auto create_pool_buffer = [&](vk::DeviceSize size, vk::BufferUsageFlags usage) -> std::optional<allocated_buffer_t>
+    {
+        VkMemoryPropertyFlags properties = 0;
+        for (VmaAllocationCreateFlags access : { host_access, VmaAllocationCreateFlags(0) })
+        {
+            auto ret = this->create_buffer(size, usage, access, true);
+            if (!ret.has_value()) return std::nullopt;
+            vmaGetAllocationMemoryProperties(this->allocator, ret.value().allocation, &properties);
+            if (properties & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) return ret.value();
+            this->destroy_buffer(ret.value());
+        }
+        fmt::print(stderr, "[ {} ]\tGeometry pool could not be created in device local memory!\n", ERROR_FMT("ERROR"));
+        return std::nullopt;
+    };
+
+    auto ret = create_pool_buffer(GEOMETRY_POOL_VERTEX_SIZE, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst
+            | vk::BufferUsageFlagBits::eShaderDeviceAddress);
+    if (!ret.has_value()) return false;
+    this->geometry.vertex_buffer = ret.value();
+    this->track_allocation(this->geometry.vertex_buffer.allocation, memory_category_e::MESHES, "geometry vertex pool");
+
+    vk::BufferDeviceAddressInfo device_address_info(this->geometry.vertex_buffer.buffer);
+    this->geometry.vertex_buffer_address = this->device.dev.getBufferAddress(&device_address_info);
+
+    ret = create_pool_buffer(GEOMETRY_POOL_INDEX_SIZE, vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst);
+    if (!ret.has_value()) return false;
+    this->geometry.index_buffer = ret.value();
+    this->track_allocation(this->geometry.index_buffer.allocation, memory_category_e::MESHES, "geometry index pool");
+
+    this->geometry.host_visible = this->geometry.vertex_buffer.info.pMappedData && this->geometry.index_buffer.info.pMappedData;
+#ifdef DEBUG
+    fmt::print("[ {} ]\tGeometry pool is {}\n", INFO_FMT("INFO"), this->geometry.host_visible ? "host visible, meshes are written in place"
+            : "not host visible, meshes are staged");
+#endif
+
+    VmaVirtualBlockCreateInfo block_info = { .size = GEOMETRY_POOL_VERTEX_SIZE };
+    if (vmaCreateVirtualBlock(&block_info, &this->geometry.vertex_block) != VK_SUCCESS)
+    {
+        fmt::print(stderr, "[ {} ]\tFailed to create virtual block for vertices!\n", ERROR_FMT("ERROR"));
+        return false;
+    }
+    block_info.size = GEOMETRY_POOL_INDEX_SIZE;
+    if (vmaCreateVirtualBlock(&block_info, &this->geometry.index_block) != VK_SUCCESS)
+    {
+        fmt::print(stderr, "[ {} ]\tFailed to create virtual block for indices!\n", ERROR_FMT("ERROR"));
+        return false;
+    }
+
+    this->main_deletion_queue.push_function([&]() {
+            vmaClearVirtualBlock(this->geometry.vertex_block);
+            vmaClearVirtualBlock(this->geometry.index_block);
+            vmaDestroyVirtualBlock(this->geometry.vertex_block);
+            vmaDestroyVirtualBlock(this->geometry.index_block);
+            this->destroy_buffer(this->geometry.vertex_buffer);
+            this->destroy_buffer(this->geometry.index_buffer);
+            });
+
+    return true;
+}
+
+void engine_t::release_mesh(const gpu_mesh_buffer_t& mesh)
+{
+    // NOTE: Frames in flight may read the ranges and a copy that is still in flight, or not even submitted because its group
+    // is open, would overwrite the next mesh in them, so they are freed once both are done.
+    VmaVirtualAllocation vertex_allocation = mesh.vertex_allocation;
+    VmaVirtualAllocation index_allocation = mesh.index_allocation;
+    this->retire([=, this]() {
+            std::lock_guard<std::mutex> lock(this->resource_mutex);
+            vmaVirtualFree(this->geometry.vertex_block, vertex_allocation);
+            vmaVirtualFree(this->geometry.index_block, index_allocation);
+            }, mesh.ticket);
+}
+
+std::optional<allocated_buffer_t> engine_t::create_buffer(std::size_t alloc_size, vk::BufferUsageFlags usage, VmaAllocationCreateFlags host_access, bool shared)
+{
+    vk::BufferCreateInfo buffer_info({}, alloc_size, usage);
+    // NOTE: Uploads are copied on the transfer queue, concurrent sharing avoids queue family ownership transfers for every upload.
+    std::array<std::uint32_t, 2> families = { this->device.graphics.family_index, this->device.transfer.family_index };
+    if (shared && this->device.transfer.family_index != this->device.graphics.family_index)
+    {
+        buffer_info.sharingMode = vk::SharingMode::eConcurrent;
+        buffer_info.setQueueFamilyIndices(families);
+    }
+    VmaAllocationCreateInfo vma_alloc_info{ .flags = host_access, .usage = VMA_MEMORY_USAGE_AUTO };
+    if (host_access)
+    {
+        vma_alloc_info.flags |= VMA_ALLOCATION_CREATE_MAPPED_BIT;
+        // NOTE: Mapped buffers are written without flushing, so they have to be coherent unless they may end up not being mapped at all.
+        if (!(host_access & VMA_ALLOCATION_CREATE_HOST_ACCESS_ALLOW_TRANSFER_INSTEAD_BIT)) vma_alloc_info.requiredFlags = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    }
+    allocated_buffer_t buf;
+    if (vmaCreateBuffer(this->allocator, (VkBufferCreateInfo*)&buffer_info, &vma_alloc_info, (VkBuffer*)&buf.buffer, &buf.allocation, &buf.info) != VK_SUCCESS)
+    {
+        fmt::print(stderr, "[ {} ]\tFailed to create buffer!\n", ERROR_FMT("ERROR"));
+        return std::nullopt;
+    }
+    return buf;
+}
 
 void engine_t::destroy_buffer(const allocated_buffer_t& buf)
 {
+    this->untrack_allocation(buf.allocation);
     vmaDestroyBuffer(this->allocator, (VkBuffer)buf.buffer, buf.allocation);
 }
 
-std::optional<allocated_image_t> engine_t::create_image(vk::Extent3D size, vk::Format format, vk::ImageUsageFlags usage, bool mipmapped)
+std::optional<allocated_image_t> engine_t::create_image(vk::Extent3D size, vk::Format format, vk::ImageUsageFlags usage, bool mipmapped, bool shared)
 {
+    std::uint32_t mip_levels = mipmapped ? vkutil::mip_level_count(vk::Extent2D(size.width, size.height)) : 1;
+    return this->create_image(size, format, usage, mip_levels, shared);
+}
+
+std::optional<allocated_image_t> engine_t::create_image(vk::Extent3D size, vk::Format format, vk::ImageUsageFlags usage, std::uint32_t mip_levels,
+        bool shared, bool movable)
+{
+    // NOTE: Defragmentation copies images into a new image with the same usage, images uploaded through host image copies
+    // would lack the usage otherwise.
+    bool pooled = movable && this->defrag.pool;
+    if (pooled) usage |= vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst;
+
     allocated_image_t new_img;
     new_img.format = format;
     new_img.extent = size;
+    new_img.mip_levels = mip_levels;
+    new_img.usage = usage;
+    new_img.shared = shared;
 
-    vk::ImageCreateInfo img_info({}, vk::ImageType::e2D, format, size, 1, 1, vk::SampleCountFlagBits::e1, vk::ImageTiling::eOptimal, usage);
-    if (mipmapped) img_info.mipLevels = static_cast<std::uint32_t>(std::floor(std::log2(std::max(size.width, size.height)))) + 1;
+    vk::ImageCreateInfo img_info({}, vk::ImageType::e2D, format, size, mip_levels, 1, vk::SampleCountFlagBits::e1, vk::ImageTiling::eOptimal, usage);
+    std::array<std::uint32_t, 2> families = { this->device.graphics.family_index, this->device.transfer.family_index };
+    if (shared && this->device.transfer.family_index != this->device.graphics.family_index)
+    {
+        img_info.sharingMode = vk::SharingMode::eConcurrent;
+        img_info.setQueueFamilyIndices(families);
+    }
 
-    VmaAllocationCreateInfo alloc_info = { .usage = VMA_MEMORY_USAGE_GPU_ONLY, .requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT };
-    if (vmaCreateImage(this->allocator, (VkImageCreateInfo*)&img_info, &alloc_info, (VkImage*)&new_img.image, &new_img.allocation, nullptr) != VK_SUCCESS)
+    VmaAllocationCreateInfo alloc_info = { .usage = VMA_MEMORY_USAGE_AUTO, .requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT };
+    if (pooled) alloc_info.pool = this->defrag.pool;
+    VkResult res = vmaCreateImage(this->allocator, (VkImageCreateInfo*)&img_info, &alloc_info, (VkImage*)&new_img.image, &new_img.allocation, nullptr);
+    // NOTE: Images the memory type of the pool does not support fall back to the default pools, which are not defragmented.
+    if (res != VK_SUCCESS && pooled)
+    {
+        alloc_info.pool = nullptr;
+        res = vmaCreateImage(this->allocator, (VkImageCreateInfo*)&img_info, &alloc_info, (VkImage*)&new_img.image, &new_img.allocation, nullptr);
+    }
+    if (res != VK_SUCCESS)
     {
         fmt::print(stderr, "[ {} ]\tFailed to create image!\n", ERROR_FMT("ERROR"));
         return std::nullopt;
@@ -1261,72 +2894,651 @@ std::optional<allocated_image_t> engine_t::create_image(vk::Extent3D size, vk::F
     return new_img;
 }
 
-std::optional<allocated_image_t> engine_t::create_image(void* data, vk::Extent3D size, vk::Format format, vk::ImageUsageFlags usage, bool mipmapped)
+std::optional<allocated_image_t> engine_t::create_image(void* data, vk::Extent3D size, vk::Format format, vk::ImageUsageFlags usage, bool mipmapped,
+        upload_group_t* group, mip_filter_e filter)
 {
+    std::uint32_t mip_levels = mipmapped ? vkutil::mip_level_count(vk::Extent2D(size.width, size.height)) : 1;
+    if (this->device.extensions.host_image_copy && this->supports_host_image_copy(format, usage))
+    {
+        auto new_img = this->create_image(size, format, usage | vk::ImageUsageFlagBits::eHostTransferEXT, mip_levels, false, true);
+        if (!new_img.has_value()) return std::nullopt;
+        if (!this->copy_image_from_host(new_img.value(), data, mipmapped, filter))
+        {
+            this->destroy_image(new_img.value());
+            return std::nullopt;
+        }
+        this->track_allocation(new_img.value().allocation, memory_category_e::TEXTURES);
+        return new_img.value();
+    }
+
     std::size_t data_size = size.depth * size.width * size.height * 4;
-    auto upload_buffer = create_buffer(data_size, vk::BufferUsageFlagBits::eTransferSrc, VMA_MEMORY_USAGE_CPU_TO_GPU);
-    if (!upload_buffer.has_value()) return std::nullopt;
-    std::memcpy(upload_buffer.value().info.pMappedData, data, data_size);
-    auto new_img = this->create_image(size, format, usage | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eTransferSrc, mipmapped);
+    // NOTE: Mip levels are either written by the mip generator, which needs a format that supports storage, or blitted from the level above.
+    vk::ImageUsageFlags mip_usage = {};
+    if (mipmapped && this->uploads.mips) mip_usage = vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled;
+    else if (mipmapped) mip_usage = vk::ImageUsageFlagBits::eTransferSrc;
+    auto new_img = this->create_image(size, format, usage | vk::ImageUsageFlagBits::eTransferDst | mip_usage, mip_levels, true, true);
     if (!new_img.has_value()) return std::nullopt;
 
-    this->immediate_submit([&](vk::CommandBuffer cmd) {
-            vkutil::transition_image(cmd, new_img.value().image, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal);
+    auto ticket = this->uploads.upload_image(new_img.value(), data, data_size, mipmapped, group, filter);
+    if (!ticket.has_value())
+    {
+        this->destroy_image(new_img.value());
+        return std::nullopt;
+    }
+    new_img.value().ticket = ticket.value();
 
-            vk::BufferImageCopy copy_region(0, 0, 0, vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1), {}, size);
-            cmd.copyBufferToImage(upload_buffer.value().buffer, new_img.value().image, vk::ImageLayout::eTransferDstOptimal, copy_region);
+    this->track_allocation(new_img.value().allocation, memory_category_e::TEXTURES);
+    return new_img.value();
+}
 
-            if (mipmapped)
-                vkutil::generate_mipmaps(cmd, new_img.value().image, vk::Extent2D(new_img.value().extent.width, new_img.value().extent.height));
-            else
-                vkutil::transition_image(cmd, new_img.value().image, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal);
-            });
+std::optional<allocated_image_t> engine_t::create_image(const texture_data_t& texture, vk::ImageUsageFlags usage, upload_group_t* group)
+{
+    std::uint32_t mip_levels = texture.levels.size();
+    if (this->device.extensions.host_image_copy && this->supports_host_image_copy(texture.format, usage))
+    {
+        auto new_img = this->create_image(texture.extent, texture.format, usage | vk::ImageUsageFlagBits::eHostTransferEXT, mip_levels, false, true);
+        if (!new_img.has_value()) return std::nullopt;
+
+        vk::HostImageLayoutTransitionInfoEXT transition(new_img.value().image, vk::ImageLayout::eUndefined, vk::ImageLayout::eShaderReadOnlyOptimal,
+                vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, mip_levels, 0, 1));
+        bool copied = this->device.dev.transitionImageLayoutEXT(1, &transition, this->dispatch) == vk::Result::eSuccess;
+        std::vector<vk::MemoryToImageCopyEXT> regions;
+        for (std::uint32_t mip = 0; mip < mip_levels; ++mip)
+        {
+            const texture_level_t& level = texture.levels[mip];
+            regions.push_back(vk::MemoryToImageCopyEXT(texture.data.data() + level.offset, 0, 0,
+                        vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, mip, 0, 1), {}, level.extent));
+        }
+        vk::CopyMemoryToImageInfoEXT copy_info({}, new_img.value().image, vk::ImageLayout::eShaderReadOnlyOptimal, regions.size(), regions.data());
+        copied = copied && this->device.dev.copyMemoryToImageEXT(&copy_info, this->dispatch) == vk::Result::eSuccess;
+        if (!copied)
+        {
+            fmt::print(stderr, "[ {} ]\tFailed to copy texture from host memory!\n", ERROR_FMT("ERROR"));
+            this->destroy_image(new_img.value());
+            return std::nullopt;
+        }
+        this->track_allocation(new_img.value().allocation, memory_category_e::TEXTURES);
+        return new_img.value();
+    }
+
+    auto new_img = this->create_image(texture.extent, texture.format, usage | vk::ImageUsageFlagBits::eTransferDst, mip_levels, true, true);
+    if (!new_img.has_value()) return std::nullopt;
+
+    auto ticket = this->uploads.upload_texture(new_img.value(), texture, group);
+    if (!ticket.has_value())
+    {
+        this->destroy_image(new_img.value());
+        return std::nullopt;
+    }
+    new_img.value().ticket = ticket.value();
+
+    this->track_allocation(new_img.value().allocation, memory_category_e::TEXTURES);
+    return new_img.value();
+}
+
+std::optional<allocated_image_t> engine_t::create_texture_image(const texture_data_t& texture, std::uint32_t image_level, std::uint32_t upload_level,
+        vk::ImageUsageFlags usage, upload_group_t* group)
+{
+    std::uint32_t mip_levels = texture.levels.size() - image_level;
+    auto new_img = this->create_image(texture.levels[image_level].extent, texture.format, usage | vk::ImageUsageFlagBits::eTransferDst, mip_levels,
+            true, true);
+    if (!new_img.has_value()) return std::nullopt;
 
-    this->destroy_buffer(upload_buffer.value());
+    auto ticket = this->uploads.upload_texture(new_img.value(), texture, group, upload_level, VK_REMAINING_MIP_LEVELS, image_level);
+    if (!ticket.has_value())
+    {
+        this->destroy_image(new_img.value());
+        return std::nullopt;
+    }
+    new_img.value().ticket = ticket.value();
 
+    this->track_allocation(new_img.value().allocation, memory_category_e::TEXTURES);
     return new_img.value();
 }
 
+std::optional<streamed_texture_t> engine_t::create_streamed_image(texture_data_t&& texture, vk::ImageUsageFlags usage, upload_group_t* group)
+{
+    std::uint32_t tail = vkutil::first_level_within(texture, TEXTURE_STREAM_TAIL_SIZE);
+    auto new_img = this->create_texture_image(texture, tail, tail, usage, group);
+    if (!new_img.has_value()) return std::nullopt;
+
+    // NOTE: The view is replaced as finer levels arrive, the view of the image is destroyed with it.
+    vk::ImageViewCreateInfo view_info({}, new_img.value().image, vk::ImageViewType::e2D, texture.format, {},
+            vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, VK_REMAINING_MIP_LEVELS, 0, 1));
+    auto [result, view] = this->device.dev.createImageView(view_info);
+    if (result != vk::Result::eSuccess)
+    {
+        fmt::print(stderr, "[ {} ]\tFailed to create image view!\n", ERROR_FMT("ERROR"));
+        this->retire([=, this]() { this->destroy_image(new_img.value()); }, new_img.value().ticket);
+        return std::nullopt;
+    }
+
+    upload_ticket_t ticket = new_img.value().ticket;
+    return streamed_texture_t{ .image = new_img.value(), .image_level = tail, .texture = std::move(texture), .view = view,
+        .texture_index = 0, .resident_level = tail, .uploaded_level = tail, .ticket = ticket };
+}
+
 void engine_t::destroy_image(const allocated_image_t& img)
 {
+    this->untrack_allocation(img.allocation);
     this->device.dev.destroyImageView(img.view);
     vmaDestroyImage(this->allocator, img.image, img.allocation);
 }
 
-std::optional<gpu_mesh_buffer_t> engine_t::upload_mesh(std::span<std::uint32_t> indices, std::span<vertex_t> vertices)
+void engine_t::declare_transient_image(allocated_image_t* image, const transient_image_info_t& info)
 {
-    const std::size_t vertex_buffer_size = vertices.size() * sizeof(vertex_t);
-    const std::size_t index_buffer_size = indices.size() * sizeof(std::uint32_t);
-    gpu_mesh_buffer_t buf;
-    
-    auto ret = this->create_buffer(vertex_buffer_size, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst
-            | vk::BufferUsageFlagBits::eShaderDeviceAddress, VMA_MEMORY_USAGE_GPU_ONLY);
-    if (!ret.has_value()) return std::nullopt;
-    buf.vertex_buffer = ret.value();
+    image->format = info.format;
+    image->extent = this->draw_image.extent;
+    this->transients.declared.emplace_back(image, info);
+    this->transients.dirty = true;
+}
 
-    vk::BufferDeviceAddressInfo device_address_info(buf.vertex_buffer.buffer);
-    buf.vertex_buffer_address = this->device.dev.getBufferAddress(&device_address_info);
+static void destroy_transients(engine_t* engine, const std::vector<allocated_image_t>& images, VmaAllocation allocation)
+{
+    for (const allocated_image_t& img : images)
+    {
+        if (img.allocation)
+        {
+            engine->destroy_image(img);
+            continue;
+        }
+        engine->device.dev.destroyImageView(img.view);
+        engine->device.dev.destroyImage(img.image);
+    }
+    engine->untrack_allocation(allocation);
+    if (allocation) vmaFreeMemory(engine->allocator, allocation);
+}
 
-    ret = this->create_buffer(index_buffer_size, vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst, VMA_MEMORY_USAGE_GPU_ONLY);
-    if (!ret.has_value()) return std::nullopt;
-    buf.index_buffer = ret.value();
-    
-    auto staging = this->create_buffer(vertex_buffer_size + index_buffer_size, vk::BufferUsageFlagBits::eTransferSrc, VMA_MEMORY_USAGE_CPU_ONLY);
-    if (!staging.has_value()) return std::nullopt;
+bool engine_t::create_transient_images()
+{
+    this->transients.dirty = false;
+    if (!this->transients.images.empty() || this->transients.allocation)
+    {
+        // NOTE: Frames in flight may still use the previous images.
+        this->retire([=, this, images = std::move(this->transients.images), allocation = this->transients.allocation]() {
+                destroy_transients(this, images, allocation);
+                });
+        this->transients.images.clear();
+        this->transients.allocation = nullptr;
+    }
+    this->transients.size = 0;
+    this->transients.unaliased_size = 0;
+    this->transients.lazy_size = 0;
 
-    void* data = staging.value().info.pMappedData;
-    std::memcpy(data, vertices.data(), vertex_buffer_size);
-    std::memcpy((char*)data + vertex_buffer_size, indices.data(), index_buffer_size);
+    struct placement_t
+    {
+        std::size_t declared;
+        vk::ImageCreateInfo info;
+        vk::MemoryRequirements requirements;
+        vk::DeviceSize offset = 0;
+    };
+    std::vector<placement_t> placements;
+    std::uint32_t memory_type_bits = ~0u;
+    vk::DeviceSize alignment = 1;
 
-    this->immediate_submit([&](vk::CommandBuffer cmd)
+    auto create_view = [&](allocated_image_t& img, const transient_image_info_t& info) -> bool
+    {
+        vk::ImageAspectFlags aspect = (info.usage & vk::ImageUsageFlagBits::eDepthStencilAttachment) ? vk::ImageAspectFlagBits::eDepth
+            : vk::ImageAspectFlagBits::eColor;
+        vk::ImageViewCreateInfo view_info({}, img.image, vk::ImageViewType::e2D, img.format, {}, vk::ImageSubresourceRange(aspect, 0, 1, 0, 1));
+        vk::Result result;
+        std::tie(result, img.view) = this->device.dev.createImageView(view_info);
+        if (result != vk::Result::eSuccess)
+        {
+            fmt::print(stderr, "[ {} ]\tFailed to create transient image view!\n", ERROR_FMT("ERROR"));
+            return false;
+        }
+        return true;
+    };
+    auto fail = [&]()
+    {
+        destroy_transients(this, this->transients.images, this->transients.allocation);
+        this->transients.images.clear();
+        this->transients.allocation = nullptr;
+        return false;
+    };
+
+    VmaAllocationCreateInfo lazy_alloc_info = {};
+    lazy_alloc_info.usage = VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED;
+    for (std::size_t i = 0; i < this->transients.declared.size(); ++i)
+    {
+        auto& [target, info] = this->transients.declared[i];
+        vk::ImageUsageFlags usage = info.usage;
+        if (info.tile_only) usage |= vk::ImageUsageFlagBits::eTransientAttachment;
+        vk::ImageCreateInfo image_info({}, vk::ImageType::e2D, info.format, this->draw_image.extent, 1, 1, vk::SampleCountFlagBits::e1,
+                vk::ImageTiling::eOptimal, usage);
+        vk::DeviceImageMemoryRequirements requirements_info(&image_info);
+        vk::MemoryRequirements requirements = this->device.dev.getImageMemoryRequirements(requirements_info).memoryRequirements;
+        this->transients.unaliased_size += requirements.size;
+
+        // NOTE: Lazily allocated memory is only committed where the tile memory of the attachment spills, so it is not aliased.
+        std::uint32_t lazy_type;
+        if (info.tile_only && vmaFindMemoryTypeIndexForImageInfo(this->allocator, (VkImageCreateInfo*)&image_info, &lazy_alloc_info, &lazy_type)
+                == VK_SUCCESS)
+        {
+            allocated_image_t img{ .extent = image_info.extent, .format = info.format };
+            if (vmaCreateImage(this->allocator, (VkImageCreateInfo*)&image_info, &lazy_alloc_info, (VkImage*)&img.image, &img.allocation, nullptr)
+                    != VK_SUCCESS)
             {
-            vk::BufferCopy vertex_copy( {}, {}, vertex_buffer_size );
-            cmd.copyBuffer(staging.value().buffer, buf.vertex_buffer.buffer, vertex_copy);
-            vk::BufferCopy index_copy( vertex_buffer_size, 0, index_buffer_size );
-            cmd.copyBuffer(staging.value().buffer, buf.index_buffer.buffer, index_copy);
+                fmt::print(stderr, "[ {} ]\tFailed to create lazily allocated image!\n", ERROR_FMT("ERROR"));
+                return fail();
+            }
+            this->track_allocation(img.allocation, memory_category_e::RENDER_TARGETS, "transient image");
+            this->transients.images.push_back(img);
+            if (!create_view(this->transients.images.back(), info)) return fail();
+            *target = this->transients.images.back();
+            this->transients.lazy_size += requirements.size;
+            continue;
+        }
+
+        memory_type_bits &= requirements.memoryTypeBits;
+        alignment = std::max(alignment, requirements.alignment);
+        placements.push_back(placement_t{ .declared = i, .info = image_info, .requirements = requirements });
+    }
+    if (placements.empty()) return true;
+
+    // NOTE: Placed images are kept sorted by offset, so the first gap that fits is found in one pass over them.
+    std::sort(placements.begin(), placements.end(), [](const placement_t& a, const placement_t& b) {
+            return a.requirements.size > b.requirements.size;
             });
+    std::vector<const placement_t*> placed;
+    for (placement_t& placement : placements)
+    {
+        const transient_image_info_t& info = this->transients.declared[placement.declared].second;
+        vk::DeviceSize align = placement.requirements.alignment;
+        for (const placement_t* other : placed)
+        {
+            const transient_image_info_t& other_info = this->transients.declared[other->declared].second;
+            if (info.first_pass > other_info.last_pass || other_info.first_pass > info.last_pass) continue;
+            if (placement.offset + placement.requirements.size <= other->offset) break;
+            placement.offset = std::max(placement.offset, (other->offset + other->requirements.size + align - 1) / align * align);
+        }
+        placed.insert(std::upper_bound(placed.begin(), placed.end(), &placement, [](const placement_t* a, const placement_t* b) {
+                    return a->offset < b->offset;
+                    }), &placement);
+        this->transients.size = std::max(this->transients.size, placement.offset + placement.requirements.size);
+    }
+
+    // NOTE: Aliasing only saves memory, images without a memory type in common get an allocation each instead.
+    if (memory_type_bits == 0)
+    {
+        fmt::print(stderr, "[ {} ]\tTransient images have no memory type in common, they are not aliased!\n", WARN_FMT("WARNING"));
+        this->transients.size = 0;
+        VmaAllocationCreateInfo image_alloc_info = { .usage = VMA_MEMORY_USAGE_AUTO, .requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT };
+        for (const placement_t& placement : placements)
+        {
+            auto& [target, info] = this->transients.declared[placement.declared];
+            allocated_image_t img{ .extent = placement.info.extent, .format = info.format };
+            if (vmaCreateImage(this->allocator, (VkImageCreateInfo*)&placement.info, &image_alloc_info, (VkImage*)&img.image, &img.allocation,
+                        nullptr) != VK_SUCCESS)
+            {
+                fmt::print(stderr, "[ {} ]\tFailed to create transient image!\n", ERROR_FMT("ERROR"));
+                return fail();
+            }
+            this->track_allocation(img.allocation, memory_category_e::RENDER_TARGETS, "transient image");
+            this->transients.images.push_back(img);
+            if (!create_view(this->transients.images.back(), info)) return fail();
+            *target = this->transients.images.back();
+            this->transients.size += placement.requirements.size;
+        }
+        return true;
+    }
+    VkMemoryRequirements memory_requirements = { .size = this->transients.size, .alignment = alignment, .memoryTypeBits = memory_type_bits };
+    VmaAllocationCreateInfo alloc_info = {};
+    alloc_info.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+    alloc_info.requiredFlags = VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    if (vmaAllocateMemory(this->allocator, &memory_requirements, &alloc_info, &this->transients.allocation, nullptr) != VK_SUCCESS)
+    {
+        fmt::print(stderr, "[ {} ]\tFailed to allocate memory of transient images!\n", ERROR_FMT("ERROR"));
+        return fail();
+    }
+    this->track_allocation(this->transients.allocation, memory_category_e::RENDER_TARGETS, "transient images");
+
+    for (const placement_t& placement : placements)
+    {
+        auto& [target, info] = this->transients.declared[placement.declared];
+        allocated_image_t img{ .allocation = nullptr, .extent = placement.info.extent, .format = info.format };
+        if (vmaCreateAliasingImage2(this->allocator, this->transients.allocation, placement.offset, (VkImageCreateInfo*)&placement.info,
+                    (VkImage*)&img.image) != VK_SUCCESS)
+        {
+            fmt::print(stderr, "[ {} ]\tFailed to create aliasing image!\n", ERROR_FMT("ERROR"));
+            return fail();
+        }
+        this->transients.images.push_back(img);
+        if (!create_view(this->transients.images.back(), info)) return fail();
+        *target = this->transients.images.back();
+    }
+
+#ifdef DEBUG
+    fmt::print("[ {} ]\tTransient images: {} MiB aliased, {} MiB without aliasing, {} MiB lazily allocated\n", INFO_FMT("INFO"),
+            this->transients.size >> 20, this->transients.unaliased_size >> 20, this->transients.lazy_size >> 20);
+#endif
+    return true;
+}
+
+void engine_t::destroy_transient_images()
+{
+    destroy_transients(this, this->transients.images, this->transients.allocation);
+    this->transients.images.clear();
+    this->transients.allocation = nullptr;
+}
+
+void engine_t::track_allocation(VmaAllocation allocation, memory_category_e category, const char* name)
+{
+    if (!allocation) return;
+    VmaAllocationInfo info;
+    vmaGetAllocationInfo(this->allocator, allocation, &info);
+    // NOTE: The category is stored off by one, so allocations that are not tracked have no user data.
+    vmaSetAllocationUserData(this->allocator, allocation, reinterpret_cast<void*>(std::uintptr_t(category) + 1));
+    if (name) vmaSetAllocationName(this->allocator, allocation, name);
+    this->memory.allocations[std::size_t(category)]++;
+    this->memory.bytes[std::size_t(category)] += info.size;
+}
+
+void engine_t::untrack_allocation(VmaAllocation allocation)
+{
+    if (!allocation) return;
+    VmaAllocationInfo info;
+    vmaGetAllocationInfo(this->allocator, allocation, &info);
+    if (!info.pUserData) return;
+    std::size_t category = reinterpret_cast<std::uintptr_t>(info.pUserData) - 1;
+    vmaSetAllocationUserData(this->allocator, allocation, nullptr);
+    this->memory.allocations[category]--;
+    this->memory.bytes[category] -= info.size;
+}
+
+memory_report_t engine_t::memory_report()
+{
+    memory_report_t report;
+
+    std::array<VmaBudget, VK_MAX_MEMORY_HEAPS> budgets;
+    vmaGetHeapBudgets(this->allocator, budgets.data());
+    VmaTotalStatistics stats;
+    vmaCalculateStatistics(this->allocator, &stats);
+    const VkPhysicalDeviceMemoryProperties* memory_props;
+    vmaGetMemoryProperties(this->allocator, &memory_props);
+    for (std::uint32_t heap = 0; heap < memory_props->memoryHeapCount; ++heap)
+    {
+        const VmaStatistics& heap_stats = stats.memoryHeap[heap].statistics;
+        report.heaps.push_back(memory_report_t::heap_t{ .device_local = bool(memory_props->memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT),
+                .usage = budgets[heap].usage, .budget = budgets[heap].budget, .allocations = heap_stats.allocationCount,
+                .allocation_bytes = heap_stats.allocationBytes, .block_bytes = heap_stats.blockBytes });
+    }
+    report.allocations = stats.total.statistics.allocationCount;
+    report.allocation_bytes = stats.total.statistics.allocationBytes;
+    report.block_bytes = stats.total.statistics.blockBytes;
+
+    // NOTE: The upload manager allocates its staging buffers itself, so they are counted from its state instead.
+    std::uint32_t tracked = 0;
+    vk::DeviceSize tracked_bytes = 0;
+    for (std::size_t i = 0; i < MEMORY_CATEGORY_COUNT; ++i)
+    {
+        report.categories[i].allocations = this->memory.allocations[i];
+        report.categories[i].bytes = this->memory.bytes[i];
+        tracked += report.categories[i].allocations;
+        tracked_bytes += report.categories[i].bytes;
+    }
+    auto [staging_count, staging_bytes] = this->uploads.staging_memory();
+    memory_report_t::category_t& staging = report.categories[std::size_t(memory_category_e::STAGING)];
+    staging.allocations += staging_count;
+    staging.bytes += staging_bytes;
+    tracked += staging_count;
+    tracked_bytes += staging_bytes;
+    memory_report_t::category_t& other = report.categories[std::size_t(memory_category_e::OTHER)];
+    other.allocations += report.allocations - std::min(report.allocations, tracked);
+    other.bytes += report.allocation_bytes - std::min(report.allocation_bytes, tracked_bytes);
+
+    auto image_size = [&](const allocated_image_t& img) -> vk::DeviceSize
+    {
+        if (!img.allocation) return 0;
+        VmaAllocationInfo info;
+        vmaGetAllocationInfo(this->allocator, img.allocation, &info);
+        return info.size;
+    };
+    std::lock_guard<std::mutex> lock(this->resource_mutex);
+    for (auto& [name, scene] : this->loaded_scenes)
+    {
+        memory_report_t::scene_t scene_report{ .name = name };
+        for (auto& [image_name, img] : scene->images)
+        {
+            ++scene_report.images;
+            scene_report.image_bytes += image_size(img);
+        }
+        for (const streamed_texture_t& texture : scene->streamed_textures)
+        {
+            ++scene_report.images;
+            scene_report.image_bytes += image_size(texture.image);
+            if (texture.pending_image.has_value()) scene_report.image_bytes += image_size(texture.pending_image.value());
+        }
+        for (auto& [mesh_name, mesh] : scene->meshes)
+        {
+            if (!mesh->mesh_buffer.vertex_allocation || !mesh->mesh_buffer.index_allocation) continue;
+            VmaVirtualAllocationInfo vertex_info, index_info;
+            vmaGetVirtualAllocationInfo(this->geometry.vertex_block, mesh->mesh_buffer.vertex_allocation, &vertex_info);
+            vmaGetVirtualAllocationInfo(this->geometry.index_block, mesh->mesh_buffer.index_allocation, &index_info);
+            ++scene_report.meshes;
+            scene_report.mesh_bytes += vertex_info.size + index_info.size;
+        }
+        report.scenes.push_back(scene_report);
+    }
+
+    VmaStatistics vertex_stats, index_stats;
+    vmaGetVirtualBlockStatistics(this->geometry.vertex_block, &vertex_stats);
+    vmaGetVirtualBlockStatistics(this->geometry.index_block, &index_stats);
+    report.geometry_used = vertex_stats.allocationBytes + index_stats.allocationBytes;
+    report.geometry_size = GEOMETRY_POOL_VERTEX_SIZE + GEOMETRY_POOL_INDEX_SIZE;
+
+    return report;
+}
+
+std::string engine_t::memory_report_json(bool detailed)
+{
+    memory_report_t report = this->memory_report();
+    auto escape = [](const std::string& str)
+    {
+        std::string escaped;
+        for (char c : str)
+        {
+            if (c == '"' || c == '\\') escaped.push_back('\\');
+            if (std::uint8_t(c) >= 0x20) escaped.push_back(c);
+        }
+        return escaped;
+    };
+
+    std::string json = fmt::format("{{\"allocations\":{},\"allocation_bytes\":{},\"block_bytes\":{},\"geometry_used\":{},\"geometry_size\":{},\"heaps\":[",
+            report.allocations, report.allocation_bytes, report.block_bytes, report.geometry_used, report.geometry_size);
+    for (std::size_t i = 0; i < report.heaps.size(); ++i)
+    {
+        const memory_report_t::heap_t& heap = report.heaps[i];
+        json += fmt::format("{}{{\"device_local\":{},\"usage\":{},\"budget\":{},\"allocations\":{},\"allocation_bytes\":{},\"block_bytes\":{}}}",
+                i > 0 ? "," : "", heap.device_local, heap.usage, heap.budget, heap.allocations, heap.allocation_bytes, heap.block_bytes);
+    }
+    json += "],\"categories\":{";
+    for (std::size_t i = 0; i < MEMORY_CATEGORY_COUNT; ++i)
+    {
+        json += fmt::format("{}\"{}\":{{\"allocations\":{},\"bytes\":{}}}", i > 0 ? "," : "", MEMORY_CATEGORY_NAMES[i],
+                report.categories[i].allocations, report.categories[i].bytes);
+    }
+    json += "},\"scenes\":[";
+    for (std::size_t i = 0; i < report.scenes.size(); ++i)
+    {
+        const memory_report_t::scene_t& scene = report.scenes[i];
+        json += fmt::format("{}{{\"name\":\"{}\",\"images\":{},\"image_bytes\":{},\"meshes\":{},\"mesh_bytes\":{}}}", i > 0 ? "," : "",
+                escape(scene.name), scene.images, scene.image_bytes, scene.meshes, scene.mesh_bytes);
+    }
+    json += "]";
+
+    if (detailed)
+    {
+        char* stats_string;
+        vmaBuildStatsString(this->allocator, &stats_string, VK_TRUE);
+        json += fmt::format(",\"vma\":{}", stats_string);
+        vmaFreeStatsString(this->allocator, stats_string);
+    }
+    json += "}";
+    return json;
+}
+
+bool engine_t::dump_memory_report(const std::string& path, bool detailed)
+{
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open() || !(file << this->memory_report_json(detailed)))
+    {
+        fmt::print(stderr, "[ {} ]\tFailed to write memory report to {}!\n", ERROR_FMT("ERROR"), path);
+        return false;
+    }
+    return true;
+}
+
+void engine_t::report_leaks()
+{
+    VmaTotalStatistics stats;
+    vmaCalculateStatistics(this->allocator, &stats);
+    if (stats.total.statistics.allocationCount == 0) return;
+
+    fmt::print(stderr, "[ {} ]\t{} allocations with {} bytes are still alive at shutdown!\n", WARN_FMT("WARNING"),
+            stats.total.statistics.allocationCount, stats.total.statistics.allocationBytes);
+    for (std::size_t i = 0; i < MEMORY_CATEGORY_COUNT; ++i)
+    {
+        if (this->memory.allocations[i] == 0) continue;
+        fmt::print(stderr, "\t{}: {} allocations with {} bytes\n", MEMORY_CATEGORY_NAMES[i], this->memory.allocations[i].load(),
+                this->memory.bytes[i].load());
+    }
+#ifdef DEBUG
+    // NOTE: The detailed map lists every allocation that is still alive with its name.
+    char* stats_string;
+    vmaBuildStatsString(this->allocator, &stats_string, VK_TRUE);
+    fmt::print(stderr, "{}\n", stats_string);
+    vmaFreeStatsString(this->allocator, stats_string);
+#endif
+}
+
+bool engine_t::supports_host_image_copy(vk::Format format, vk::ImageUsageFlags usage)
+{
+    // NOTE: Host copies may force layouts the device samples from more slowly, e.g. without framebuffer compression.
+    vk::HostImageCopyDevicePerformanceQueryEXT performance_query;
+    vk::ImageFormatProperties2 format_props({}, &performance_query);
+    vk::PhysicalDeviceImageFormatInfo2 format_info(format, vk::ImageType::e2D, vk::ImageTiling::eOptimal, usage | vk::ImageUsageFlagBits::eHostTransferEXT);
+    if (this->physical_device.getImageFormatProperties2(&format_info, &format_props) != vk::Result::eSuccess) return false;
+    return performance_query.optimalDeviceAccess;
+}
 
-    this->destroy_buffer(staging.value());
+bool engine_t::copy_image_from_host(const allocated_image_t& image, const void* data, bool mipmapped, mip_filter_e filter)
+{
+    vk::Extent2D extent(image.extent.width, image.extent.height);
+    std::uint32_t mip_levels = mipmapped ? vkutil::mip_level_count(extent) : 1;
+
+    vk::HostImageLayoutTransitionInfoEXT transition(image.image, vk::ImageLayout::eUndefined, vk::ImageLayout::eShaderReadOnlyOptimal,
+            vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, mip_levels, 0, 1));
+    if (this->device.dev.transitionImageLayoutEXT(1, &transition, this->dispatch) != vk::Result::eSuccess)
+    {
+        fmt::print(stderr, "[ {} ]\tFailed to transition image on the host!\n", ERROR_FMT("ERROR"));
+        return false;
+    }
+
+    const std::uint8_t* texels = (const std::uint8_t*)data;
+    std::vector<std::uint8_t> level;
+    for (std::uint32_t mip = 0; mip < mip_levels; ++mip)
+    {
+        vk::MemoryToImageCopyEXT region(texels, 0, 0, vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, mip, 0, 1), {},
+                vk::Extent3D(extent.width, extent.height, 1));
+        vk::CopyMemoryToImageInfoEXT copy_info({}, image.image, vk::ImageLayout::eShaderReadOnlyOptimal, 1, &region);
+        if (this->device.dev.copyMemoryToImageEXT(&copy_info, this->dispatch) != vk::Result::eSuccess)
+        {
+            fmt::print(stderr, "[ {} ]\tFailed to copy image from host memory!\n", ERROR_FMT("ERROR"));
+            return false;
+        }
+
+        if (mip + 1 < mip_levels)
+        {
+            level = vkutil::downsample_rgba8(texels, extent, filter == mip_filter_e::AVERAGE_SRGB);
+            texels = level.data();
+            extent = vk::Extent2D(std::max(extent.width / 2, 1u), std::max(extent.height / 2, 1u));
+        }
+    }
+    return true;
+}
+
+std::optional<gpu_mesh_buffer_t> engine_t::upload_mesh(std::span<std::uint32_t> indices, std::span<vertex_t> vertices, vertex_format_e format,
+        upload_group_t* group)
+{
+    gpu_mesh_buffer_t buf;
+    buf.vertex_format = format;
+    std::vector<std::byte> vertex_data = vkutil::pack_vertices(vertices, format, buf.position_offset, buf.position_scale);
+
+    // NOTE: Primitive restart is disabled, so 0xFFFF is a valid 16 bit index.
+    std::vector<std::uint16_t> indices_16;
+    if (vertices.size() <= std::numeric_limits<std::uint16_t>::max() + 1)
+    {
+        buf.index_type = vk::IndexType::eUint16;
+        indices_16.assign(indices.begin(), indices.end());
+    }
+    const void* index_data = (buf.index_type == vk::IndexType::eUint16) ? (const void*)indices_16.data() : (const void*)indices.data();
+
+    const std::size_t vertex_buffer_size = vertex_data.size();
+    const std::size_t index_size = (buf.index_type == vk::IndexType::eUint16) ? sizeof(std::uint16_t) : sizeof(std::uint32_t);
+    const std::size_t index_buffer_size = indices.size() * index_size;
+    if (vertex_buffer_size == 0 || index_buffer_size == 0)
+    {
+        fmt::print(stderr, "[ {} ]\tCan not upload an empty mesh!\n", ERROR_FMT("ERROR"));
+        return std::nullopt;
+    }
+
+    // NOTE: Vertices are read through buffer references which require 16 byte alignment.
+    // Index ranges are 4 byte aligned so 16 and 32 bit indices can share the index buffer.
+    VmaVirtualAllocationCreateInfo vertex_alloc_info = { .size = vertex_buffer_size, .alignment = 16 };
+    VmaVirtualAllocationCreateInfo index_alloc_info = { .size = index_buffer_size, .alignment = 4 };
+    vk::DeviceSize vertex_offset;
+    vk::DeviceSize index_offset;
+    {
+        std::lock_guard<std::mutex> lock(this->resource_mutex);
+        if (vmaVirtualAllocate(this->geometry.vertex_block, &vertex_alloc_info, &buf.vertex_allocation, &vertex_offset) != VK_SUCCESS)
+        {
+            fmt::print(stderr, "[ {} ]\tGeometry pool is out of vertex memory!\n", ERROR_FMT("ERROR"));
+            return std::nullopt;
+        }
+        if (vmaVirtualAllocate(this->geometry.index_block, &index_alloc_info, &buf.index_allocation, &index_offset) != VK_SUCCESS)
+        {
+            fmt::print(stderr, "[ {} ]\tGeometry pool is out of index memory!\n", ERROR_FMT("ERROR"));
+            vmaVirtualFree(this->geometry.vertex_block, buf.vertex_allocation);
+            return std::nullopt;
+        }
+    }
+    auto free_ranges = [&]()
+    {
+        std::lock_guard<std::mutex> lock(this->resource_mutex);
+        vmaVirtualFree(this->geometry.vertex_block, buf.vertex_allocation);
+        vmaVirtualFree(this->geometry.index_block, buf.index_allocation);
+    };
+
+    buf.index_buffer = this->geometry.index_buffer.buffer;
+    buf.first_index = index_offset / index_size;
+    buf.vertex_buffer_address = this->geometry.vertex_buffer_address + vertex_offset;
+
+    if (this->geometry.host_visible)
+    {
+        std::memcpy((std::uint8_t*)this->geometry.vertex_buffer.info.pMappedData + vertex_offset, vertex_data.data(), vertex_buffer_size);
+        std::memcpy((std::uint8_t*)this->geometry.index_buffer.info.pMappedData + index_offset, index_data, index_buffer_size);
+        // NOTE: Flushing does nothing for coherent memory. Host writes are visible to every later submission, so the mesh needs no ticket.
+        if (vmaFlushAllocation(this->allocator, this->geometry.vertex_buffer.allocation, vertex_offset, vertex_buffer_size) != VK_SUCCESS
+                || vmaFlushAllocation(this->allocator, this->geometry.index_buffer.allocation, index_offset, index_buffer_size) != VK_SUCCESS)
+        {
+            fmt::print(stderr, "[ {} ]\tFailed to flush mesh!\n", ERROR_FMT("ERROR"));
+            free_ranges();
+            return std::nullopt;
+        }
+        return buf;
+    }
+
+    // NOTE: Tickets only grow, so the ticket of the index copy also covers the vertex copy.
+    auto ticket = this->uploads.upload_buffer(this->geometry.vertex_buffer.buffer, vertex_offset, vertex_data.data(), vertex_buffer_size, group);
+    if (ticket.has_value()) ticket = this->uploads.upload_buffer(this->geometry.index_buffer.buffer, index_offset, index_data, index_buffer_size, group);
+    if (!ticket.has_value())
+    {
+        free_ranges();
+        return std::nullopt;
+    }
+    buf.ticket = ticket.value();
 
     return buf;
 }
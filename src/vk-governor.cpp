@@ -0,0 +1,47 @@
+#include <vk-governor.h>
+#include <algorithm>
+
+void quality_governor_t::register_knob(std::string name, float* value, float low, float high)
+{
+    this->knobs.push_back({ name, value, low, high });
+    *value = low + (high - low) * this->quality;
+}
+
+void quality_governor_t::remove_knob(const float* value)
+{
+    std::erase_if(this->knobs, [value](const quality_knob_t& knob) { return knob.value == value; });
+}
+
+bool quality_governor_t::update(float gpu_frame_time)
+{
+    if (gpu_frame_time <= 0.f) return false;
+
+    if (this->smoothed_frame_time <= 0.f) this->smoothed_frame_time = gpu_frame_time;
+    else this->smoothed_frame_time += (gpu_frame_time - this->smoothed_frame_time) * this->smoothing;
+
+    this->frames_since_change++;
+    if (!this->enabled || this->frames_since_change < this->cooldown_frames) return false;
+
+    float upper = this->target_frame_time * (1.f + this->upper_margin);
+    float lower = this->target_frame_time * (1.f - this->lower_margin);
+    if (this->smoothed_frame_time <= upper && this->smoothed_frame_time >= lower) return false;
+
+    // NOTE: The error is relative so the governor behaves the same for any target frame time.
+    float error = (this->target_frame_time - this->smoothed_frame_time) / this->target_frame_time;
+    float step = std::clamp(error * this->gain, -this->max_step, this->max_step);
+    float quality = std::clamp(this->quality + step, 0.f, 1.f);
+    if (quality == this->quality) return false;
+
+    this->quality = quality;
+    this->frames_since_change = 0;
+    this->apply_knobs();
+    return true;
+}
+
+void quality_governor_t::apply_knobs()
+{
+    for (quality_knob_t& knob : this->knobs)
+    {
+        *knob.value = knob.low + (knob.high - knob.low) * this->quality;
+    }
+}
@@ -1,8 +1,11 @@
+#include <algorithm>
+#include <array>
 #include <cmath>
 #include <cstdint>
 #include <vk-images.h>
 
-void vkutil::transition_image(vk::CommandBuffer cmd, vk::Image img, vk::ImageLayout current, vk::ImageLayout target)
+void vkutil::transition_image(vk::CommandBuffer cmd, vk::Image img, vk::ImageLayout current, vk::ImageLayout target, std::uint32_t base_level,
+        std::uint32_t level_count)
 {
     vk::ImageMemoryBarrier2 img_barrier(
             vk::PipelineStageFlagBits2::eAllCommands,
@@ -11,7 +14,7 @@ void vkutil::transition_image(vk::CommandBuffer cmd, vk::Image img, vk::ImageLay
             vk::AccessFlagBits2::eMemoryWrite | vk::AccessFlagBits2::eMemoryRead,
             current, target, {}, {}, img, vk::ImageSubresourceRange(
                 (target == vk::ImageLayout::eDepthAttachmentOptimal) ? vk::ImageAspectFlagBits::eDepth : vk::ImageAspectFlagBits::eColor,
-                0, VK_REMAINING_MIP_LEVELS,
+                base_level, level_count,
                 0, VK_REMAINING_ARRAY_LAYERS
                 )
             );
@@ -29,17 +32,22 @@ void vkutil::copy_image_to_image(vk::CommandBuffer cmd, vk::Image src, vk::Image
     cmd.blitImage2(blit_info);
 }
 
+std::uint32_t vkutil::mip_level_count(vk::Extent2D size)
+{
+    return std::uint32_t(std::floor(std::log2(std::max(size.width, size.height)))) + 1;
+}
+
 void vkutil::generate_mipmaps(vk::CommandBuffer cmd, vk::Image image, vk::Extent2D image_size)
 {
-    std::uint32_t mip_levels = std::uint32_t(std::floor(std::log2(std::max(image_size.width, image_size.height)))) + 1;
+    std::uint32_t mip_levels = mip_level_count(image_size);
     for (std::uint32_t mip = 0; mip < mip_levels; ++mip)
     {
-        vk::Extent2D half_size = image_size;
-        half_size.width /= 2;
-        half_size.height /= 2;
+        // NOTE: The shorter side of images that are not square reaches a size of 1 before the last level.
+        vk::Extent2D half_size(std::max(image_size.width / 2, 1u), std::max(image_size.height / 2, 1u));
 
-        vk::ImageMemoryBarrier2 image_barrier(vk::PipelineStageFlagBits2::eAllCommands, vk::AccessFlagBits2::eMemoryWrite,
-                vk::PipelineStageFlagBits2::eAllCommands, vk::AccessFlagBits2::eMemoryWrite | vk::AccessFlagBits2::eMemoryRead,
+        // NOTE: Each level is written by the copy or blit before and only read by the blit of the next level.
+        vk::ImageMemoryBarrier2 image_barrier(vk::PipelineStageFlagBits2::eAllTransfer, vk::AccessFlagBits2::eTransferWrite,
+                vk::PipelineStageFlagBits2::eBlit, vk::AccessFlagBits2::eTransferRead,
                 vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eTransferSrcOptimal, {}, {}, image,
                 vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, mip, 1, 0, VK_REMAINING_ARRAY_LAYERS));
         vk::DependencyInfo dep_info({}, {}, {}, {}, {}, 1, &image_barrier);
@@ -57,3 +65,49 @@ void vkutil::generate_mipmaps(vk::CommandBuffer cmd, vk::Image image, vk::Extent
     }
     transition_image(cmd, image, vk::ImageLayout::eTransferSrcOptimal, vk::ImageLayout::eShaderReadOnlyOptimal);
 }
+
+std::vector<std::uint8_t> vkutil::downsample_rgba8(const std::uint8_t* texels, vk::Extent2D size, bool srgb)
+{
+    static const std::array<float, 256> srgb_to_linear = []()
+    {
+        std::array<float, 256> table;
+        for (std::uint32_t i = 0; i < 256; ++i)
+        {
+            float c = i / 255.f;
+            table[i] = c <= .04045f ? c / 12.92f : std::pow((c + .055f) / 1.055f, 2.4f);
+        }
+        return table;
+    }();
+
+    vk::Extent2D half_size(std::max(size.width / 2, 1u), std::max(size.height / 2, 1u));
+    std::vector<std::uint8_t> result(half_size.width * half_size.height * 4);
+    for (std::uint32_t y = 0; y < half_size.height; ++y)
+    {
+        // NOTE: The last texel of an odd dimension covers 3 source texels so none of them are dropped.
+        std::uint32_t y_begin = y * 2;
+        std::uint32_t y_end = (y == half_size.height - 1) ? size.height : std::min(y_begin + 2, size.height);
+        for (std::uint32_t x = 0; x < half_size.width; ++x)
+        {
+            std::uint32_t x_begin = x * 2;
+            std::uint32_t x_end = (x == half_size.width - 1) ? size.width : std::min(x_begin + 2, size.width);
+            float sum[4] = {};
+            for (std::uint32_t sy = y_begin; sy < y_end; ++sy)
+            {
+                for (std::uint32_t sx = x_begin; sx < x_end; ++sx)
+                {
+                    const std::uint8_t* texel = &texels[(sy * size.width + sx) * 4];
+                    for (std::uint32_t c = 0; c < 3; ++c) sum[c] += srgb ? srgb_to_linear[texel[c]] : texel[c] / 255.f;
+                    sum[3] += texel[3] / 255.f;
+                }
+            }
+            float count = float((y_end - y_begin) * (x_end - x_begin));
+            for (std::uint32_t c = 0; c < 4; ++c)
+            {
+                float value = sum[c] / count;
+                if (srgb && c < 3) value = value <= .0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.f / 2.4f) - .055f;
+                result[(y * half_size.width + x) * 4 + c] = std::uint8_t(std::clamp(value, 0.f, 1.f) * 255.f + .5f);
+            }
+        }
+    }
+    return result;
+}
@@ -0,0 +1,83 @@
+#include <vk-jobs.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+void job_pool_t::init(std::uint32_t thread_count)
+{
+    if (thread_count == 0) thread_count = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    this->stopping = false;
+    for (std::uint32_t i = 0; i < thread_count; ++i) this->workers.emplace_back([this]() { this->work(); });
+}
+
+void job_pool_t::destroy()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+        this->jobs.clear();
+    }
+    this->condition.notify_all();
+    for (std::thread& worker : this->workers) worker.join();
+    this->workers.clear();
+}
+
+void job_pool_t::submit(std::function<void()>&& job)
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->jobs.push_back(std::move(job));
+    }
+    this->condition.notify_one();
+}
+
+void job_pool_t::parallel_for(std::size_t count, const std::function<void(std::size_t)>& function)
+{
+    if (count == 0) return;
+
+    struct loop_t
+    {
+        std::atomic<std::size_t> next = 0;
+        std::atomic<std::size_t> done = 0;
+        std::mutex mutex;
+        std::condition_variable condition;
+    };
+    std::shared_ptr<loop_t> loop = std::make_shared<loop_t>();
+
+    // NOTE: Helpers that only start once every index is taken return right away, so `function` is never called after this returns.
+    auto run = [loop, count, &function]()
+    {
+        for (std::size_t i = loop->next++; i < count; i = loop->next++)
+        {
+            function(i);
+            if (++loop->done == count)
+            {
+                std::lock_guard<std::mutex> lock(loop->mutex);
+                loop->condition.notify_all();
+            }
+        }
+    };
+
+    std::size_t helpers = std::min(this->workers.size(), count - 1);
+    for (std::size_t i = 0; i < helpers; ++i) this->submit(run);
+    run();
+
+    std::unique_lock<std::mutex> lock(loop->mutex);
+    loop->condition.wait(lock, [&]() { return loop->done == count; });
+}
+
+void job_pool_t::work()
+{
+    while (true)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->condition.wait(lock, [this]() { return this->stopping || !this->jobs.empty(); });
+            if (this->stopping) return;
+            job = std::move(this->jobs.front());
+            this->jobs.pop_front();
+        }
+        job();
+    }
+}
@@ -2,6 +2,7 @@
 #include <stb_image.h>
 
 #include <vk-engine.h>
+#include <vk-mesh.h>
 #include <vk-types.h>
 #include <glm/gtx/quaternion.hpp>
 
@@ -9,14 +10,28 @@
 #include <fastgltf/parser.hpp>
 #include <fastgltf/tools.hpp>
 
+#include <algorithm>
 #include <filesystem>
+#include <fstream>
 #include <error_fmt.h>
 
-std::optional<allocated_image_t> load_image(engine_t* engine, fastgltf::Asset& asset, fastgltf::Image& image)
+// Texels of a glTF image decoded to 4 channels, `data` has to be freed with `stbi_image_free`.
+// KTX2 files, images compressed on import and images whose mip chain is built on the CPU are returned in `texture` with all of
+// their mip levels instead.
+struct decoded_image_t
 {
-    allocated_image_t new_image {};
+    unsigned char* data = nullptr;
+    vk::Extent3D extent;
+    std::optional<texture_data_t> texture;
+};
+
+std::optional<decoded_image_t> decode_image(engine_t* engine, fastgltf::Asset& asset, fastgltf::Image& image, bool srgb, bool mip_chain)
+{
+    decoded_image_t decoded {};
     int width, height, nr_channels;
 
+    std::vector<std::uint8_t> file_bytes;
+    std::span<const std::uint8_t> bytes;
     std::visit(
         fastgltf::visitor {
             [](auto& arg) {},
@@ -24,26 +39,14 @@ std::optional<allocated_image_t> load_image(engine_t* engine, fastgltf::Asset& a
                 assert(filepath.fileByteOffset == 0);
                 assert(filepath.uri.isLocalPath());
                 const std::string path(filepath.uri.path().begin(), filepath.uri.path().end());
-                unsigned char* data = stbi_load(path.c_str(), &width, &height, &nr_channels, 4);
-                if (data)
-                {
-                    vk::Extent3D image_size(width, height, 1);
-                    auto ret = engine->create_image(data, image_size, vk::Format::eR8G8B8A8Unorm, vk::ImageUsageFlagBits::eSampled, true);
-                    assert(ret.has_value());
-                    new_image = ret.value();
-                    stbi_image_free(data);
-                }
+                std::ifstream file(path, std::ios::binary | std::ios::ate);
+                if (!file.is_open()) return;
+                file_bytes.resize(file.tellg());
+                file.seekg(0);
+                if (file.read((char*)file_bytes.data(), file_bytes.size())) bytes = file_bytes;
             },
             [&](fastgltf::sources::Vector& vector) {
-                unsigned char* data = stbi_load_from_memory(vector.bytes.data(), vector.bytes.size(), &width, &height, &nr_channels, 4);
-                if (data)
-                {
-                    vk::Extent3D image_size(width, height, 1);
-                    auto ret = engine->create_image(data, image_size, vk::Format::eR8G8B8A8Unorm, vk::ImageUsageFlagBits::eSampled, true);
-                    assert(ret.has_value());
-                    new_image = ret.value();
-                    stbi_image_free(data);
-                }
+                bytes = std::span<const std::uint8_t>(vector.bytes.data(), vector.bytes.size());
             },
             [&](fastgltf::sources::BufferView& view)
             {
@@ -54,22 +57,60 @@ std::optional<allocated_image_t> load_image(engine_t* engine, fastgltf::Asset& a
                         [](auto& arg){},
                         [&](fastgltf::sources::Vector& vector)
                         {
-                            unsigned char* data = stbi_load_from_memory(vector.bytes.data() + buffer_view.byteOffset, buffer_view.byteLength,
-                                &width, &height, &nr_channels, 4);
-                            if (data)
-                            {
-                                vk::Extent3D image_size(width, height, 1);
-                                auto ret = engine->create_image(data, image_size, vk::Format::eR8G8B8A8Unorm, vk::ImageUsageFlagBits::eSampled, true);
-                                assert(ret.has_value());
-                                new_image = ret.value();
-                                stbi_image_free(data);
-                            }
+                            bytes = std::span<const std::uint8_t>(vector.bytes.data() + buffer_view.byteOffset, buffer_view.byteLength);
                         }
                     }, buffer.data);
             } }, image.data);
 
-    if ((VkImage)new_image.image == VK_NULL_HANDLE) return std::nullopt;
-    return new_image;
+    if (bytes.empty()) return std::nullopt;
+    bool bc_supported = engine->device.extensions.texture_compression_bc;
+
+    if (vkutil::is_ktx2(bytes))
+    {
+        if (!bc_supported)
+        {
+            fmt::print(stderr, "[ {} ]\tDevice does not support BC compressed textures!\n", ERROR_FMT("ERROR"));
+            return std::nullopt;
+        }
+        decoded.texture = vkutil::load_ktx2(bytes);
+        if (!decoded.texture.has_value()) return std::nullopt;
+        decoded.extent = decoded.texture.value().extent;
+        return decoded;
+    }
+
+    // NOTE: sRGB images are cached separately, their mip levels are averaged in linear space.
+    bool compress = engine->compress_textures && bc_supported;
+    std::string cache_path;
+    if (compress && !engine->texture_cache_dir.empty())
+    {
+        cache_path = fmt::format("{}/{:016x}{}.bctex", engine->texture_cache_dir, vkutil::hash_bytes(bytes), srgb ? "_srgb" : "");
+        decoded.texture = vkutil::read_texture_cache(cache_path);
+        if (decoded.texture.has_value())
+        {
+            decoded.extent = decoded.texture.value().extent;
+            return decoded;
+        }
+    }
+
+    decoded.data = stbi_load_from_memory(bytes.data(), bytes.size(), &width, &height, &nr_channels, 4);
+    if (!decoded.data) return std::nullopt;
+    decoded.extent = vk::Extent3D(width, height, 1);
+    if (!compress && mip_chain)
+    {
+        decoded.texture = vkutil::build_mip_chain(decoded.data, vk::Extent2D(width, height), srgb);
+        stbi_image_free(decoded.data);
+        decoded.data = nullptr;
+    }
+    if (!compress) return decoded;
+
+    decoded.texture = vkutil::compress_texture(decoded.data, vk::Extent2D(width, height), srgb, &engine->jobs);
+    stbi_image_free(decoded.data);
+    decoded.data = nullptr;
+    if (!cache_path.empty() && !vkutil::write_texture_cache(cache_path, decoded.texture.value()))
+    {
+        fmt::print("[ {} ]\tFailed to write texture cache: {}\n", WARN_FMT("WARNING"), cache_path);
+    }
+    return decoded;
 }
 
 vk::Filter extract_filter(fastgltf::Filter filter)
@@ -102,18 +143,13 @@ vk::SamplerMipmapMode extract_mipmap_mode(fastgltf::Filter filter)
     }
 }
 
-std::optional<std::shared_ptr<loaded_gltf_t>> load_gltf(engine_t* engine, std::string_view filepath, gltf_metallic_roughness_t& material,
-        std::array<std::uint32_t, 3> bindings)
+bool load_gltf(engine_t* engine, loaded_gltf_t& file, std::string_view filepath, gltf_metallic_roughness_t& material, vertex_format_e format)
 {
 #ifdef DEBUG
     fmt::print("[ {} ]\tLoading glTF: {}\n", INFO_FMT("INFO"), filepath);
 #endif
 
-    std::shared_ptr<loaded_gltf_t> scene = std::make_shared<loaded_gltf_t>();
-    scene->creator = engine;
-    loaded_gltf_t& file = *scene.get();
-
-    fastgltf::Parser parser{};
+    fastgltf::Parser parser(fastgltf::Extensions::KHR_texture_basisu);
 
     constexpr auto gltf_options = fastgltf::Options::DontRequireValidAssetMember | fastgltf::Options::AllowDouble
         | fastgltf::Options::LoadGLBBuffers | fastgltf::Options::LoadExternalBuffers;
@@ -133,7 +169,7 @@ std::optional<std::shared_ptr<loaded_gltf_t>> load_gltf(engine_t* engine, std::s
         else
         {
             fmt::print(stderr, "[ {} ]\tFailed to load glTF: {}\n", ERROR_FMT("ERROR"), fastgltf::to_underlying(load.error()));
-            return std::nullopt;
+            return false;
         }
     }
     else if (type == fastgltf::GltfType::GLB)
@@ -146,23 +182,15 @@ std::optional<std::shared_ptr<loaded_gltf_t>> load_gltf(engine_t* engine, std::s
         else
         {
             fmt::print(stderr, "[ {} ]\tFailed to load glTF: {}\n", ERROR_FMT("ERROR"), fastgltf::to_underlying(load.error()));
-            return std::nullopt;
+            return false;
         }
     }
     else
     {
         fmt::print(stderr, "[ {} ]\tFailed to determine glTF container!\n", ERROR_FMT("ERROR"));
-        return std::nullopt;
+        return false;
     }
 
-    std::vector<descriptor_allocator_growable_t::pool_size_ratio_t> sizes = {
-        { vk::DescriptorType::eCombinedImageSampler, 3 },
-        { vk::DescriptorType::eUniformBuffer, 3 },
-        { vk::DescriptorType::eStorageBuffer, 1 }
-    };
-
-    file.descriptor_pool.init(engine->device.dev, gltf.materials.size(), sizes);
-
     for (fastgltf::Sampler& sampler : gltf.samplers)
     {
         vk::SamplerCreateInfo sampler_info({},
@@ -172,101 +200,57 @@ std::optional<std::shared_ptr<loaded_gltf_t>> load_gltf(engine_t* engine, std::s
                 {}, {}, {}, {}, {}, {}, {}, {}, 0, VK_LOD_CLAMP_NONE);
         auto [result, new_sampler] = engine->device.dev.createSampler(sampler_info);
         file.samplers.push_back(new_sampler);
+
+        auto ret = engine->register_sampler(new_sampler);
+        if (!ret.has_value()) return false;
+        file.sampler_indices.push_back(ret.value());
     }
 
     std::vector<std::shared_ptr<mesh_asset_t>> meshes;
     std::vector<std::shared_ptr<node_t>> nodes;
-    std::vector<allocated_image_t> images;
+    std::vector<std::uint32_t> image_indices;
+    std::vector<upload_ticket_t> image_tickets;
     std::vector<std::shared_ptr<gltf_material_t>> materials;
 
-    for (fastgltf::Image& image : gltf.images)
+    // NOTE: Base color textures hold sRGB encoded colors, so their mip levels are averaged in linear space.
+    std::vector<bool> srgb_images(gltf.images.size(), false);
+    for (fastgltf::Material& mat : gltf.materials)
     {
-        std::optional<allocated_image_t> img = load_image(engine, gltf, image);
-        if (img.has_value())
-        {
-            images.push_back(img.value());
-            file.images[image.name.c_str()] = img.value();
-            engine->main_deletion_queue.push_function([=]() {
-                    engine->destroy_image(img.value());
-                });
-        }
-        else
-        {
-            images.push_back(engine->error_checkerboard_image);
-            fmt::print("[ {} ]\tFailed to load glTF texture: {}\n", WARN_FMT("WARNING"), image.name);
-        }
+        if (!mat.pbrData.baseColorTexture.has_value()) continue;
+        fastgltf::Texture& texture = gltf.textures[mat.pbrData.baseColorTexture.value().textureIndex];
+        if (texture.imageIndex.has_value()) srgb_images[texture.imageIndex.value()] = true;
+        if (texture.basisuImageIndex.has_value()) srgb_images[texture.basisuImageIndex.value()] = true;
     }
 
-    auto ret = engine->create_buffer(sizeof(gltf_metallic_roughness_t::material_constants_t) * gltf.materials.size(),
-            vk::BufferUsageFlagBits::eUniformBuffer, VMA_MEMORY_USAGE_CPU_TO_GPU);
-    if (!ret.has_value()) return std::nullopt;
-    file.material_data_buffer = ret.value();
-
-    std::uint32_t data_index = 0;
-    gltf_metallic_roughness_t::material_constants_t* scene_material_constants =
-        (gltf_metallic_roughness_t::material_constants_t*)file.material_data_buffer.info.pMappedData;
-
-    for (fastgltf::Material& mat : gltf.materials)
+    auto host_image_copy = [&](vk::Format format)
     {
-        std::shared_ptr<gltf_material_t> new_mat = std::make_shared<gltf_material_t>();
-        materials.push_back(new_mat);
-
-        gltf_metallic_roughness_t::material_constants_t constants{
-            .color_factors = glm::vec4(mat.pbrData.baseColorFactor[0], mat.pbrData.baseColorFactor[1],
-                    mat.pbrData.baseColorFactor[2], mat.pbrData.baseColorFactor[3]),
-            .metal_rough_factors = glm::vec4(mat.pbrData.metallicFactor, mat.pbrData.roughnessFactor, glm::vec2())
-        };
-        scene_material_constants[data_index] = constants;
-
-        material_pass_e pass_type = (mat.alphaMode == fastgltf::AlphaMode::Blend) ? pass_type = material_pass_e::TRANSPARENT : material_pass_e::MAIN_COLOR;
-        
-        gltf_metallic_roughness_t::material_resources_t::buf_t buffer{ .binding = bindings[0],
-            .buffer = file.material_data_buffer.buffer,
-            .offset = static_cast<std::uint32_t>(data_index * sizeof(gltf_metallic_roughness_t::material_constants_t)),
-            .size = sizeof(gltf_metallic_roughness_t::material_constants_t),
-            .type = vk::DescriptorType::eUniformBuffer
-        };
-
-        gltf_metallic_roughness_t::material_resources_t::img_t color_image{ .binding = bindings[1],
-            .image = engine->white_image,
-            .sampler = engine->default_sampler_linear,
-            .layout = vk::ImageLayout::eShaderReadOnlyOptimal,
-            .type = vk::DescriptorType::eCombinedImageSampler
-        };
-
-        gltf_metallic_roughness_t::material_resources_t::img_t metal_rough_image = color_image;
-        metal_rough_image.binding = bindings[2];
-
-        gltf_metallic_roughness_t::material_resources_t material_resources{ .images = { color_image, metal_rough_image },
-            .buffers = { buffer }
-        };
-
-        if (mat.pbrData.baseColorTexture.has_value())
-        {
-            std::size_t img = gltf.textures[mat.pbrData.baseColorTexture.value().textureIndex].imageIndex.value();
-            std::size_t sampler = gltf.textures[mat.pbrData.baseColorTexture.value().textureIndex].samplerIndex.value();
-
-            material_resources.images[0].image = images[img];
-            material_resources.images[0].sampler = file.samplers[sampler];
-        }
-
-        if (mat.pbrData.metallicRoughnessTexture.has_value())
-        {
-            std::size_t img = gltf.textures[mat.pbrData.metallicRoughnessTexture.value().textureIndex].imageIndex.value();
-            std::size_t sampler = gltf.textures[mat.pbrData.metallicRoughnessTexture.value().textureIndex].samplerIndex.value();
-
-            material_resources.images[1].image = images[img];
-            material_resources.images[1].sampler = file.samplers[sampler];
-        }
+        return engine->device.extensions.host_image_copy && engine->supports_host_image_copy(format, vk::ImageUsageFlagBits::eSampled);
+    };
+    bool host_image_copy_rgba = host_image_copy(vk::Format::eR8G8B8A8Unorm);
+    // NOTE: Host image copies write every level on the worker anyway, so only staged textures are streamed.
+    auto streamed = [&](const texture_data_t& texture)
+    {
+        return engine->texture_streaming && texture.levels.size() > 1 && !host_image_copy(texture.format);
+    };
 
-        auto ret = material.write_material(engine->device.dev, pass_type, material_resources, file.descriptor_pool);
-        if (!ret.has_value()) return std::nullopt;
-        new_mat->data = ret.value();
-        data_index++;
-    }
+    // NOTE: Images are decoded in parallel, each into its own slot of the pre-sized vector. Images compressed on import encode
+    // their rows on the same pool. Streamed images need every level up front, so their mip chain is built on the CPU.
+    std::vector<std::optional<decoded_image_t>> decoded_images(gltf.images.size());
+    engine->jobs.parallel_for(gltf.images.size(), [&](std::size_t i)
+    {
+        decoded_images[i] = decode_image(engine, gltf, gltf.images[i], srgb_images[i], engine->texture_streaming && !host_image_copy_rgba);
+    });
 
+    // NOTE: Meshes are built and optimized before the upload group begins, so the batch is not held open by CPU work.
+    // Their surfaces get their materials once those are written.
+    std::vector<std::vector<std::uint32_t>> mesh_indices;
+    std::vector<std::vector<vertex_t>> mesh_vertices;
     std::vector<std::uint32_t> indices;
     std::vector<vertex_t> vertices;
+#ifdef DEBUG
+    vertex_cache_stats_t cache_before;
+    vertex_cache_stats_t cache_after;
+#endif
 
     for (fastgltf::Mesh& mesh : gltf.meshes)
     {
@@ -321,7 +305,7 @@ std::optional<std::shared_ptr<loaded_gltf_t>> load_gltf(engine_t* engine, std::s
             }
 
             auto uv = p.findAttribute("TEXCOORD_0");
-            if (normals != p.attributes.end())
+            if (uv != p.attributes.end())
             {
                 fastgltf::iterateAccessorWithIndex<glm::vec2>(gltf, gltf.accessors[uv->second],
                         [&](glm::vec2 v, std::size_t idx) {
@@ -338,10 +322,25 @@ std::optional<std::shared_ptr<loaded_gltf_t>> load_gltf(engine_t* engine, std::s
                         });
             }
 
-            if (p.materialIndex.has_value())
-                new_surface.material = materials[p.materialIndex.value()];
-            else
-                new_surface.material = materials[0];
+            if (p.type == fastgltf::PrimitiveType::Triangles)
+            {
+                std::vector<std::uint32_t> prim_indices(indices.begin() + new_surface.start_index, indices.end());
+                for (std::uint32_t& idx : prim_indices) idx -= initial_vtx;
+                std::vector<vertex_t> prim_vertices(vertices.begin() + initial_vtx, vertices.end());
+
+#ifdef DEBUG
+                cache_before += vkutil::analyze_vertex_cache(prim_indices, prim_vertices.size());
+#endif
+                vkutil::optimize_mesh(prim_indices, prim_vertices);
+#ifdef DEBUG
+                cache_after += vkutil::analyze_vertex_cache(prim_indices, prim_vertices.size());
+#endif
+
+                indices.resize(new_surface.start_index);
+                for (std::uint32_t idx : prim_indices) indices.push_back(idx + initial_vtx);
+                vertices.resize(initial_vtx);
+                vertices.insert(vertices.end(), prim_vertices.begin(), prim_vertices.end());
+            }
 
             glm::vec3 min_pos = vertices[initial_vtx].position;
             glm::vec3 max_pos = vertices[initial_vtx].position;
@@ -358,11 +357,241 @@ std::optional<std::shared_ptr<loaded_gltf_t>> load_gltf(engine_t* engine, std::s
             new_mesh->surfaces.push_back(new_surface);
         }
 
-        auto ret = engine->upload_mesh(indices, vertices);
-        if (!ret.has_value()) return std::nullopt;
-        new_mesh->mesh_buffer = ret.value();
+        mesh_indices.push_back(std::move(indices));
+        mesh_vertices.push_back(std::move(vertices));
+    }
+
+    // NOTE: Images are handed to the file right after they were created, so they are destroyed with it even if the load fails.
+    // Streamed textures are owned by the file as well, their views are destroyed with it.
+    std::vector<std::optional<allocated_image_t>> images(gltf.images.size());
+    std::vector<std::optional<streamed_texture_t>> streamed_images(gltf.images.size());
+    std::vector<std::string> image_names(gltf.images.size());
+    std::vector<std::optional<std::size_t>> streamed_indices(gltf.images.size());
+    bool images_kept = false;
+    auto keep_images = [&]()
+    {
+        if (images_kept) return;
+        images_kept = true;
+        // NOTE: The file destroys its images in `clear_all`, so every image needs its own key, even unnamed ones.
+        for (std::size_t i = 0; i < gltf.images.size(); ++i)
+        {
+            // NOTE: Names the allocation for the detailed memory report and the leak report.
+            if (images[i].has_value()) vmaSetAllocationName(engine->allocator, images[i].value().allocation, gltf.images[i].name.c_str());
+            if (!images[i].has_value() || streamed_images[i].has_value()) continue;
+            std::string name = gltf.images[i].name.c_str();
+            if (name.empty() || file.images.contains(name)) name = fmt::format("{}#{}", name, i);
+            file.images[name] = images[i].value();
+            image_names[i] = name;
+        }
+
+        for (std::size_t i = 0; i < gltf.images.size(); ++i)
+        {
+            if (!streamed_images[i].has_value()) continue;
+            streamed_indices[i] = file.streamed_textures.size();
+            file.streamed_textures.push_back(std::move(streamed_images[i].value()));
+        }
+    };
+
+    std::optional<upload_group_t> group;
+    auto abort_load = [&]()
+    {
+        if (group.has_value()) engine->uploads.end_group(group.value());
+        keep_images();
+        for (auto& decoded : decoded_images)
+        {
+            if (decoded.has_value() && decoded.value().data) stbi_image_free(decoded.value().data);
+        }
+        return false;
+    };
+
+    // NOTE: Host image copies and their CPU mip levels run in parallel and need no staging, so they are done before the group
+    // begins. Staged uploads take turns on the upload manager.
+    auto staged = [&](std::size_t i)
+    {
+        if (!decoded_images[i].has_value()) return false;
+        if (decoded_images[i].value().texture.has_value()) return !host_image_copy(decoded_images[i].value().texture.value().format);
+        return !host_image_copy_rgba;
+    };
+    auto load_image = [&](std::size_t i, upload_group_t* image_group)
+    {
+        if (decoded_images[i].value().texture.has_value())
+        {
+            texture_data_t& texture = decoded_images[i].value().texture.value();
+            if (streamed(texture))
+            {
+                streamed_images[i] = engine->create_streamed_image(std::move(texture), vk::ImageUsageFlagBits::eSampled, image_group);
+                if (streamed_images[i].has_value()) images[i] = streamed_images[i].value().image;
+            }
+            else
+            {
+                images[i] = engine->create_image(texture, vk::ImageUsageFlagBits::eSampled, image_group);
+            }
+            decoded_images[i].reset();
+            return;
+        }
+        decoded_image_t decoded = decoded_images[i].value();
+        mip_filter_e filter = srgb_images[i] ? mip_filter_e::AVERAGE_SRGB : mip_filter_e::AVERAGE;
+        images[i] = engine->create_image(decoded.data, decoded.extent, vk::Format::eR8G8B8A8Unorm, vk::ImageUsageFlagBits::eSampled, true,
+                image_group, filter);
+        stbi_image_free(decoded.data);
+        decoded_images[i].reset();
+    };
+    engine->jobs.parallel_for(gltf.images.size(), [&](std::size_t i)
+    {
+        if (decoded_images[i].has_value() && !staged(i)) load_image(i, nullptr);
+    });
+
+    // NOTE: The staged textures and meshes of the file share one reserved range and are recorded into one batch, which is
+    // submitted by the next flush once the group has ended. Meshes written into a host visible geometry pool need no staging,
+    // streamed textures only stage the levels they are loaded with.
+    vk::DeviceSize staging_size = 0;
+    for (std::size_t i = 0; i < gltf.images.size(); ++i)
+    {
+        if (!staged(i)) continue;
+        if (decoded_images[i].value().texture.has_value())
+        {
+            const texture_data_t& texture = decoded_images[i].value().texture.value();
+            vk::DeviceSize first = streamed(texture) ? texture.levels[vkutil::first_level_within(texture, TEXTURE_STREAM_TAIL_SIZE)].offset : 0;
+            staging_size += upload_manager_t::staging_size(texture.data.size() - first);
+            continue;
+        }
+        vk::Extent3D extent = decoded_images[i].value().extent;
+        staging_size += upload_manager_t::staging_size(vk::DeviceSize(extent.width) * extent.height * 4);
+    }
+    for (std::size_t i = 0; i < mesh_indices.size() && !engine->geometry.host_visible; ++i)
+    {
+        staging_size += upload_manager_t::staging_size(mesh_indices[i].size() * sizeof(std::uint32_t));
+        staging_size += upload_manager_t::staging_size(mesh_vertices[i].size() * vkutil::vertex_stride(format));
+    }
+
+    group = engine->uploads.begin_group(staging_size);
+    if (!group.has_value()) return abort_load();
+    engine->jobs.parallel_for(gltf.images.size(), [&](std::size_t i)
+    {
+        if (staged(i)) load_image(i, &group.value());
+    });
+    keep_images();
+
+    for (std::size_t i = 0; i < meshes.size(); ++i)
+    {
+        auto ret = engine->upload_mesh(mesh_indices[i], mesh_vertices[i], format, &group.value());
+        if (!ret.has_value()) return abort_load();
+        meshes[i]->mesh_buffer = ret.value();
+    }
+    file.ticket = engine->uploads.end_group(group.value()).value_or(0);
+    group.reset();
+    mesh_indices.clear();
+    mesh_vertices.clear();
+
+    for (std::size_t i = 0; i < gltf.images.size(); ++i)
+    {
+        if (images[i].has_value())
+        {
+            vk::ImageView view = images[i].value().view;
+            if (streamed_indices[i].has_value()) view = file.streamed_textures[streamed_indices[i].value()].view;
+            auto ret = engine->register_texture(view);
+            if (!ret.has_value()) return abort_load();
+            if (streamed_indices[i].has_value()) file.streamed_textures[streamed_indices[i].value()].texture_index = ret.value();
+            else file.image_texture_indices[image_names[i]] = ret.value();
+            file.texture_indices.push_back(ret.value());
+            image_indices.push_back(ret.value());
+            image_tickets.push_back(images[i].value().ticket);
+        }
+        else
+        {
+            image_indices.push_back(engine->bindless.error_texture);
+            image_tickets.push_back(0);
+            fmt::print("[ {} ]\tFailed to load glTF texture: {}\n", WARN_FMT("WARNING"), gltf.images[i].name);
+        }
+    }
+
+    // NOTE: The KTX2 image of KHR_texture_basisu is used if it could be loaded, the fallback image of the texture otherwise.
+    auto texture_image = [&](std::size_t texture_index) -> std::optional<std::size_t>
+    {
+        fastgltf::Texture& texture = gltf.textures[texture_index];
+        if (texture.basisuImageIndex.has_value() && images[texture.basisuImageIndex.value()].has_value()) return texture.basisuImageIndex.value();
+        if (texture.imageIndex.has_value()) return texture.imageIndex.value();
+        return std::nullopt;
+    };
+
+    for (fastgltf::Material& mat : gltf.materials)
+    {
+        std::shared_ptr<gltf_material_t> new_mat = std::make_shared<gltf_material_t>();
+        materials.push_back(new_mat);
+
+        gltf_metallic_roughness_t::material_constants_t constants{
+            .color_factors = glm::vec4(mat.pbrData.baseColorFactor[0], mat.pbrData.baseColorFactor[1],
+                    mat.pbrData.baseColorFactor[2], mat.pbrData.baseColorFactor[3]),
+            .metal_rough_factors = glm::vec4(mat.pbrData.metallicFactor, mat.pbrData.roughnessFactor, glm::vec2()),
+            .texture_indices = glm::uvec4(engine->bindless.white_texture, engine->bindless.linear_sampler,
+                    engine->bindless.white_texture, engine->bindless.linear_sampler)
+        };
+
+        material_pass_e pass_type = material_pass_e::MAIN_COLOR;
+        if (mat.alphaMode == fastgltf::AlphaMode::Blend) pass_type = material_pass_e::TRANSPARENT;
+        else if (mat.alphaMode == fastgltf::AlphaMode::Mask)
+        {
+            pass_type = material_pass_e::MASKED;
+            constants.extra[0].x = mat.alphaCutoff;
+        }
+
+        // NOTE: The material is ready once the last upload of its textures is done.
+        upload_ticket_t ticket = 0;
+        std::optional<std::size_t> color_image;
+        if (mat.pbrData.baseColorTexture.has_value()) color_image = texture_image(mat.pbrData.baseColorTexture.value().textureIndex);
+        if (color_image.has_value())
+        {
+            std::size_t img = color_image.value();
+            std::size_t sampler = gltf.textures[mat.pbrData.baseColorTexture.value().textureIndex].samplerIndex.value();
+
+            constants.texture_indices.x = image_indices[img];
+            constants.texture_indices.y = file.sampler_indices[sampler];
+            ticket = std::max(ticket, image_tickets[img]);
+        }
+
+        std::optional<std::size_t> metal_rough_image;
+        if (mat.pbrData.metallicRoughnessTexture.has_value())
+        {
+            metal_rough_image = texture_image(mat.pbrData.metallicRoughnessTexture.value().textureIndex);
+        }
+        if (metal_rough_image.has_value())
+        {
+            std::size_t img = metal_rough_image.value();
+            std::size_t sampler = gltf.textures[mat.pbrData.metallicRoughnessTexture.value().textureIndex].samplerIndex.value();
+
+            constants.texture_indices.z = image_indices[img];
+            constants.texture_indices.w = file.sampler_indices[sampler];
+            ticket = std::max(ticket, image_tickets[img]);
+        }
+
+        auto ret = material.write_material(engine, pass_type, constants);
+        if (!ret.has_value()) return abort_load();
+        new_mat->data = ret.value();
+        new_mat->data.ticket = ticket;
+        file.material_indices.push_back(new_mat->data.material_index);
+
+        for (std::optional<std::size_t> img : { color_image, metal_rough_image })
+        {
+            if (!img.has_value() || !streamed_indices[img.value()].has_value()) continue;
+            std::vector<std::shared_ptr<gltf_material_t>>& streamed_materials = file.streamed_textures[streamed_indices[img.value()].value()].materials;
+            if (std::find(streamed_materials.begin(), streamed_materials.end(), new_mat) == streamed_materials.end()) streamed_materials.push_back(new_mat);
+        }
+    }
+
+    for (std::size_t i = 0; i < gltf.meshes.size(); ++i)
+    {
+        for (std::size_t j = 0; j < gltf.meshes[i].primitives.size(); ++j)
+        {
+            std::optional<std::size_t> material_index = gltf.meshes[i].primitives[j].materialIndex;
+            meshes[i]->surfaces[j].material = materials[material_index.value_or(0)];
+        }
     }
 
+#ifdef DEBUG
+    fmt::print("[ {} ]\tVertex cache of {}: ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}\n", INFO_FMT("INFO"), filepath,
+            cache_before.acmr(), cache_after.acmr(), cache_before.atvr(), cache_after.atvr());
+#endif
+
     for (fastgltf::Node& node : gltf.nodes)
     {
         std::shared_ptr<node_t> new_node;
@@ -420,6 +649,15 @@ std::optional<std::shared_ptr<loaded_gltf_t>> load_gltf(engine_t* engine, std::s
     fmt::print("[ {} ]\tFinished loading glTF: {}\n", INFO_FMT("INFO"), filepath);
 #endif
 
+    return true;
+}
+
+std::optional<std::shared_ptr<loaded_gltf_t>> load_gltf(engine_t* engine, std::string_view filepath, gltf_metallic_roughness_t& material,
+        vertex_format_e format)
+{
+    std::shared_ptr<loaded_gltf_t> scene = std::make_shared<loaded_gltf_t>();
+    scene->creator = engine;
+    if (!load_gltf(engine, *scene.get(), filepath, material, format)) return std::nullopt;
     return scene;
 }
 
@@ -439,29 +677,53 @@ void loaded_gltf_t::draw(const std::vector<glm::mat4>& top_matrix, draw_context_
     }
 }
 
+std::uint64_t streamed_texture_t::last_used_frame() const
+{
+    std::uint64_t frame = 0;
+    for (const std::shared_ptr<gltf_material_t>& material : this->materials)
+    {
+        frame = std::max(frame, material->data.last_used_frame);
+    }
+    return frame;
+}
+
 void loaded_gltf_t::clear_all()
 {
-    vk::Device dev = this->creator->device.dev;
-    this->descriptor_pool.destroy_pools(dev);
-    this->creator->destroy_buffer(this->material_data_buffer);
+    engine_t* engine = this->creator;
 
     for (auto& [k, v] : this->meshes)
     {
-        this->creator->destroy_buffer(v->mesh_buffer.index_buffer);
-        this->creator->destroy_buffer(v->mesh_buffer.vertex_buffer);
+        engine->release_mesh(v->mesh_buffer);
     }
 
+    // NOTE: Frames in flight may still read the slots and sample the images, so they are released once those frames are done.
+    std::vector<allocated_image_t> images;
+    std::vector<vk::ImageView> views;
+    upload_ticket_t ticket = 0;
     for (auto& [k, v] : this->images)
     {
-        if (v.image == this->creator->error_checkerboard_image.image)
+        if (v.image == engine->error_checkerboard_image.image)
         {
             continue;
         }
-        //this->creator->destroy_image(v);
+        images.push_back(v);
+        ticket = std::max(ticket, v.ticket);
     }
-
-    for (auto& sampler : this->samplers)
+    for (streamed_texture_t& texture : this->streamed_textures)
     {
-        dev.destroySampler(sampler);
+        images.push_back(texture.image);
+        ticket = std::max(ticket, texture.ticket);
+        if (texture.pending_image.has_value()) images.push_back(texture.pending_image.value());
+        views.push_back(texture.view);
     }
+
+    engine->retire([=, material_indices = this->material_indices, texture_indices = this->texture_indices,
+            sampler_indices = this->sampler_indices, samplers = this->samplers]() {
+            for (auto idx : material_indices) engine->release_material(idx);
+            for (auto idx : texture_indices) engine->release_texture(idx);
+            for (auto idx : sampler_indices) engine->release_sampler(idx);
+            for (vk::ImageView view : views) engine->device.dev.destroyImageView(view);
+            for (const allocated_image_t& img : images) engine->destroy_image(img);
+            for (vk::Sampler sampler : samplers) engine->device.dev.destroySampler(sampler);
+            }, ticket);
 }
@@ -0,0 +1,352 @@
+#include <vk-mesh.h>
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+#include <glm/gtc/packing.hpp>
+#include <glm/gtc/type_precision.hpp>
+
+std::size_t vkutil::vertex_stride(vertex_format_e format)
+{
+    switch (format)
+    {
+        case vertex_format_e::PACKED:
+            return sizeof(packed_vertex_t);
+        case vertex_format_e::QUANTIZED:
+            return sizeof(quantized_vertex_t);
+        case vertex_format_e::FLOAT:
+        default:
+            return sizeof(vertex_t);
+    }
+}
+
+std::uint32_t vkutil::encode_octahedral(glm::vec3 normal)
+{
+    glm::vec3 n = normal / (std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z));
+    glm::vec2 p(n.x, n.y);
+    if (n.z < 0.f)
+    {
+        glm::vec2 sign(p.x >= 0.f ? 1.f : -1.f, p.y >= 0.f ? 1.f : -1.f);
+        p = (1.f - glm::abs(glm::vec2(p.y, p.x))) * sign;
+    }
+    return glm::packSnorm2x16(p);
+}
+
+std::vector<std::byte> vkutil::pack_vertices(std::span<const vertex_t> vertices, vertex_format_e format, glm::vec3& position_offset,
+        glm::vec3& position_scale)
+{
+    std::vector<std::byte> data(vertices.size() * vkutil::vertex_stride(format));
+    position_offset = glm::vec3(0.f);
+    position_scale = glm::vec3(1.f);
+
+    if (format == vertex_format_e::FLOAT)
+    {
+        std::memcpy(data.data(), vertices.data(), data.size());
+        return data;
+    }
+
+    if (format == vertex_format_e::PACKED)
+    {
+        packed_vertex_t* packed = (packed_vertex_t*)data.data();
+        for (std::size_t i = 0; i < vertices.size(); ++i)
+        {
+            packed[i] = packed_vertex_t{ .position = vertices[i].position,
+                .normal = vkutil::encode_octahedral(vertices[i].normal),
+                .uv = glm::packHalf2x16(vertices[i].uv),
+                .color = glm::packUnorm4x8(vertices[i].color)
+            };
+        }
+        return data;
+    }
+
+    if (vertices.empty()) return data;
+
+    glm::vec3 min_pos = vertices[0].position;
+    glm::vec3 max_pos = vertices[0].position;
+    for (const vertex_t& v : vertices)
+    {
+        min_pos = glm::min(min_pos, v.position);
+        max_pos = glm::max(max_pos, v.position);
+    }
+    position_offset = min_pos;
+    // NOTE: Flat meshes would divide by zero otherwise.
+    position_scale = glm::max(max_pos - min_pos, glm::vec3(1e-6f));
+
+    quantized_vertex_t* quantized = (quantized_vertex_t*)data.data();
+    for (std::size_t i = 0; i < vertices.size(); ++i)
+    {
+        glm::vec3 normalized = (vertices[i].position - position_offset) / position_scale;
+        glm::u16vec4 position = glm::packUnorm<std::uint16_t>(glm::vec4(normalized, 0.f));
+        quantized[i] = quantized_vertex_t{ .position = { position.x, position.y, position.z, 0 },
+            .normal = vkutil::encode_octahedral(vertices[i].normal),
+            .uv = glm::packHalf2x16(vertices[i].uv),
+            .color = glm::packUnorm4x8(vertices[i].color)
+        };
+    }
+    return data;
+}
+
+float vertex_cache_stats_t::acmr() const
+{
+    return this->triangle_count ? static_cast<float>(this->miss_count) / this->triangle_count : 0.f;
+}
+
+float vertex_cache_stats_t::atvr() const
+{
+    return this->vertex_count ? static_cast<float>(this->miss_count) / this->vertex_count : 0.f;
+}
+
+vertex_cache_stats_t& vertex_cache_stats_t::operator+=(const vertex_cache_stats_t& other)
+{
+    this->triangle_count += other.triangle_count;
+    this->vertex_count += other.vertex_count;
+    this->miss_count += other.miss_count;
+    return *this;
+}
+
+vertex_cache_stats_t vkutil::analyze_vertex_cache(std::span<const std::uint32_t> indices, std::size_t vertex_count, std::uint32_t cache_size)
+{
+    vertex_cache_stats_t stats{ .triangle_count = indices.size() / 3 };
+
+    // NOTE: A vertex is in the FIFO cache if less than `cache_size` vertices were inserted after it.
+    std::vector<std::uint32_t> cache_time(vertex_count, 0);
+    std::vector<bool> referenced(vertex_count, false);
+    std::uint32_t time = cache_size + 1;
+    for (std::uint32_t idx : indices)
+    {
+        if (idx >= vertex_count) continue;
+        if (!referenced[idx])
+        {
+            referenced[idx] = true;
+            stats.vertex_count++;
+        }
+        if (time - cache_time[idx] > cache_size)
+        {
+            cache_time[idx] = time++;
+            stats.miss_count++;
+        }
+    }
+    return stats;
+}
+
+namespace {
+    std::size_t hash_float(float f)
+    {
+        // NOTE: 0.f and -0.f compare equal, so they have to hash equal too.
+        return (f == 0.f) ? 0 : std::bit_cast<std::uint32_t>(f);
+    }
+
+    struct vertex_hash_t
+    {
+        std::size_t operator()(const vertex_t& v) const
+        {
+            const float values[] = { v.position.x, v.position.y, v.position.z, v.normal.x, v.normal.y, v.normal.z,
+                v.uv.x, v.uv.y, v.color.r, v.color.g, v.color.b, v.color.a };
+            std::size_t hash = 0;
+            for (float f : values) hash = hash * 31 + hash_float(f);
+            return hash;
+        }
+    };
+
+    struct vertex_equal_t
+    {
+        bool operator()(const vertex_t& a, const vertex_t& b) const
+        {
+            return a.position == b.position && a.normal == b.normal && a.uv == b.uv && a.color == b.color;
+        }
+    };
+};
+
+std::size_t vkutil::weld_vertices(std::vector<std::uint32_t>& indices, std::vector<vertex_t>& vertices)
+{
+    std::unordered_map<vertex_t, std::uint32_t, vertex_hash_t, vertex_equal_t> unique;
+    unique.reserve(vertices.size());
+    std::vector<vertex_t> welded;
+    welded.reserve(vertices.size());
+    std::vector<std::uint32_t> remap(vertices.size());
+
+    for (std::size_t i = 0; i < vertices.size(); ++i)
+    {
+        auto [it, inserted] = unique.try_emplace(vertices[i], static_cast<std::uint32_t>(welded.size()));
+        if (inserted) welded.push_back(vertices[i]);
+        remap[i] = it->second;
+    }
+    for (std::uint32_t& idx : indices) idx = remap[idx];
+
+    std::size_t removed = vertices.size() - welded.size();
+    vertices = std::move(welded);
+    return removed;
+}
+
+std::vector<std::size_t> vkutil::optimize_vertex_cache(std::vector<std::uint32_t>& indices, std::size_t vertex_count, std::uint32_t cache_size)
+{
+    const std::size_t triangle_count = indices.size() / 3;
+    std::vector<std::size_t> clusters = { 0 };
+    if (triangle_count == 0) return clusters;
+
+    // vertex to triangle adjacency
+    std::vector<std::uint32_t> live(vertex_count, 0);
+    for (std::uint32_t idx : indices) live[idx]++;
+    std::vector<std::uint32_t> offsets(vertex_count + 1, 0);
+    for (std::size_t v = 0; v < vertex_count; ++v) offsets[v + 1] = offsets[v] + live[v];
+    std::vector<std::uint32_t> adjacency(triangle_count * 3);
+    std::vector<std::uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (std::uint32_t t = 0; t < triangle_count; ++t)
+    {
+        for (std::size_t k = 0; k < 3; ++k) adjacency[fill[indices[t * 3 + k]]++] = t;
+    }
+
+    std::vector<std::uint32_t> cache_time(vertex_count, 0);
+    std::vector<bool> emitted(triangle_count, false);
+    std::vector<std::uint32_t> dead_end;
+    dead_end.reserve(triangle_count * 3);
+    std::vector<std::uint32_t> candidates;
+    std::vector<std::uint32_t> output;
+    output.reserve(triangle_count * 3);
+
+    std::uint32_t time = cache_size + 1;
+    std::size_t cursor = 0;
+    std::int64_t fan = 0;
+    while (fan >= 0)
+    {
+        // emit all remaining triangles around the fanning vertex
+        candidates.clear();
+        for (std::uint32_t a = offsets[fan]; a < offsets[fan + 1]; ++a)
+        {
+            std::uint32_t t = adjacency[a];
+            if (emitted[t]) continue;
+            emitted[t] = true;
+            for (std::size_t k = 0; k < 3; ++k)
+            {
+                std::uint32_t v = indices[t * 3 + k];
+                output.push_back(v);
+                dead_end.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (time - cache_time[v] > cache_size) cache_time[v] = time++;
+            }
+        }
+
+        // prefer the oldest candidate that is still in the cache after emitting all of its triangles
+        std::int64_t next = -1;
+        std::int64_t best_priority = -1;
+        for (std::uint32_t v : candidates)
+        {
+            if (live[v] == 0) continue;
+            std::int64_t priority = 0;
+            if (time - cache_time[v] + 2 * live[v] <= cache_size) priority = time - cache_time[v];
+            if (priority > best_priority)
+            {
+                best_priority = priority;
+                next = v;
+            }
+        }
+
+        if (next == -1)
+        {
+            // dead end: continue with a recently used vertex or the next vertex in input order
+            while (!dead_end.empty())
+            {
+                std::uint32_t v = dead_end.back();
+                dead_end.pop_back();
+                if (live[v] > 0)
+                {
+                    next = v;
+                    break;
+                }
+            }
+            if (next == -1)
+            {
+                while (cursor < vertex_count && live[cursor] == 0) cursor++;
+                if (cursor < vertex_count) next = cursor;
+            }
+            if (next != -1 && output.size() / 3 != clusters.back()) clusters.push_back(output.size() / 3);
+        }
+        fan = next;
+    }
+
+    indices = std::move(output);
+    return clusters;
+}
+
+void vkutil::optimize_overdraw(std::vector<std::uint32_t>& indices, std::span<const vertex_t> vertices, std::span<const std::size_t> clusters)
+{
+    if (clusters.size() < 2 || vertices.empty()) return;
+
+    glm::vec3 mesh_centroid(0.f);
+    for (const vertex_t& v : vertices) mesh_centroid += v.position;
+    mesh_centroid /= static_cast<float>(vertices.size());
+
+    struct cluster_t
+    {
+        std::size_t start;
+        std::size_t end;
+        float sort_key;
+    };
+    std::vector<cluster_t> sorted;
+    sorted.reserve(clusters.size());
+
+    const std::size_t triangle_count = indices.size() / 3;
+    for (std::size_t i = 0; i < clusters.size(); ++i)
+    {
+        cluster_t cluster{ .start = clusters[i], .end = (i + 1 < clusters.size()) ? clusters[i + 1] : triangle_count, .sort_key = 0.f };
+
+        glm::vec3 centroid(0.f);
+        glm::vec3 normal(0.f);
+        float area = 0.f;
+        for (std::size_t t = cluster.start; t < cluster.end; ++t)
+        {
+            glm::vec3 a = vertices[indices[t * 3 + 0]].position;
+            glm::vec3 b = vertices[indices[t * 3 + 1]].position;
+            glm::vec3 c = vertices[indices[t * 3 + 2]].position;
+            glm::vec3 n = glm::cross(b - a, c - a);
+            float tri_area = glm::length(n);
+            centroid += (a + b + c) / 3.f * tri_area;
+            normal += n;
+            area += tri_area;
+        }
+
+        // NOTE: Clusters facing away from the mesh center are likely to occlude the rest of the mesh.
+        if (area > 0.f && glm::length(normal) > 0.f)
+            cluster.sort_key = glm::dot(centroid / area - mesh_centroid, glm::normalize(normal));
+        sorted.push_back(cluster);
+    }
+
+    std::stable_sort(sorted.begin(), sorted.end(), [](const cluster_t& a, const cluster_t& b) { return a.sort_key > b.sort_key; });
+
+    std::vector<std::uint32_t> output;
+    output.reserve(indices.size());
+    for (const cluster_t& cluster : sorted)
+    {
+        output.insert(output.end(), indices.begin() + cluster.start * 3, indices.begin() + cluster.end * 3);
+    }
+    indices = std::move(output);
+}
+
+void vkutil::optimize_vertex_fetch(std::vector<std::uint32_t>& indices, std::vector<vertex_t>& vertices)
+{
+    std::vector<std::uint32_t> remap(vertices.size(), std::numeric_limits<std::uint32_t>::max());
+    std::vector<vertex_t> reordered;
+    reordered.reserve(vertices.size());
+
+    for (std::uint32_t& idx : indices)
+    {
+        if (remap[idx] == std::numeric_limits<std::uint32_t>::max())
+        {
+            remap[idx] = static_cast<std::uint32_t>(reordered.size());
+            reordered.push_back(vertices[idx]);
+        }
+        idx = remap[idx];
+    }
+    vertices = std::move(reordered);
+}
+
+void vkutil::optimize_mesh(std::vector<std::uint32_t>& indices, std::vector<vertex_t>& vertices)
+{
+    vkutil::weld_vertices(indices, vertices);
+    std::vector<std::size_t> clusters = vkutil::optimize_vertex_cache(indices, vertices.size());
+    vkutil::optimize_overdraw(indices, vertices, clusters);
+    vkutil::optimize_vertex_fetch(indices, vertices);
+}
@@ -0,0 +1,123 @@
+#include <vk-mips.h>
+#include <vk-descriptors.h>
+#include <vk-pipelines.h>
+#include <error_fmt.h>
+#include <algorithm>
+
+static vk::Extent2D next_level(vk::Extent2D extent)
+{
+    return vk::Extent2D(std::max(extent.width / 2, 1u), std::max(extent.height / 2, 1u));
+}
+
+bool mip_generator_t::init(vk::Device device, const vk::DispatchLoaderDynamic& dispatch, const std::string& shader_path)
+{
+    this->device = device;
+    this->dispatch = &dispatch;
+
+    descriptor_layout_builder_t builder;
+    auto ret_layout = builder.add_binding(0, vk::DescriptorType::eSampledImage).add_binding(1, vk::DescriptorType::eStorageImage, MIP_LEVELS_PER_PASS)
+        .build(device, vk::ShaderStageFlagBits::eCompute, vk::DescriptorSetLayoutCreateFlagBits::ePushDescriptorKHR);
+    if (!ret_layout.has_value()) return false;
+    this->layout = ret_layout.value();
+
+    vk::Result result;
+    vk::PushConstantRange push_constant(vk::ShaderStageFlagBits::eCompute, 0, sizeof(mip_push_constants_t));
+    vk::PipelineLayoutCreateInfo layout_info({}, this->layout, push_constant);
+    std::tie(result, this->pipeline_layout) = device.createPipelineLayout(layout_info);
+    if (result != vk::Result::eSuccess)
+    {
+        fmt::print(stderr, "[ {} ]\tFailed to create pipeline layout!\n", ERROR_FMT("ERROR"));
+        return false;
+    }
+
+    auto shader = vkutil::load_shader_module(shader_path.c_str(), device);
+    if (!shader.has_value()) return false;
+
+    vk::PipelineShaderStageCreateInfo stage_info({}, vk::ShaderStageFlagBits::eCompute, shader.value(), "main");
+    vk::ComputePipelineCreateInfo pipeline_info({}, stage_info, this->pipeline_layout);
+    std::tie(result, this->pipeline) = device.createComputePipeline({}, pipeline_info);
+    device.destroyShaderModule(shader.value());
+    if (result != vk::Result::eSuccess)
+    {
+        fmt::print(stderr, "[ {} ]\tFailed to create compute pipeline!\n", ERROR_FMT("ERROR"));
+        return false;
+    }
+
+    return true;
+}
+
+void mip_generator_t::destroy()
+{
+    this->device.destroyPipeline(this->pipeline);
+    this->device.destroyPipelineLayout(this->pipeline_layout);
+    this->device.destroyDescriptorSetLayout(this->layout);
+}
+
+bool mip_generator_t::generate(vk::CommandBuffer cmd, const allocated_image_t& image, std::uint32_t mip_levels, mip_filter_e filter,
+        std::vector<vk::ImageView>& views)
+{
+    if (mip_levels < 2) return true;
+
+    // NOTE: Storage image views may only cover a single level.
+    std::size_t first_view = views.size();
+    for (std::uint32_t mip = 1; mip < mip_levels; ++mip)
+    {
+        vk::ImageViewCreateInfo view_info({}, image.image, vk::ImageViewType::e2D, image.format, {},
+                vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, mip, 1, 0, 1));
+        auto [result, view] = this->device.createImageView(view_info);
+        if (result != vk::Result::eSuccess)
+        {
+            fmt::print(stderr, "[ {} ]\tFailed to create image view!\n", ERROR_FMT("ERROR"));
+            return false;
+        }
+        views.push_back(view);
+    }
+
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, this->pipeline);
+
+    vk::Extent2D extent(image.extent.width, image.extent.height);
+    std::uint32_t level = 0;
+    while (level + 1 < mip_levels)
+    {
+        // NOTE: Levels after the first of a pass are reduced within a workgroup, which only sees every child of a texel
+        // if the level above has an even size or a size of 1.
+        std::uint32_t count = 1;
+        vk::Extent2D last = next_level(extent);
+        auto fits = [](std::uint32_t size) { return size % 2 == 0 || size == 1; };
+        while (count < MIP_LEVELS_PER_PASS && level + count + 1 < mip_levels && fits(last.width) && fits(last.height))
+        {
+            last = next_level(last);
+            ++count;
+        }
+
+        if (level > 0)
+        {
+            vk::MemoryBarrier2 barrier(vk::PipelineStageFlagBits2::eComputeShader, vk::AccessFlagBits2::eShaderStorageWrite,
+                    vk::PipelineStageFlagBits2::eComputeShader, vk::AccessFlagBits2::eShaderSampledRead);
+            vk::DependencyInfo dep_info({}, 1, &barrier);
+            cmd.pipelineBarrier2(dep_info);
+        }
+
+        // NOTE: Every element of the array is written, the ones past `count` repeat the last level but are never stored to.
+        descriptor_writer_t writer;
+        writer.write_image(0, image.view, VK_NULL_HANDLE, vk::ImageLayout::eGeneral, vk::DescriptorType::eSampledImage);
+        for (std::uint32_t i = 0; i < MIP_LEVELS_PER_PASS; ++i)
+        {
+            writer.write_image(1, views[first_view + level + std::min(i, count - 1)], VK_NULL_HANDLE, vk::ImageLayout::eGeneral,
+                    vk::DescriptorType::eStorageImage, i);
+        }
+        cmd.pushDescriptorSetKHR(vk::PipelineBindPoint::eCompute, this->pipeline_layout, 0, writer.writes, *this->dispatch);
+
+        mip_push_constants_t push_constants{ .source_extent = glm::ivec2(extent.width, extent.height), .base_level = std::int32_t(level),
+            .level_count = std::int32_t(count), .filter = filter };
+        cmd.pushConstants(this->pipeline_layout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(mip_push_constants_t), &push_constants);
+
+        // every workgroup writes 32x32 texels of the first level of the pass
+        vk::Extent2D first = next_level(extent);
+        cmd.dispatch((first.width + 31) / 32, (first.height + 31) / 32, 1);
+
+        level += count;
+        extent = last;
+    }
+    return true;
+}
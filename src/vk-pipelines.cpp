@@ -48,7 +48,9 @@ void pipeline_builder_t::clear()
     this->pipeline_layout        = vk::PipelineLayout();
     this->depth_stencil          = vk::PipelineDepthStencilStateCreateInfo();
     this->render_info            = vk::PipelineRenderingCreateInfo();
+    this->flags                  = vk::PipelineCreateFlags();
     this->shader_stages.clear();
+    this->write_disabled_attachments.clear();
 }
 
 pipeline_builder_t& pipeline_builder_t::set_shaders(const vk::ShaderModule vertex_shader, const vk::ShaderModule fragment_shader)
@@ -59,6 +61,13 @@ pipeline_builder_t& pipeline_builder_t::set_shaders(const vk::ShaderModule verte
     return *this;
 }
 
+pipeline_builder_t& pipeline_builder_t::set_vertex_shader(const vk::ShaderModule vertex_shader)
+{
+    this->shader_stages.clear();
+    this->shader_stages.push_back(vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eVertex, vertex_shader, "main"));
+    return *this;
+}
+
 pipeline_builder_t& pipeline_builder_t::set_input_topology(const vk::PrimitiveTopology topology)
 {
     this->input_assembly.topology = topology;
@@ -115,6 +124,12 @@ pipeline_builder_t& pipeline_builder_t::enable_blending_alphablend()
     return *this;
 }
 
+pipeline_builder_t& pipeline_builder_t::disable_color_write(std::uint32_t attachment)
+{
+    this->write_disabled_attachments.push_back(attachment);
+    return *this;
+}
+
 pipeline_builder_t& pipeline_builder_t::set_color_attachment_format(const vk::Format format)
 {
     this->color_attachment_format = format;
@@ -161,16 +176,26 @@ pipeline_builder_t& pipeline_builder_t::add_vertex_input_attribute(std::uint32_t
     return *this;
 }
 
+pipeline_builder_t& pipeline_builder_t::set_flags(const vk::PipelineCreateFlags flags)
+{
+    this->flags = flags;
+    return *this;
+}
+
 std::optional<vk::Pipeline> pipeline_builder_t::build(vk::Device dev)
 {
     vk::PipelineViewportStateCreateInfo viewport_state({}, 1, {}, 1);
     std::vector<vk::PipelineColorBlendAttachmentState> color_blend_states;
     for (std::uint32_t i = 0; i < this->render_info.colorAttachmentCount; ++i) color_blend_states.push_back(this->color_blend_attachment);
+    for (std::uint32_t i : this->write_disabled_attachments)
+    {
+        if (i < color_blend_states.size()) color_blend_states[i].colorWriteMask = {};
+    }
     vk::PipelineColorBlendStateCreateInfo color_blending({}, VK_FALSE, vk::LogicOp::eCopy, color_blend_states);
     vk::PipelineVertexInputStateCreateInfo vertex_input_info({}, this->vertex_input_binding_descriptions, this->vertex_input_attribute_descriptions);
     vk::DynamicState state[] = { vk::DynamicState::eViewport, vk::DynamicState::eScissor };
     vk::PipelineDynamicStateCreateInfo dynamic_info({}, state);
-    vk::GraphicsPipelineCreateInfo pipeline_info({}, this->shader_stages, &vertex_input_info, &this->input_assembly, {}, &viewport_state, &this->rasterizer,
+    vk::GraphicsPipelineCreateInfo pipeline_info(this->flags, this->shader_stages, &vertex_input_info, &this->input_assembly, {}, &viewport_state, &this->rasterizer,
             &this->multisampling, &this->depth_stencil, &color_blending, &dynamic_info, this->pipeline_layout, {}, {}, {}, {}, &this->render_info);
     auto [result, pipeline] = dev.createGraphicsPipeline({}, pipeline_info);
     if (result != vk::Result::eSuccess)
@@ -0,0 +1,538 @@
+#include <vk-textures.h>
+#include <vk-images.h>
+#include <vk-jobs.h>
+#include <error_fmt.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <thread>
+
+std::uint32_t vkutil::bc_block_size(vk::Format format)
+{
+    switch (format)
+    {
+        case vk::Format::eBc1RgbUnormBlock:
+        case vk::Format::eBc1RgbSrgbBlock:
+        case vk::Format::eBc1RgbaUnormBlock:
+        case vk::Format::eBc1RgbaSrgbBlock:
+        case vk::Format::eBc4UnormBlock:
+            return 8;
+        case vk::Format::eBc3UnormBlock:
+        case vk::Format::eBc3SrgbBlock:
+        case vk::Format::eBc5UnormBlock:
+        case vk::Format::eBc7UnormBlock:
+        case vk::Format::eBc7SrgbBlock:
+            return 16;
+        default:
+            return 0;
+    }
+}
+
+static vk::Format unorm_format(vk::Format format)
+{
+    switch (format)
+    {
+        case vk::Format::eBc1RgbSrgbBlock: return vk::Format::eBc1RgbUnormBlock;
+        case vk::Format::eBc1RgbaSrgbBlock: return vk::Format::eBc1RgbaUnormBlock;
+        case vk::Format::eBc3SrgbBlock: return vk::Format::eBc3UnormBlock;
+        case vk::Format::eBc7SrgbBlock: return vk::Format::eBc7UnormBlock;
+        default: return format;
+    }
+}
+
+static vk::DeviceSize level_size(vk::Extent3D extent, std::uint32_t block_size)
+{
+    return vk::DeviceSize((extent.width + 3) / 4) * ((extent.height + 3) / 4) * block_size;
+}
+
+static vk::Extent3D level_extent(vk::Extent3D extent, std::uint32_t level)
+{
+    return vk::Extent3D(std::max(extent.width >> level, 1u), std::max(extent.height >> level, 1u), 1);
+}
+
+static constexpr std::array<std::uint8_t, 12> KTX2_IDENTIFIER = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+// header of a KTX2 file after its identifier, followed by the level index
+struct ktx2_header_t
+{
+    std::uint32_t vk_format;
+    std::uint32_t type_size;
+    std::uint32_t pixel_width;
+    std::uint32_t pixel_height;
+    std::uint32_t pixel_depth;
+    std::uint32_t layer_count;
+    std::uint32_t face_count;
+    std::uint32_t level_count;
+    std::uint32_t supercompression_scheme;
+    std::uint32_t dfd_byte_offset;
+    std::uint32_t dfd_byte_length;
+    std::uint32_t kvd_byte_offset;
+    std::uint32_t kvd_byte_length;
+    // NOTE: 64 bit values at an offset of 52 bytes, split so the struct is not padded.
+    std::uint32_t sgd_byte_offset[2];
+    std::uint32_t sgd_byte_length[2];
+};
+static_assert(sizeof(ktx2_header_t) == 68);
+
+struct ktx2_level_t
+{
+    std::uint64_t byte_offset;
+    std::uint64_t byte_length;
+    std::uint64_t uncompressed_byte_length;
+};
+
+bool vkutil::is_ktx2(std::span<const std::uint8_t> bytes)
+{
+    return bytes.size() >= KTX2_IDENTIFIER.size() && std::equal(KTX2_IDENTIFIER.begin(), KTX2_IDENTIFIER.end(), bytes.begin());
+}
+
+std::optional<texture_data_t> vkutil::load_ktx2(std::span<const std::uint8_t> bytes)
+{
+    ktx2_header_t header;
+    if (!is_ktx2(bytes) || bytes.size() < KTX2_IDENTIFIER.size() + sizeof(ktx2_header_t))
+    {
+        fmt::print(stderr, "[ {} ]\tKTX2: File is too small or has no KTX2 identifier!\n", ERROR_FMT("ERROR"));
+        return std::nullopt;
+    }
+    std::memcpy(&header, bytes.data() + KTX2_IDENTIFIER.size(), sizeof(ktx2_header_t));
+
+    // NOTE: Basis Universal and zstd supercompressed payloads would have to be transcoded first.
+    if (header.supercompression_scheme != 0)
+    {
+        fmt::print(stderr, "[ {} ]\tKTX2: Supercompression scheme {} is not supported!\n", ERROR_FMT("ERROR"), header.supercompression_scheme);
+        return std::nullopt;
+    }
+    if (header.pixel_width == 0 || header.pixel_height == 0 || header.pixel_depth > 1 || header.layer_count > 1 || header.face_count != 1)
+    {
+        fmt::print(stderr, "[ {} ]\tKTX2: Only 2D textures without layers or faces are supported!\n", ERROR_FMT("ERROR"));
+        return std::nullopt;
+    }
+
+    texture_data_t texture;
+    std::uint32_t block_size = bc_block_size(vk::Format(header.vk_format));
+    if (block_size == 0)
+    {
+        fmt::print(stderr, "[ {} ]\tKTX2: Format {} is not block compressed!\n", ERROR_FMT("ERROR"), vk::to_string(vk::Format(header.vk_format)));
+        return std::nullopt;
+    }
+    texture.format = unorm_format(vk::Format(header.vk_format));
+    texture.extent = vk::Extent3D(header.pixel_width, header.pixel_height, 1);
+
+    // NOTE: A level count of 0 asks for mip levels to be generated, which is not possible for block compressed formats.
+    std::uint32_t level_count = std::max(header.level_count, 1u);
+    if (level_count > mip_level_count(vk::Extent2D(header.pixel_width, header.pixel_height)))
+    {
+        fmt::print(stderr, "[ {} ]\tKTX2: File has more levels than its size allows!\n", ERROR_FMT("ERROR"));
+        return std::nullopt;
+    }
+    std::size_t index_offset = KTX2_IDENTIFIER.size() + sizeof(ktx2_header_t);
+    if (bytes.size() < index_offset + level_count * sizeof(ktx2_level_t))
+    {
+        fmt::print(stderr, "[ {} ]\tKTX2: Level index is out of bounds!\n", ERROR_FMT("ERROR"));
+        return std::nullopt;
+    }
+
+    for (std::uint32_t i = 0; i < level_count; ++i)
+    {
+        ktx2_level_t level;
+        std::memcpy(&level, bytes.data() + index_offset + i * sizeof(ktx2_level_t), sizeof(ktx2_level_t));
+
+        vk::Extent3D extent = level_extent(texture.extent, i);
+        vk::DeviceSize size = level_size(extent, block_size);
+        if (level.byte_length != size || level.byte_offset > bytes.size() || bytes.size() - level.byte_offset < size)
+        {
+            fmt::print(stderr, "[ {} ]\tKTX2: Level {} has the wrong size or is out of bounds!\n", ERROR_FMT("ERROR"), i);
+            return std::nullopt;
+        }
+        texture.levels.push_back(texture_level_t{ .offset = texture.data.size(), .size = size, .extent = extent });
+        texture.data.insert(texture.data.end(), bytes.begin() + level.byte_offset, bytes.begin() + level.byte_offset + size);
+    }
+    return texture;
+}
+
+static std::uint16_t pack_565(const float* color)
+{
+    std::uint32_t r = std::uint32_t(std::clamp(color[0], 0.f, 255.f) * 31.f / 255.f + .5f);
+    std::uint32_t g = std::uint32_t(std::clamp(color[1], 0.f, 255.f) * 63.f / 255.f + .5f);
+    std::uint32_t b = std::uint32_t(std::clamp(color[2], 0.f, 255.f) * 31.f / 255.f + .5f);
+    return std::uint16_t((r << 11) | (g << 5) | b);
+}
+
+static void unpack_565(std::uint16_t packed, float* color)
+{
+    std::uint32_t r = (packed >> 11) & 31;
+    std::uint32_t g = (packed >> 5) & 63;
+    std::uint32_t b = packed & 31;
+    color[0] = float((r << 3) | (r >> 2));
+    color[1] = float((g << 2) | (g >> 4));
+    color[2] = float((b << 3) | (b >> 2));
+}
+
+// Picks the nearest of the 4 colors interpolated between `c0` and `c1` for every texel.
+static std::uint32_t bc1_indices(const float (&texels)[16][4], std::uint16_t c0, std::uint16_t c1, float& error)
+{
+    float palette[4][3];
+    unpack_565(c0, palette[0]);
+    unpack_565(c1, palette[1]);
+    for (std::uint32_t c = 0; c < 3; ++c)
+    {
+        palette[2][c] = (2.f * palette[0][c] + palette[1][c]) / 3.f;
+        palette[3][c] = (palette[0][c] + 2.f * palette[1][c]) / 3.f;
+    }
+
+    std::uint32_t indices = 0;
+    error = 0.f;
+    for (std::uint32_t i = 0; i < 16; ++i)
+    {
+        std::uint32_t best = 0;
+        float best_distance = INFINITY;
+        for (std::uint32_t p = 0; p < 4; ++p)
+        {
+            float distance = 0.f;
+            for (std::uint32_t c = 0; c < 3; ++c) distance += (texels[i][c] - palette[p][c]) * (texels[i][c] - palette[p][c]);
+            if (distance < best_distance)
+            {
+                best = p;
+                best_distance = distance;
+            }
+        }
+        indices |= best << (i * 2);
+        error += best_distance;
+    }
+    return indices;
+}
+
+// Least squares endpoints for the given indices.
+static bool bc1_refine(const float (&texels)[16][4], std::uint32_t indices, float* max_color, float* min_color)
+{
+    static constexpr float weights[4] = { 1.f, 0.f, 2.f / 3.f, 1.f / 3.f };
+    float aa = 0.f, bb = 0.f, ab = 0.f;
+    float ax[3] = {}, bx[3] = {};
+    for (std::uint32_t i = 0; i < 16; ++i)
+    {
+        float a = weights[(indices >> (i * 2)) & 3];
+        float b = 1.f - a;
+        aa += a * a;
+        bb += b * b;
+        ab += a * b;
+        for (std::uint32_t c = 0; c < 3; ++c)
+        {
+            ax[c] += a * texels[i][c];
+            bx[c] += b * texels[i][c];
+        }
+    }
+    float determinant = aa * bb - ab * ab;
+    if (std::fabs(determinant) < 1e-6f) return false;
+    for (std::uint32_t c = 0; c < 3; ++c)
+    {
+        max_color[c] = (ax[c] * bb - bx[c] * ab) / determinant;
+        min_color[c] = (bx[c] * aa - ax[c] * ab) / determinant;
+    }
+    return true;
+}
+
+// Encodes the colors of 16 texels into a BC1 block in 4 color mode.
+static void encode_bc1_block(const float (&texels)[16][4], std::uint8_t* block)
+{
+    float mean[3] = {};
+    for (std::uint32_t i = 0; i < 16; ++i)
+    {
+        for (std::uint32_t c = 0; c < 3; ++c) mean[c] += texels[i][c] / 16.f;
+    }
+
+    // NOTE: The endpoints are the extremes along the principal axis of the colors, found by power iteration of their covariance.
+    float covariance[6] = {};
+    for (std::uint32_t i = 0; i < 16; ++i)
+    {
+        float r = texels[i][0] - mean[0], g = texels[i][1] - mean[1], b = texels[i][2] - mean[2];
+        covariance[0] += r * r; covariance[1] += r * g; covariance[2] += r * b;
+        covariance[3] += g * g; covariance[4] += g * b; covariance[5] += b * b;
+    }
+    float axis[3] = { 1.f, 1.f, 1.f };
+    for (std::uint32_t iteration = 0; iteration < 8; ++iteration)
+    {
+        float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+        float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+        float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+        float length = std::max({ std::fabs(x), std::fabs(y), std::fabs(z) });
+        if (length < 1e-6f) break;
+        axis[0] = x / length; axis[1] = y / length; axis[2] = z / length;
+    }
+
+    float min_projection = INFINITY, max_projection = -INFINITY;
+    std::uint32_t min_texel = 0, max_texel = 0;
+    for (std::uint32_t i = 0; i < 16; ++i)
+    {
+        float projection = texels[i][0] * axis[0] + texels[i][1] * axis[1] + texels[i][2] * axis[2];
+        if (projection < min_projection) { min_projection = projection; min_texel = i; }
+        if (projection > max_projection) { max_projection = projection; max_texel = i; }
+    }
+
+    // NOTE: Insetting the endpoints a little spends the interpolated colors on the bulk of the block instead of its outliers.
+    float max_color[3], min_color[3];
+    for (std::uint32_t c = 0; c < 3; ++c)
+    {
+        float inset = (texels[max_texel][c] - texels[min_texel][c]) / 16.f;
+        max_color[c] = texels[max_texel][c] - inset;
+        min_color[c] = texels[min_texel][c] + inset;
+    }
+
+    std::uint16_t c0 = pack_565(max_color);
+    std::uint16_t c1 = pack_565(min_color);
+    float error;
+    std::uint32_t indices = bc1_indices(texels, c0, c1, error);
+
+    if (bc1_refine(texels, indices, max_color, min_color))
+    {
+        std::uint16_t refined_c0 = pack_565(max_color);
+        std::uint16_t refined_c1 = pack_565(min_color);
+        float refined_error;
+        std::uint32_t refined_indices = bc1_indices(texels, refined_c0, refined_c1, refined_error);
+        if (refined_error < error)
+        {
+            c0 = refined_c0;
+            c1 = refined_c1;
+            indices = refined_indices;
+        }
+    }
+
+    // NOTE: `c0 > c1` selects the 4 color mode. Swapping the endpoints swaps indices 0 with 1 and 2 with 3.
+    if (c0 < c1)
+    {
+        std::swap(c0, c1);
+        indices ^= 0x55555555;
+    }
+    else if (c0 == c1)
+    {
+        indices = 0;
+    }
+
+    std::memcpy(block, &c0, 2);
+    std::memcpy(block + 2, &c1, 2);
+    std::memcpy(block + 4, &indices, 4);
+}
+
+// Encodes channel `channel` of 16 texels into a BC4 block in 8 value mode.
+static void encode_bc4_block(const float (&texels)[16][4], std::uint32_t channel, std::uint8_t* block)
+{
+    float min_value = 255.f, max_value = 0.f;
+    for (std::uint32_t i = 0; i < 16; ++i)
+    {
+        min_value = std::min(min_value, texels[i][channel]);
+        max_value = std::max(max_value, texels[i][channel]);
+    }
+    std::uint8_t v0 = std::uint8_t(max_value + .5f);
+    std::uint8_t v1 = std::uint8_t(min_value + .5f);
+
+    std::uint64_t indices = 0;
+    if (v0 > v1)
+    {
+        float palette[8] = { float(v0), float(v1) };
+        for (std::uint32_t p = 1; p < 7; ++p) palette[p + 1] = ((7 - p) * v0 + p * v1) / 7.f;
+        for (std::uint32_t i = 0; i < 16; ++i)
+        {
+            std::uint64_t best = 0;
+            for (std::uint32_t p = 1; p < 8; ++p)
+            {
+                if (std::fabs(texels[i][channel] - palette[p]) < std::fabs(texels[i][channel] - palette[best])) best = p;
+            }
+            indices |= best << (i * 3);
+        }
+    }
+
+    block[0] = v0;
+    block[1] = v1;
+    for (std::uint32_t i = 0; i < 6; ++i) block[2 + i] = std::uint8_t(indices >> (i * 8));
+}
+
+std::vector<std::uint8_t> vkutil::encode_bc(const std::uint8_t* texels, vk::Extent2D size, vk::Format format, job_pool_t* jobs)
+{
+    std::uint32_t block_size = bc_block_size(format);
+    std::uint32_t blocks_x = (size.width + 3) / 4;
+    std::uint32_t blocks_y = (size.height + 3) / 4;
+    std::vector<std::uint8_t> result(std::size_t(blocks_x) * blocks_y * block_size);
+
+    auto encode_row = [&](std::size_t y)
+    {
+        for (std::uint32_t x = 0; x < blocks_x; ++x)
+        {
+            // NOTE: Blocks that reach past the edge repeat the last row and column.
+            float block_texels[16][4];
+            for (std::uint32_t i = 0; i < 16; ++i)
+            {
+                std::uint32_t tx = std::min(x * 4 + i % 4, size.width - 1);
+                std::uint32_t ty = std::min(std::uint32_t(y) * 4 + i / 4, size.height - 1);
+                for (std::uint32_t c = 0; c < 4; ++c) block_texels[i][c] = texels[(std::size_t(ty) * size.width + tx) * 4 + c];
+            }
+
+            std::uint8_t* block = &result[(y * blocks_x + x) * block_size];
+            switch (format)
+            {
+                case vk::Format::eBc1RgbUnormBlock:
+                case vk::Format::eBc1RgbaUnormBlock:
+                    encode_bc1_block(block_texels, block);
+                    break;
+                case vk::Format::eBc3UnormBlock:
+                    encode_bc4_block(block_texels, 3, block);
+                    encode_bc1_block(block_texels, block + 8);
+                    break;
+                case vk::Format::eBc4UnormBlock:
+                    encode_bc4_block(block_texels, 0, block);
+                    break;
+                case vk::Format::eBc5UnormBlock:
+                    encode_bc4_block(block_texels, 0, block);
+                    encode_bc4_block(block_texels, 1, block + 8);
+                    break;
+                default:
+                    break;
+            }
+        }
+    };
+
+    if (jobs) jobs->parallel_for(blocks_y, encode_row);
+    else for (std::uint32_t y = 0; y < blocks_y; ++y) encode_row(y);
+    return result;
+}
+
+texture_data_t vkutil::compress_texture(const std::uint8_t* texels, vk::Extent2D size, bool srgb, job_pool_t* jobs)
+{
+    bool opaque = true;
+    for (std::size_t i = 0; i < std::size_t(size.width) * size.height && opaque; ++i) opaque = texels[i * 4 + 3] == 255;
+
+    texture_data_t texture;
+    texture.format = opaque ? vk::Format::eBc1RgbaUnormBlock : vk::Format::eBc3UnormBlock;
+    texture.extent = vk::Extent3D(size.width, size.height, 1);
+
+    std::vector<std::uint8_t> level;
+    std::uint32_t level_count = mip_level_count(size);
+    for (std::uint32_t i = 0; i < level_count; ++i)
+    {
+        std::vector<std::uint8_t> blocks = encode_bc(texels, size, texture.format, jobs);
+        texture.levels.push_back(texture_level_t{ .offset = texture.data.size(), .size = blocks.size(), .extent = vk::Extent3D(size.width, size.height, 1) });
+        texture.data.insert(texture.data.end(), blocks.begin(), blocks.end());
+
+        if (i + 1 < level_count)
+        {
+            level = downsample_rgba8(texels, size, srgb);
+            texels = level.data();
+            size = vk::Extent2D(std::max(size.width / 2, 1u), std::max(size.height / 2, 1u));
+        }
+    }
+    return texture;
+}
+
+texture_data_t vkutil::build_mip_chain(const std::uint8_t* texels, vk::Extent2D size, bool srgb)
+{
+    texture_data_t texture;
+    texture.format = vk::Format::eR8G8B8A8Unorm;
+    texture.extent = vk::Extent3D(size.width, size.height, 1);
+
+    std::vector<std::uint8_t> level;
+    std::uint32_t level_count = mip_level_count(size);
+    for (std::uint32_t i = 0; i < level_count; ++i)
+    {
+        vk::DeviceSize level_bytes = vk::DeviceSize(size.width) * size.height * 4;
+        texture.levels.push_back(texture_level_t{ .offset = texture.data.size(), .size = level_bytes, .extent = vk::Extent3D(size.width, size.height, 1) });
+        texture.data.insert(texture.data.end(), texels, texels + level_bytes);
+
+        if (i + 1 < level_count)
+        {
+            level = downsample_rgba8(texels, size, srgb);
+            texels = level.data();
+            size = vk::Extent2D(std::max(size.width / 2, 1u), std::max(size.height / 2, 1u));
+        }
+    }
+    return texture;
+}
+
+std::uint32_t vkutil::first_level_within(const texture_data_t& texture, std::uint32_t max_size)
+{
+    std::uint32_t level = 0;
+    while (level + 1 < texture.levels.size()
+            && (texture.levels[level].extent.width > max_size || texture.levels[level].extent.height > max_size)) ++level;
+    return level;
+}
+
+std::uint64_t vkutil::hash_bytes(std::span<const std::uint8_t> bytes, std::uint64_t seed)
+{
+    std::uint64_t hash = seed;
+    for (std::uint8_t byte : bytes)
+    {
+        hash ^= byte;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// NOTE: Bump the version whenever the encoders change, so stale cache files are encoded again.
+static constexpr std::uint32_t TEXTURE_CACHE_MAGIC = 0x58544342;
+static constexpr std::uint32_t TEXTURE_CACHE_VERSION = 1;
+
+struct texture_cache_header_t
+{
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t format;
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint32_t level_count;
+};
+
+std::optional<texture_data_t> vkutil::read_texture_cache(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return std::nullopt;
+
+    texture_cache_header_t header;
+    if (!file.read((char*)&header, sizeof(header)) || header.magic != TEXTURE_CACHE_MAGIC || header.version != TEXTURE_CACHE_VERSION) return std::nullopt;
+    std::uint32_t block_size = bc_block_size(vk::Format(header.format));
+    if (block_size == 0 || header.width == 0 || header.height == 0 || header.level_count == 0
+            || header.level_count > mip_level_count(vk::Extent2D(header.width, header.height))) return std::nullopt;
+
+    texture_data_t texture;
+    texture.format = vk::Format(header.format);
+    texture.extent = vk::Extent3D(header.width, header.height, 1);
+    for (std::uint32_t i = 0; i < header.level_count; ++i)
+    {
+        vk::Extent3D extent = level_extent(texture.extent, i);
+        vk::DeviceSize size = level_size(extent, block_size);
+        texture.levels.push_back(texture_level_t{ .offset = texture.data.size(), .size = size, .extent = extent });
+        texture.data.resize(texture.data.size() + size);
+    }
+    if (!file.read((char*)texture.data.data(), texture.data.size())) return std::nullopt;
+    return texture;
+}
+
+bool vkutil::write_texture_cache(const std::string& path, const texture_data_t& texture)
+{
+    std::filesystem::path file_path = path;
+    std::error_code error;
+    std::filesystem::create_directories(file_path.parent_path(), error);
+
+    std::filesystem::path temporary = file_path;
+    temporary += fmt::format(".{}.tmp", std::hash<std::thread::id>()(std::this_thread::get_id()));
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        texture_cache_header_t header{ .magic = TEXTURE_CACHE_MAGIC, .version = TEXTURE_CACHE_VERSION, .format = std::uint32_t(texture.format),
+            .width = texture.extent.width, .height = texture.extent.height, .level_count = std::uint32_t(texture.levels.size()) };
+        if (!file.is_open() || !file.write((const char*)&header, sizeof(header)) || !file.write((const char*)texture.data.data(), texture.data.size()))
+        {
+            fmt::print(stderr, "[ {} ]\tFailed to write texture cache file '{}'!\n", ERROR_FMT("ERROR"), temporary.string());
+            std::filesystem::remove(temporary, error);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(temporary, file_path, error);
+    if (error)
+    {
+        fmt::print(stderr, "[ {} ]\tFailed to write texture cache file '{}'!\n", ERROR_FMT("ERROR"), path);
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,410 @@
+#include <vk-upload.h>
+#include <vk-images.h>
+#include <error_fmt.h>
+#include <algorithm>
+#include <cstring>
+
+static std::optional<allocated_buffer_t> create_staging_buffer(VmaAllocator allocator, vk::DeviceSize size)
+{
+    vk::BufferCreateInfo buffer_info({}, size, vk::BufferUsageFlagBits::eTransferSrc);
+    // NOTE: Staged data is written without flushing, so the memory has to be coherent.
+    VmaAllocationCreateInfo alloc_info{ .flags = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+        .usage = VMA_MEMORY_USAGE_AUTO, .requiredFlags = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT };
+    allocated_buffer_t buf;
+    if (vmaCreateBuffer(allocator, (VkBufferCreateInfo*)&buffer_info, &alloc_info, (VkBuffer*)&buf.buffer, &buf.allocation, &buf.info) != VK_SUCCESS)
+    {
+        fmt::print(stderr, "[ {} ]\tFailed to create staging buffer!\n", ERROR_FMT("ERROR"));
+        return std::nullopt;
+    }
+    return buf;
+}
+
+bool upload_manager_t::init(vk::Device device, VmaAllocator allocator, vk::Queue queue, std::uint32_t family_index, vk::Queue graphics_queue,
+        std::uint32_t graphics_family_index, vk::DeviceSize ring_size)
+{
+    this->device = device;
+    this->allocator = allocator;
+    this->queue = queue;
+    this->family_index = family_index;
+    this->graphics_queue = graphics_queue;
+    this->graphics_family_index = graphics_family_index;
+
+    vk::SemaphoreTypeCreateInfo timeline_type_info(vk::SemaphoreType::eTimeline, 0);
+    vk::SemaphoreCreateInfo timeline_info({}, &timeline_type_info);
+    vk::Result result;
+    std::tie(result, this->timeline) = device.createSemaphore(timeline_info);
+    if (result != vk::Result::eSuccess)
+    {
+        fmt::print(stderr, "[ {} ]\tFailed to create timeline semaphore!\n", ERROR_FMT("ERROR"));
+        return false;
+    }
+
+    auto ret = create_staging_buffer(allocator, ring_size);
+    if (!ret.has_value()) return false;
+    this->staging = ret.value();
+    this->ring_size = ring_size;
+
+    return true;
+}
+
+void upload_manager_t::destroy()
+{
+    auto destroy_batch = [this](upload_batch_t& batch)
+    {
+        this->device.destroyCommandPool(batch.pool);
+        if (batch.graphics_pool) this->device.destroyCommandPool(batch.graphics_pool);
+        for (const allocated_buffer_t& buf : batch.dedicated_buffers) vmaDestroyBuffer(this->allocator, buf.buffer, buf.allocation);
+        for (vk::ImageView view : batch.views) this->device.destroyImageView(view);
+    };
+
+    if (this->open_batch.has_value()) destroy_batch(this->open_batch.value());
+    for (upload_batch_t& batch : this->in_flight) destroy_batch(batch);
+    for (upload_batch_t& batch : this->free_batches) destroy_batch(batch);
+    this->open_batch.reset();
+    this->in_flight.clear();
+    this->free_batches.clear();
+
+    vmaDestroyBuffer(this->allocator, this->staging.buffer, this->staging.allocation);
+    this->device.destroySemaphore(this->timeline);
+}
+
+bool upload_manager_t::begin_batch()
+{
+    if (this->open_batch.has_value()) return true;
+
+    upload_batch_t batch;
+    vk::Result result;
+    std::vector<vk::CommandBuffer> buf;
+    if (!this->free_batches.empty())
+    {
+        batch = std::move(this->free_batches.back());
+        this->free_batches.pop_back();
+    }
+    else
+    {
+        vk::CommandPoolCreateInfo pool_info(vk::CommandPoolCreateFlagBits::eTransient, this->family_index);
+        std::tie(result, batch.pool) = this->device.createCommandPool(pool_info);
+        if (result != vk::Result::eSuccess)
+        {
+            fmt::print(stderr, "[ {} ]\tFailed to create command pool!\n", ERROR_FMT("ERROR"));
+            return false;
+        }
+        std::tie(result, buf) = this->device.allocateCommandBuffers(vk::CommandBufferAllocateInfo(batch.pool, vk::CommandBufferLevel::ePrimary, 1));
+        if (result != vk::Result::eSuccess)
+        {
+            fmt::print(stderr, "[ {} ]\tFailed to create command buffer!\n", ERROR_FMT("ERROR"));
+            this->device.destroyCommandPool(batch.pool);
+            return false;
+        }
+        batch.cmd = buf[0];
+
+        if (this->family_index != this->graphics_family_index)
+        {
+            pool_info.queueFamilyIndex = this->graphics_family_index;
+            std::tie(result, batch.graphics_pool) = this->device.createCommandPool(pool_info);
+            if (result == vk::Result::eSuccess)
+            {
+                std::tie(result, buf) = this->device.allocateCommandBuffers(vk::CommandBufferAllocateInfo(batch.graphics_pool, vk::CommandBufferLevel::ePrimary, 1));
+            }
+            if (result != vk::Result::eSuccess)
+            {
+                fmt::print(stderr, "[ {} ]\tFailed to create graphics command buffer for uploads!\n", ERROR_FMT("ERROR"));
+                this->device.destroyCommandPool(batch.pool);
+                if (batch.graphics_pool) this->device.destroyCommandPool(batch.graphics_pool);
+                return false;
+            }
+            batch.graphics_cmd = buf[0];
+        }
+    }
+
+    vk::CommandBufferBeginInfo begin_info(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+    if (result = batch.cmd.begin(begin_info); result != vk::Result::eSuccess)
+    {
+        fmt::print(stderr, "[ {} ]\tFailed to begin recording command buffer!\n", ERROR_FMT("ERROR"));
+        this->free_batches.push_back(std::move(batch));
+        return false;
+    }
+
+    batch.graphics_recorded = false;
+    batch.ticket = this->last_submitted + 2;
+    this->open_batch = std::move(batch);
+    return true;
+}
+
+std::optional<upload_group_t> upload_manager_t::reserve(vk::DeviceSize size)
+{
+    // NOTE: Without anything in flight the ring can start over at its beginning, so large uploads do not have to skip the end of it.
+    if (this->ring_head == this->ring_tail)
+    {
+        this->ring_head = (this->ring_head + this->ring_size - 1) / this->ring_size * this->ring_size;
+        this->ring_tail = this->ring_head;
+    }
+
+    // NOTE: Uploads never wrap around the end of the ring, the rest of it is skipped instead.
+    std::uint64_t position = (this->ring_head + UPLOAD_STAGING_ALIGNMENT - 1) / UPLOAD_STAGING_ALIGNMENT * UPLOAD_STAGING_ALIGNMENT;
+    if (position % this->ring_size + size > this->ring_size) position = (position / this->ring_size + 1) * this->ring_size;
+    if (size <= this->ring_size && position + size - this->ring_tail <= this->ring_size)
+    {
+        vk::DeviceSize offset = position % this->ring_size;
+        this->ring_head = position + size;
+        return upload_group_t{ .buffer = this->staging.buffer, .data = (std::uint8_t*)this->staging.info.pMappedData + offset, .offset = offset,
+            .size = size };
+    }
+
+    auto ret = create_staging_buffer(this->allocator, size);
+    if (!ret.has_value()) return std::nullopt;
+    this->open_batch.value().dedicated_buffers.push_back(ret.value());
+    return upload_group_t{ .buffer = ret.value().buffer, .data = (std::uint8_t*)ret.value().info.pMappedData, .offset = 0, .size = size };
+}
+
+std::optional<std::pair<vk::Buffer, vk::DeviceSize>> upload_manager_t::stage(const void* data, vk::DeviceSize size, upload_group_t* group)
+{
+    if (group && group->used + size <= group->size)
+    {
+        vk::DeviceSize offset = group->offset + group->used;
+        std::memcpy(group->data + group->used, data, size);
+        group->used += upload_manager_t::staging_size(size);
+        return std::make_pair(group->buffer, offset);
+    }
+
+    auto range = this->reserve(size);
+    if (!range.has_value()) return std::nullopt;
+    std::memcpy(range.value().data, data, size);
+    return std::make_pair(range.value().buffer, range.value().offset);
+}
+
+std::optional<upload_group_t> upload_manager_t::begin_group(vk::DeviceSize size)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (!this->begin_batch()) return std::nullopt;
+    auto group = this->reserve(size);
+    if (!group.has_value()) return std::nullopt;
+    this->open_groups++;
+    return group;
+}
+
+std::optional<upload_ticket_t> upload_manager_t::end_group(upload_group_t& group)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (this->open_groups > 0) this->open_groups--;
+    group = upload_group_t();
+    if (!this->open_batch.has_value()) return std::nullopt;
+    return this->open_batch.value().ticket;
+}
+
+std::optional<upload_ticket_t> upload_manager_t::upload_buffer(vk::Buffer dst, vk::DeviceSize offset, const void* data, vk::DeviceSize size,
+        upload_group_t* group)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (!this->begin_batch()) return std::nullopt;
+    auto staged = this->stage(data, size, group);
+    if (!staged.has_value()) return std::nullopt;
+
+    vk::BufferCopy copy(staged.value().second, offset, size);
+    this->open_batch.value().cmd.copyBuffer(staged.value().first, dst, copy);
+    return this->open_batch.value().ticket;
+}
+
+std::optional<upload_ticket_t> upload_manager_t::upload_image(const allocated_image_t& image, const void* data, vk::DeviceSize size, bool mipmapped,
+        upload_group_t* group, mip_filter_e filter)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (!this->begin_batch()) return std::nullopt;
+    auto staged = this->stage(data, size, group);
+    if (!staged.has_value()) return std::nullopt;
+
+    upload_batch_t& batch = this->open_batch.value();
+    vkutil::transition_image(batch.cmd, image.image, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal);
+    vk::BufferImageCopy copy_region(staged.value().second, 0, 0, vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1), {}, image.extent);
+    batch.cmd.copyBufferToImage(staged.value().first, image.image, vk::ImageLayout::eTransferDstOptimal, copy_region);
+
+    if (!mipmapped)
+    {
+        vkutil::transition_image(batch.cmd, image.image, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal);
+        return batch.ticket;
+    }
+
+    // NOTE: Transfer queues can neither blit nor dispatch, so the mip levels are generated on the graphics queue once the copies
+    // of the batch are done.
+    vk::CommandBuffer mip_cmd = batch.cmd;
+    if (this->family_index != this->graphics_family_index)
+    {
+        if (!batch.graphics_recorded)
+        {
+            vk::CommandBufferBeginInfo begin_info(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+            if (batch.graphics_cmd.begin(begin_info) != vk::Result::eSuccess)
+            {
+                fmt::print(stderr, "[ {} ]\tFailed to begin recording command buffer!\n", ERROR_FMT("ERROR"));
+                return std::nullopt;
+            }
+            batch.graphics_recorded = true;
+        }
+        mip_cmd = batch.graphics_cmd;
+    }
+
+    vk::Extent2D extent(image.extent.width, image.extent.height);
+    if (this->mips == nullptr)
+    {
+        vkutil::generate_mipmaps(mip_cmd, image.image, extent);
+        return batch.ticket;
+    }
+
+    vkutil::transition_image(mip_cmd, image.image, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eGeneral);
+    if (!this->mips->generate(mip_cmd, image, vkutil::mip_level_count(extent), filter, batch.views)) return std::nullopt;
+    vkutil::transition_image(mip_cmd, image.image, vk::ImageLayout::eGeneral, vk::ImageLayout::eShaderReadOnlyOptimal);
+    return batch.ticket;
+}
+
+std::optional<upload_ticket_t> upload_manager_t::upload_texture(const allocated_image_t& image, const texture_data_t& texture, upload_group_t* group,
+        std::uint32_t first_level, std::uint32_t level_count, std::uint32_t image_level)
+{
+    if (level_count == VK_REMAINING_MIP_LEVELS) level_count = texture.levels.size() - first_level;
+    const texture_level_t& first = texture.levels[first_level];
+    const texture_level_t& last = texture.levels[first_level + level_count - 1];
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (!this->begin_batch()) return std::nullopt;
+    // NOTE: Levels are packed back to back, so a range of them is contiguous.
+    auto staged = this->stage(texture.data.data() + first.offset, last.offset + last.size - first.offset, group);
+    if (!staged.has_value()) return std::nullopt;
+
+    // NOTE: Levels of block compressed formats are a multiple of the 8 or 16 byte block size and levels of 4 byte texels
+    // a multiple of 4 bytes, so their offsets stay aligned.
+    std::vector<vk::BufferImageCopy> copy_regions;
+    copy_regions.reserve(level_count);
+    for (std::uint32_t mip = first_level; mip < first_level + level_count; ++mip)
+    {
+        const texture_level_t& level = texture.levels[mip];
+        copy_regions.push_back(vk::BufferImageCopy(staged.value().second + level.offset - first.offset, 0, 0,
+                    vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, mip - image_level, 0, 1), {}, level.extent));
+    }
+
+    upload_batch_t& batch = this->open_batch.value();
+    vkutil::transition_image(batch.cmd, image.image, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal, first_level - image_level,
+            level_count);
+    batch.cmd.copyBufferToImage(staged.value().first, image.image, vk::ImageLayout::eTransferDstOptimal, copy_regions);
+    vkutil::transition_image(batch.cmd, image.image, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+            first_level - image_level, level_count);
+    return batch.ticket;
+}
+
+bool upload_manager_t::flush()
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (!this->open_batch.has_value() || this->open_groups > 0) return true;
+
+    upload_batch_t batch = std::move(this->open_batch.value());
+    this->open_batch.reset();
+    batch.ring_end = this->ring_head;
+    this->last_submitted = batch.ticket;
+    // NOTE: The batch stays in flight even if submitting it fails below, so its command pools are destroyed with the manager.
+    this->in_flight.push_back(std::move(batch));
+    upload_batch_t& submitted = this->in_flight.back();
+
+    if (submitted.cmd.end() != vk::Result::eSuccess || (submitted.graphics_recorded && submitted.graphics_cmd.end() != vk::Result::eSuccess))
+    {
+        fmt::print(stderr, "[ {} ]\tFailed to end recording command buffer!\n", ERROR_FMT("ERROR"));
+        return false;
+    }
+
+    std::vector<vk::SemaphoreSubmitInfo> wait_infos;
+    if (submitted.ticket > 2) wait_infos.push_back(vk::SemaphoreSubmitInfo(this->timeline, submitted.ticket - 2, vk::PipelineStageFlagBits2::eAllCommands, 0));
+    vk::SemaphoreSubmitInfo signal_info(this->timeline, submitted.graphics_recorded ? submitted.ticket - 1 : submitted.ticket,
+            vk::PipelineStageFlagBits2::eAllCommands, 0);
+    vk::CommandBufferSubmitInfo cmd_info(submitted.cmd);
+    vk::SubmitInfo2 submit({}, wait_infos, cmd_info, signal_info);
+    if (this->queue.submit2(submit) != vk::Result::eSuccess)
+    {
+        fmt::print(stderr, "[ {} ]\tFailed to submit to transfer queue!\n", ERROR_FMT("ERROR"));
+        return false;
+    }
+
+    if (!submitted.graphics_recorded) return true;
+
+    vk::SemaphoreSubmitInfo graphics_wait_info(this->timeline, submitted.ticket - 1, vk::PipelineStageFlagBits2::eAllCommands, 0);
+    vk::SemaphoreSubmitInfo graphics_signal_info(this->timeline, submitted.ticket, vk::PipelineStageFlagBits2::eAllCommands, 0);
+    vk::CommandBufferSubmitInfo graphics_cmd_info(submitted.graphics_cmd);
+    vk::SubmitInfo2 graphics_submit({}, graphics_wait_info, graphics_cmd_info, graphics_signal_info);
+    if (this->graphics_queue.submit2(graphics_submit) != vk::Result::eSuccess)
+    {
+        fmt::print(stderr, "[ {} ]\tFailed to submit to graphics queue!\n", ERROR_FMT("ERROR"));
+        return false;
+    }
+
+    return true;
+}
+
+std::pair<std::uint32_t, vk::DeviceSize> upload_manager_t::staging_memory()
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    std::uint32_t count = this->staging.buffer ? 1 : 0;
+    vk::DeviceSize size = this->staging.buffer ? this->staging.info.size : 0;
+    auto add = [&](const upload_batch_t& batch)
+    {
+        for (const allocated_buffer_t& buf : batch.dedicated_buffers)
+        {
+            ++count;
+            size += buf.info.size;
+        }
+    };
+    if (this->open_batch.has_value()) add(this->open_batch.value());
+    for (const upload_batch_t& batch : this->in_flight) add(batch);
+    return { count, size };
+}
+
+void upload_manager_t::collect()
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    auto [result, value] = this->device.getSemaphoreCounterValue(this->timeline);
+    if (result != vk::Result::eSuccess) return;
+    if (value > this->completed) this->completed = value;
+
+    while (!this->in_flight.empty() && this->in_flight.front().ticket <= value)
+    {
+        upload_batch_t batch = std::move(this->in_flight.front());
+        this->in_flight.pop_front();
+
+        this->ring_tail = std::max(this->ring_tail, batch.ring_end);
+        for (const allocated_buffer_t& buf : batch.dedicated_buffers) vmaDestroyBuffer(this->allocator, buf.buffer, buf.allocation);
+        batch.dedicated_buffers.clear();
+        for (vk::ImageView view : batch.views) this->device.destroyImageView(view);
+        batch.views.clear();
+        if (this->device.resetCommandPool(batch.pool) != vk::Result::eSuccess
+                || (batch.graphics_pool && this->device.resetCommandPool(batch.graphics_pool) != vk::Result::eSuccess))
+        {
+            fmt::print(stderr, "[ {} ]\tFailed to reset command pool!\n", ERROR_FMT("ERROR"));
+        }
+        this->free_batches.push_back(std::move(batch));
+    }
+}
+
+bool upload_manager_t::wait(upload_ticket_t ticket, std::uint64_t timeout)
+{
+    if (this->is_ready(ticket)) return true;
+
+    bool open;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        open = ticket > this->last_submitted;
+    }
+    if (open && !this->flush()) return false;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        open = ticket > this->last_submitted;
+    }
+    if (open)
+    {
+        fmt::print(stderr, "[ {} ]\tCan not wait for uploads of a group that has not ended!\n", ERROR_FMT("ERROR"));
+        return false;
+    }
+
+    vk::SemaphoreWaitInfo wait_info({}, 1, &this->timeline, &ticket);
+    if (this->device.waitSemaphores(wait_info, timeout) != vk::Result::eSuccess)
+    {
+        fmt::print(stderr, "[ {} ]\tFailed to wait for uploads!\n", ERROR_FMT("ERROR"));
+        return false;
+    }
+
+    this->collect();
+    return true;
+}
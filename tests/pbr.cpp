@@ -13,6 +13,9 @@ int main()
     camera_t cam{ .position = glm::vec3(0.f, 0.f, 2.f) };
     glfwSetWindowUserPointer(engine.window.win, &cam);
 
+    engine.depth_prepass = true;
+    // NOTE: The draw command below does not render the background, so there is no compute work to overlap with.
+    engine.use_async_compute = false;
     engine.init_pipelines = [&]() -> bool { return engine.init_background_pipelines(); };
 
     if (!engine.init_vulkan("pbr")) return EXIT_FAILURE;
@@ -24,8 +27,7 @@ int main()
     };
     std::vector<vk::Format> formats = { engine.draw_image.format, engine.draw_image.format, engine.draw_image.format };
     if (!engine.metal_rough_material.build_pipelines(&engine, pwd + "/tests/build/shaders/pbr.vert.spv", pwd + "/tests/build/shaders/pbr.frag.spv",
-                sizeof(gpu_draw_push_constants_t), { {0, vk::DescriptorType::eUniformBuffer}, {1, vk::DescriptorType::eCombinedImageSampler}, {2, vk::DescriptorType::eCombinedImageSampler} },
-                {engine.scene_data.layout}, input_bindings, input_attriubtes, formats)) return EXIT_FAILURE;
+                sizeof(gpu_draw_push_constants_t), input_bindings, input_attriubtes, formats)) return EXIT_FAILURE;
     engine.load_model(pwd + file, "sgb");
     engine.loaded_scenes["sgb"]->transform.push_back(glm::scale(glm::mat4(1), glm::vec3(0.01f, 0.01f, 0.01f)));
 
@@ -33,10 +35,12 @@ int main()
     {
         if (ImGui::Begin("Resolution"))
         {
-            ImGui::SliderFloat("Render Scale",&engine.render_scale, 0.01f, 1.f);
+            ImGui::SliderFloat("Render Scale", &engine.render_scale, MIN_RENDER_SCALE, 1.f);
             ImGui::Text("Render Resolution: (%d, %d)", engine.draw_extent.width, engine.draw_extent.height);
             ImGui::Text("Window Resolution: (%d, %d)", engine.swapchain.extent.width, engine.swapchain.extent.height);
             ImGui::Text("Buffer Resolution: (%d, %d)", engine.draw_image.extent.width, engine.draw_image.extent.height);
+            ImGui::Text("Transient Memory: %.1f MiB (%.1f MiB unaliased)", engine.transients.size / 1048576.f,
+                    engine.transients.unaliased_size / 1048576.f);
             ImGui::End();
         }
 
@@ -68,38 +72,40 @@ int main()
         engine.scene_data.gpu_data.viewproj = engine.scene_data.gpu_data.proj * engine.scene_data.gpu_data.view ;
     };
 
-    for (std::uint8_t i = 0; i < 3; ++i)
+    // NOTE: The color outputs are not read after the geometry pass, so they never have to leave tile memory.
+    std::vector<allocated_image_t> color_images(3);
+    for (allocated_image_t& img : color_images)
     {
-        engine.color_images.push_back(engine.create_image(engine.draw_image.extent, engine.draw_image.format,
-            vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eColorAttachment).value());
+        engine.declare_transient_image(&img, transient_image_info_t{ .format = engine.draw_image.format,
+                .usage = vk::ImageUsageFlagBits::eColorAttachment, .first_pass = frame_pass_e::GEOMETRY, .last_pass = frame_pass_e::GEOMETRY,
+                .tile_only = true });
     }
-    engine.main_deletion_queue.push_function([&](){ for (auto img : engine.color_images) engine.destroy_image(img); });
 
     engine.draw_cmd = [&](vk::CommandBuffer cmd, std::uint32_t swapchain_img_idx) -> vk::ImageLayout
     {
         vkutil::transition_image(cmd, engine.draw_image.image, vk::ImageLayout::eUndefined, vk::ImageLayout::eColorAttachmentOptimal);
         vkutil::transition_image(cmd, engine.depth_image.image, vk::ImageLayout::eUndefined, vk::ImageLayout::eDepthAttachmentOptimal);
+        for (const allocated_image_t& img : color_images)
+        {
+            vkutil::transition_image(cmd, img.image, vk::ImageLayout::eUndefined, vk::ImageLayout::eColorAttachmentOptimal);
+        }
 
         vk::ClearValue clear_value;
         clear_value.depthStencil.depth = 1.f;
         std::vector<vk::RenderingAttachmentInfo> color_attachments = {
-            vk::RenderingAttachmentInfo(engine.color_images[0].view, vk::ImageLayout::eColorAttachmentOptimal, {}, {}, {}, vk::AttachmentLoadOp::eClear,
-                    vk::AttachmentStoreOp::eStore, vk::ClearValue(vk::ClearColorValue(std::array<float, 4>{0}))),
-            vk::RenderingAttachmentInfo(engine.color_images[1].view, vk::ImageLayout::eColorAttachmentOptimal, {}, {}, {}, vk::AttachmentLoadOp::eClear,
-                    vk::AttachmentStoreOp::eStore, vk::ClearValue(vk::ClearColorValue(std::array<float, 4>{0}))),
-            vk::RenderingAttachmentInfo(engine.color_images[2].view, vk::ImageLayout::eColorAttachmentOptimal, {}, {}, {}, vk::AttachmentLoadOp::eClear,
-                    vk::AttachmentStoreOp::eStore, vk::ClearValue(vk::ClearColorValue(std::array<float, 4>{0})))
+            vk::RenderingAttachmentInfo(color_images[0].view, vk::ImageLayout::eColorAttachmentOptimal, {}, {}, {}, vk::AttachmentLoadOp::eClear,
+                    vk::AttachmentStoreOp::eDontCare, vk::ClearValue(vk::ClearColorValue(std::array<float, 4>{0}))),
+            vk::RenderingAttachmentInfo(color_images[1].view, vk::ImageLayout::eColorAttachmentOptimal, {}, {}, {}, vk::AttachmentLoadOp::eClear,
+                    vk::AttachmentStoreOp::eDontCare, vk::ClearValue(vk::ClearColorValue(std::array<float, 4>{0}))),
+            vk::RenderingAttachmentInfo(color_images[2].view, vk::ImageLayout::eColorAttachmentOptimal, {}, {}, {}, vk::AttachmentLoadOp::eClear,
+                    vk::AttachmentStoreOp::eDontCare, vk::ClearValue(vk::ClearColorValue(std::array<float, 4>{0})))
         };
         vk::RenderingAttachmentInfo depth_attachment(engine.depth_image.view, vk::ImageLayout::eDepthAttachmentOptimal, {}, {}, {}, vk::AttachmentLoadOp::eClear,
-                vk::AttachmentStoreOp::eStore, clear_value);
+                vk::AttachmentStoreOp::eDontCare, clear_value);
 
         engine.draw_geometry(cmd, color_attachments, depth_attachment);
 
-        vkutil::transition_image(cmd, engine.draw_image.image, vk::ImageLayout::eColorAttachmentOptimal, vk::ImageLayout::eTransferSrcOptimal);
-        vkutil::transition_image(cmd, engine.swapchain.images[swapchain_img_idx], vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal);
-
-        vkutil::copy_image_to_image(cmd, engine.draw_image.image, engine.swapchain.images[swapchain_img_idx], engine.draw_extent, engine.swapchain.extent);
-        return vk::ImageLayout::eTransferDstOptimal;
+        return engine.draw_upscale(cmd, swapchain_img_idx);
     };
 
     engine.run();
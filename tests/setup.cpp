@@ -7,9 +7,21 @@
 int main(int argc, char** argv)
 {
     std::string file = "/tests/assets/structure.glb";
-    if (argc > 1) file = argv[1];
+    bool descriptor_buffer = false;
+    vertex_format_e vertex_format = vertex_format_e::FLOAT;
+    upscale_mode_e upscale_mode = upscale_mode_e::SPATIAL;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::string(argv[i]) == "--descriptor-buffer") descriptor_buffer = true;
+        else if (std::string(argv[i]) == "--packed") vertex_format = vertex_format_e::PACKED;
+        else if (std::string(argv[i]) == "--quantized") vertex_format = vertex_format_e::QUANTIZED;
+        else if (std::string(argv[i]) == "--temporal") upscale_mode = upscale_mode_e::TEMPORAL;
+        else file = argv[i];
+    }
     std::string pwd = std::filesystem::current_path().string();
     engine_t engine(2048, 2048, "setup-test", true, true);
+    if (descriptor_buffer) engine.descriptor_backend = descriptor_backend_e::BUFFER;
+    engine.upscaler.mode = upscale_mode;
     
     camera_t cam{ .position = glm::vec3(0.f, 0.f, 2.f) };
     glfwSetWindowUserPointer(engine.window.win, &cam);
@@ -20,19 +32,24 @@ int main(int argc, char** argv)
     {
         return EXIT_FAILURE;
     }
-    std::vector<vk::VertexInputBindingDescription> input_bindings = { vk::VertexInputBindingDescription(0, sizeof(glm::mat4), vk::VertexInputRate::eInstance) };
+    // binding 0: instance transforms, binding 1: instance transforms of the last frame
+    std::vector<vk::VertexInputBindingDescription> input_bindings = { vk::VertexInputBindingDescription(0, sizeof(glm::mat4), vk::VertexInputRate::eInstance),
+        vk::VertexInputBindingDescription(1, sizeof(glm::mat4), vk::VertexInputRate::eInstance) };
     std::vector<vk::VertexInputAttributeDescription> input_attriubtes = { vk::VertexInputAttributeDescription(0, 0, vk::Format::eR32G32B32A32Sfloat, 0),
         vk::VertexInputAttributeDescription(1, 0, vk::Format::eR32G32B32A32Sfloat, sizeof(float) * 4),
         vk::VertexInputAttributeDescription(2, 0, vk::Format::eR32G32B32A32Sfloat, sizeof(float) * 8),
-        vk::VertexInputAttributeDescription(3, 0, vk::Format::eR32G32B32A32Sfloat, sizeof(float) * 12)
+        vk::VertexInputAttributeDescription(3, 0, vk::Format::eR32G32B32A32Sfloat, sizeof(float) * 12),
+        vk::VertexInputAttributeDescription(4, 1, vk::Format::eR32G32B32A32Sfloat, 0),
+        vk::VertexInputAttributeDescription(5, 1, vk::Format::eR32G32B32A32Sfloat, sizeof(float) * 4),
+        vk::VertexInputAttributeDescription(6, 1, vk::Format::eR32G32B32A32Sfloat, sizeof(float) * 8),
+        vk::VertexInputAttributeDescription(7, 1, vk::Format::eR32G32B32A32Sfloat, sizeof(float) * 12)
     };
     if (!engine.metal_rough_material.build_pipelines(&engine, pwd + "/tests/build/shaders/mesh.vert.spv", pwd + "/tests/build/shaders/mesh.frag.spv",
-                sizeof(gpu_draw_push_constants_t), { {0, vk::DescriptorType::eUniformBuffer}, {1, vk::DescriptorType::eCombinedImageSampler}, {2, vk::DescriptorType::eCombinedImageSampler} },
-                { engine.scene_data.layout }, input_bindings, input_attriubtes))
+                sizeof(gpu_draw_push_constants_t), input_bindings, input_attriubtes))
     {
         return EXIT_FAILURE;
     }
-    engine.load_model(pwd + file, "structure");
+    engine.load_model(pwd + file, "structure", vertex_format);
     engine.loaded_scenes["structure"]->transform.push_back(glm::mat4(1));
 
     engine.define_imgui_windows = [&]()
@@ -51,7 +68,7 @@ int main(int argc, char** argv)
             ImGui::InputFloat4("light dir", (float*) &engine.scene_data.gpu_data.sunlight_dir);
 
             ImGui::Text("Info:");
-            ImGui::SliderFloat("Render Scale",&engine.render_scale, 0.01f, 1.f);
+            ImGui::SliderFloat("Render Scale", &engine.render_scale, MIN_RENDER_SCALE, 1.f);
             ImGui::Text("Render Resolution: (%d, %d)", engine.draw_extent.width, engine.draw_extent.height);
             ImGui::Text("Window Resolution: (%d, %d)", engine.swapchain.extent.width, engine.swapchain.extent.height);
             ImGui::Text("Buffer Resolution: (%d, %d)", engine.draw_image.extent.width, engine.draw_image.extent.height);
@@ -0,0 +1,195 @@
+// Shared by the downsampling shaders. Reduces a 64x64 tile of `base_level` into up to 6 mip levels per workgroup. Only the first
+// level is read from memory, the following ones are reduced across the quads of the workgroup and through shared memory.
+// NOTE: Quads are reduced with quad subgroup operations if `SUBGROUP_QUAD` is defined, which requires GL_KHR_shader_subgroup_quad.
+layout (local_size_x = 256) in;
+
+layout (set = 0, binding = 0) uniform texture2D source;
+layout (set = 0, binding = 1) uniform writeonly image2D levels[6];
+
+const uint FILTER_AVERAGE = 0;
+const uint FILTER_AVERAGE_SRGB = 1;
+const uint FILTER_MIN = 2;
+const uint FILTER_MAX = 3;
+
+layout (push_constant) uniform constants
+{
+    ivec2 source_extent;
+    int base_level;
+    int level_count;
+    uint filter_mode;
+} push_constants;
+
+// texels of the last level reduced within the workgroup, row by row
+shared vec4 tile[256];
+shared float tile_weights[256];
+#ifndef SUBGROUP_QUAD
+// values of the quads if quad operations are not supported
+shared vec4 quad_values[256];
+shared float quad_weights[256];
+#endif
+
+vec3 srgb_to_linear(vec3 c)
+{
+    return mix(c / 12.92, pow((c + 0.055) / 1.055, vec3(2.4)), greaterThan(c, vec3(0.04045)));
+}
+
+vec3 linear_to_srgb(vec3 c)
+{
+    return mix(c * 12.92, 1.055 * pow(c, vec3(1.0 / 2.4)) - 0.055, greaterThan(c, vec3(0.0031308)));
+}
+
+// value of texels outside of the level, it does not change the result of `combine`
+vec4 identity()
+{
+    if (push_constants.filter_mode == FILTER_MIN) return vec4(uintBitsToFloat(0x7f800000u));
+    if (push_constants.filter_mode == FILTER_MAX) return vec4(-uintBitsToFloat(0x7f800000u));
+    return vec4(0.0);
+}
+
+vec4 combine(vec4 a, vec4 b)
+{
+    if (push_constants.filter_mode == FILTER_MIN) return min(a, b);
+    if (push_constants.filter_mode == FILTER_MAX) return max(a, b);
+    return a + b;
+}
+
+vec4 finish(vec4 v, float weight)
+{
+    if (push_constants.filter_mode == FILTER_MIN || push_constants.filter_mode == FILTER_MAX) return v;
+    return v / max(weight, 1.0);
+}
+
+void store(int level, ivec2 p, vec4 v)
+{
+    if (push_constants.filter_mode == FILTER_AVERAGE_SRGB) v.rgb = linear_to_srgb(v.rgb);
+    // NOTE: Constant indices, so the image array does not need dynamic indexing.
+    switch (level)
+    {
+        case 0: imageStore(levels[0], p, v); break;
+        case 1: imageStore(levels[1], p, v); break;
+        case 2: imageStore(levels[2], p, v); break;
+        case 3: imageStore(levels[3], p, v); break;
+        case 4: imageStore(levels[4], p, v); break;
+        case 5: imageStore(levels[5], p, v); break;
+    }
+}
+
+// Position of invocation `index` in a tile `width` texels wide. Every 4 consecutive invocations cover a 2x2 block, so each quad
+// holds the children of one texel of the next level.
+ivec2 quad_position(uint index, uint width)
+{
+    uint quad = index >> 2;
+    uint half_width = width >> 1;
+    return ivec2((quad % half_width) * 2 + (index & 1), (quad / half_width) * 2 + ((index >> 1) & 1));
+}
+
+// Combines the values of a quad. Expects uniform control flow.
+vec4 reduce_quad(vec4 v, inout float weight, uint index)
+{
+#ifdef SUBGROUP_QUAD
+    v = combine(v, subgroupQuadSwapHorizontal(v));
+    weight += subgroupQuadSwapHorizontal(weight);
+    v = combine(v, subgroupQuadSwapVertical(v));
+    weight += subgroupQuadSwapVertical(weight);
+    return v;
+#else
+    quad_values[index] = v;
+    quad_weights[index] = weight;
+    barrier();
+    uint first = index & ~3u;
+    v = combine(combine(quad_values[first], quad_values[first + 1]), combine(quad_values[first + 2], quad_values[first + 3]));
+    weight = quad_weights[first] + quad_weights[first + 1] + quad_weights[first + 2] + quad_weights[first + 3];
+    barrier();
+    return v;
+#endif
+}
+
+// Reduces the source texels of texel `p` of the first level. The last texel of an odd dimension covers 3 source texels
+// so none of them are dropped.
+vec4 reduce_source(ivec2 p, out float weight)
+{
+    ivec2 extent = max(push_constants.source_extent / 2, ivec2(1));
+    weight = 0.0;
+    if (any(greaterThanEqual(p, extent))) return identity();
+
+    ivec2 begin = p * 2;
+    ivec2 end = min(begin + 2, push_constants.source_extent);
+    if (p.x == extent.x - 1) end.x = push_constants.source_extent.x;
+    if (p.y == extent.y - 1) end.y = push_constants.source_extent.y;
+
+    vec4 v = identity();
+    float count = 0.0;
+    for (int y = begin.y; y < end.y; ++y)
+    {
+        for (int x = begin.x; x < end.x; ++x)
+        {
+            vec4 texel = texelFetch(source, ivec2(x, y), push_constants.base_level);
+            if (push_constants.filter_mode == FILTER_AVERAGE_SRGB) texel.rgb = srgb_to_linear(texel.rgb);
+            v = combine(v, texel);
+            count += 1.0;
+        }
+    }
+    weight = 1.0;
+    return finish(v, count);
+}
+
+void main()
+{
+    uint index = gl_LocalInvocationIndex;
+    ivec2 group = ivec2(gl_WorkGroupID.xy);
+
+    // first level, the 32x32 texels of the workgroup are split into 4 quadrants of 16x16 texels
+    ivec2 position = quad_position(index, 16);
+    vec4 values[4];
+    float weights[4];
+    for (int i = 0; i < 4; ++i)
+    {
+        ivec2 p = group * 32 + ivec2(i & 1, i >> 1) * 16 + position;
+        values[i] = reduce_source(p, weights[i]);
+        if (weights[i] > 0.0) store(0, p, values[i]);
+    }
+    if (push_constants.level_count == 1) return;
+
+    // NOTE: The host only reduces levels within the workgroup whose previous level has an even size or a size of 1,
+    // so every child of a texel is in the same workgroup. Texels outside of the level have a weight of 0.
+    for (int i = 0; i < 4; ++i)
+    {
+        float weight = weights[i];
+        vec4 v = reduce_quad(values[i], weight, index);
+        ivec2 p = ivec2(i & 1, i >> 1) * 8 + position / 2;
+        if ((index & 3) == 0)
+        {
+            v = finish(v, weight);
+            tile[p.y * 16 + p.x] = v;
+            tile_weights[p.y * 16 + p.x] = min(weight, 1.0);
+            if (weight > 0.0) store(1, group * 16 + p, v);
+        }
+    }
+    barrier();
+
+    for (int level = 2; level < push_constants.level_count; ++level)
+    {
+        uint width = 32u >> (level - 1);
+        bool active = index < width * width;
+        ivec2 p = quad_position(index, width);
+        vec4 v = identity();
+        float weight = 0.0;
+        if (active)
+        {
+            v = tile[p.y * width + p.x];
+            weight = tile_weights[p.y * width + p.x];
+        }
+        barrier();
+
+        v = reduce_quad(v, weight, index);
+        if (active && (index & 3) == 0)
+        {
+            p /= 2;
+            v = finish(v, weight);
+            tile[p.y * (width / 2) + p.x] = v;
+            tile_weights[p.y * (width / 2) + p.x] = min(weight, 1.0);
+            if (weight > 0.0) store(level, group * int(width / 2) + p, v);
+        }
+        barrier();
+    }
+}
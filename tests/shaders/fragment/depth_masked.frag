@@ -0,0 +1,14 @@
+#version 450
+
+#extension GL_GOOGLE_include_directive : require
+#include "../input_structures.glsl"
+
+layout (location = 0) in vec2 in_uv;
+layout (location = 1) flat in uint in_material;
+
+void main()
+{
+    gltf_material_data_t material = material_data.materials[in_material];
+    float alpha = sample_color(in_material, in_uv).a * material.color_factors.a;
+    if (alpha < material.extra[0].x) discard;
+}
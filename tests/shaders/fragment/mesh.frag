@@ -6,13 +6,19 @@
 layout (location = 0) in vec3 in_normal;
 layout (location = 1) in vec3 in_color;
 layout (location = 2) in vec2 in_uv;
+layout (location = 3) flat in uint in_material;
+layout (location = 4) in vec4 in_curr_position;
+layout (location = 5) in vec4 in_prev_position;
 
 layout (location = 0) out vec4 out_color;
+// screen space motion since the last frame in uv units
+layout (location = 1) out vec2 out_motion;
 
 void main()
 {
     float light_value = max(dot(in_normal, scene_data.sunlight_dir.xyz), 0.1f);
 
-    vec3 color = in_color * texture(color_tex, in_uv).xyz;
+    vec3 color = in_color * sample_color(in_material, in_uv).xyz;
     out_color = vec4((light_value * scene_data.sunlight_color.xyz + scene_data.ambient_color.xyz) * color, 1.f);
+    out_motion = (in_curr_position.xy / in_curr_position.w - in_prev_position.xy / in_prev_position.w) * 0.5f;
 }
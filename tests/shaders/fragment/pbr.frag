@@ -7,6 +7,7 @@ layout (location = 0) in vec3 in_pos;
 layout (location = 1) in vec3 in_normal;
 layout (location = 2) in vec3 in_color;
 layout (location = 3) in vec2 in_uv;
+layout (location = 4) flat in uint in_material;
 
 layout (location = 0) out vec4 out_pos;
 layout (location = 1) out vec4 out_normal;
@@ -15,7 +16,7 @@ layout (location = 2) out vec4 out_color;
 void main()
 {
     out_pos = vec4(in_pos, 1.f);
-    out_color.rgb = texture(color_tex, in_uv).rgb;
-    out_color.a = texture(metal_rough_tex, in_uv).r;
+    out_color.rgb = sample_color(in_material, in_uv).rgb;
+    out_color.a = sample_metal_rough(in_material, in_uv).r;
     out_normal = vec4(normalize(in_normal), 1.f);
 }
@@ -1,3 +1,6 @@
+#extension GL_EXT_nonuniform_qualifier : require
+#extension GL_EXT_buffer_reference : require
+
 layout (set = 0, binding = 0) uniform scene_data_t
 {
     mat4 view;
@@ -6,13 +9,120 @@ layout (set = 0, binding = 0) uniform scene_data_t
     vec4 ambient_color;
     vec4 sunlight_dir;
     vec4 sunlight_color;
+    // without the sub-pixel jitter of the temporal upscaler, used for motion vectors
+    mat4 unjittered_viewproj;
+    mat4 prev_viewproj;
+    // xy: jitter in pixels
+    vec4 jitter;
 } scene_data;
 
-layout (set = 1, binding = 0) uniform gltf_material_data_t
+struct gltf_material_data_t
 {
     vec4 color_factors;
     vec4 metal_rough_factors;
+    // x: color texture, y: color sampler, z: metal rough texture, w: metal rough sampler
+    uvec4 texture_indices;
+    // extra[0].x: alpha cutoff of masked materials
+    vec4 extra[13];
+};
+
+layout (set = 1, binding = 0) readonly buffer material_buffer_t
+{
+    gltf_material_data_t materials[];
 } material_data;
 
-layout (set = 1, binding = 1) uniform sampler2D color_tex;
-layout (set = 1, binding = 2) uniform sampler2D metal_rough_tex;
+layout (set = 1, binding = 1) uniform texture2D textures[];
+layout (set = 1, binding = 2) uniform sampler samplers[];
+
+vec4 sample_texture(uint texture_index, uint sampler_index, vec2 uv)
+{
+    return texture(sampler2D(textures[nonuniformEXT(texture_index)], samplers[nonuniformEXT(sampler_index)]), uv);
+}
+
+vec4 sample_color(uint material, vec2 uv)
+{
+    uvec4 idx = material_data.materials[material].texture_indices;
+    return sample_texture(idx.x, idx.y, uv);
+}
+
+vec4 sample_metal_rough(uint material, vec2 uv)
+{
+    uvec4 idx = material_data.materials[material].texture_indices;
+    return sample_texture(idx.z, idx.w, uv);
+}
+
+// Has to match `vertex_format_e`.
+const uint VERTEX_FORMAT_FLOAT = 0;
+const uint VERTEX_FORMAT_PACKED = 1;
+const uint VERTEX_FORMAT_QUANTIZED = 2;
+
+struct vertex_t
+{
+    vec3 position;
+    vec3 normal;
+    vec2 uv;
+    vec4 color;
+};
+
+layout (buffer_reference, std430) readonly buffer vertex_buffer_t
+{
+    vertex_t vertices[];
+};
+
+// Packed and quantized vertices are read as raw 32 bit words since their members have no matching std430 types.
+layout (buffer_reference, std430) readonly buffer packed_vertex_buffer_t
+{
+    uint words[];
+};
+
+vec3 decode_octahedral(uint packed_normal)
+{
+    vec2 e = unpackSnorm2x16(packed_normal);
+    vec3 n = vec3(e, 1.f - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.f);
+    n.x += n.x >= 0.f ? -t : t;
+    n.y += n.y >= 0.f ? -t : t;
+    return normalize(n);
+}
+
+vec3 decode_position_unorm16(uint xy, uint z, vec3 offset, vec3 scale)
+{
+    return offset + vec3(unpackUnorm2x16(xy), unpackUnorm2x16(z).x) * scale;
+}
+
+// Fetches and decodes only the position of the vertex at `index`. Used by depth-only passes.
+// NOTE: `load_vertex` decodes the position through this function so both produce bit identical positions.
+vec3 load_position(vertex_buffer_t buffer, uint format, uint index, vec3 offset, vec3 scale)
+{
+    if (format == VERTEX_FORMAT_FLOAT) return buffer.vertices[index].position;
+
+    packed_vertex_buffer_t raw = packed_vertex_buffer_t(buffer);
+    if (format == VERTEX_FORMAT_PACKED)
+    {
+        uint base = index * 6;
+        return uintBitsToFloat(uvec3(raw.words[base], raw.words[base + 1], raw.words[base + 2]));
+    }
+    uint base = index * 5;
+    return decode_position_unorm16(raw.words[base], raw.words[base + 1], offset, scale);
+}
+
+// Fetches and decodes the vertex at `index` from a vertex buffer in the given `vertex_format_e`.
+// `offset` and `scale` are the dequantisation transform of the mesh and only used for VERTEX_FORMAT_QUANTIZED.
+vertex_t load_vertex(vertex_buffer_t buffer, uint format, uint index, vec3 offset, vec3 scale)
+{
+    vertex_t v;
+    if (format == VERTEX_FORMAT_FLOAT)
+    {
+        v = buffer.vertices[index];
+    }
+    else
+    {
+        packed_vertex_buffer_t raw = packed_vertex_buffer_t(buffer);
+        uint base = (format == VERTEX_FORMAT_PACKED) ? index * 6 + 3 : index * 5 + 2;
+        v.normal = decode_octahedral(raw.words[base]);
+        v.uv = unpackHalf2x16(raw.words[base + 1]);
+        v.color = unpackUnorm4x8(raw.words[base + 2]);
+    }
+    v.position = load_position(buffer, format, index, offset, scale);
+    return v;
+}
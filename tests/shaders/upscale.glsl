@@ -0,0 +1,37 @@
+// Shared by the spatial upscaling passes. The input always starts at the origin of the input image.
+layout (push_constant) uniform constants
+{
+    ivec2 input_extent;
+    ivec2 output_extent;
+    // RCAS sharpness in stops, 0 is the sharpest
+    float sharpness;
+} push_constants;
+
+// NOTE: Upper limit of the negative lobe, higher values cause ringing.
+const float RCAS_LIMIT = 0.25 - 1.0 / 16.0;
+
+vec3 rcas_load(ivec2 p)
+{
+    return clamp(imageLoad(input_image, clamp(p, ivec2(0), push_constants.output_extent - 1)).rgb, 0.0, 1.0);
+}
+
+// Robust contrast adaptive sharpening of the pixel at p. Uses a cross shaped negative lobe that is limited so the result
+// stays within the range of the neighbourhood.
+vec4 rcas(ivec2 p)
+{
+    vec3 b = rcas_load(p + ivec2(0, -1));
+    vec3 d = rcas_load(p + ivec2(-1, 0));
+    vec3 e = rcas_load(p);
+    vec3 f = rcas_load(p + ivec2(1, 0));
+    vec3 h = rcas_load(p + ivec2(0, 1));
+
+    vec3 mn = min(min(b, d), min(f, h));
+    vec3 mx = max(max(b, d), max(f, h));
+
+    vec3 hit_min = mn / max(4.0 * mx, 1e-5);
+    vec3 hit_max = (1.0 - mx) / min(4.0 * mn - 4.0, -1e-5);
+    vec3 lobe_rgb = max(-hit_min, hit_max);
+    float lobe = max(-RCAS_LIMIT, min(max(lobe_rgb.r, max(lobe_rgb.g, lobe_rgb.b)), 0.0)) * exp2(-push_constants.sharpness);
+
+    return vec4((lobe * (b + d + f + h) + e) / (4.0 * lobe + 1.0), 1.0);
+}
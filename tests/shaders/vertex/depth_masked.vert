@@ -0,0 +1,34 @@
+#version 450
+
+#extension GL_GOOGLE_include_directive : require
+#extension GL_EXT_buffer_reference : require
+
+#include "../input_structures.glsl"
+
+layout (location = 0) out vec2 out_uv;
+layout (location = 1) flat out uint out_material;
+
+layout (location = 0) in mat4 in_transform;
+
+invariant gl_Position;
+
+layout (push_constant) uniform constants
+{
+    mat4 render_matrix;
+    vertex_buffer_t vertex_buffer;
+    uint material_index;
+    uint vertex_format;
+    vec4 position_offset;
+    vec4 position_scale;
+} push_constants;
+
+void main()
+{
+    vertex_t v = load_vertex(push_constants.vertex_buffer, push_constants.vertex_format, uint(gl_VertexIndex),
+            push_constants.position_offset.xyz, push_constants.position_scale.xyz);
+    vec4 position = vec4(v.position, 1.f);
+    gl_Position = scene_data.viewproj * in_transform * position;
+
+    out_uv = v.uv;
+    out_material = push_constants.material_index;
+}
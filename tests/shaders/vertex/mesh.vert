@@ -8,35 +8,37 @@
 layout (location = 0) out vec3 out_normal;
 layout (location = 1) out vec3 out_color;
 layout (location = 2) out vec2 out_uv;
+layout (location = 3) flat out uint out_material;
+layout (location = 4) out vec4 out_curr_position;
+layout (location = 5) out vec4 out_prev_position;
 
 layout (location = 0) in mat4 in_transform;
+layout (location = 4) in mat4 in_prev_transform;
 
-struct vertex_t
-{
-    vec3 position;
-    vec3 normal;
-    vec2 uv;
-    vec4 color;
-};
-
-layout (buffer_reference, std430) readonly buffer vertex_buffer_t
-{
-    vertex_t vertices[];
-};
+// NOTE: Has to match the depth pre-pass shaders, since the main pass tests against their depth with eEqual.
+invariant gl_Position;
 
 layout (push_constant) uniform constants
 {
     mat4 render_matrix;
     vertex_buffer_t vertex_buffer;
+    uint material_index;
+    uint vertex_format;
+    vec4 position_offset;
+    vec4 position_scale;
 } push_constants;
 
 void main()
 {
-    vertex_t v = push_constants.vertex_buffer.vertices[gl_VertexIndex];
+    vertex_t v = load_vertex(push_constants.vertex_buffer, push_constants.vertex_format, uint(gl_VertexIndex),
+            push_constants.position_offset.xyz, push_constants.position_scale.xyz);
     vec4 position = vec4(v.position, 1.f);
     gl_Position = scene_data.viewproj * in_transform * position;
+    out_curr_position = scene_data.unjittered_viewproj * in_transform * position;
+    out_prev_position = scene_data.prev_viewproj * in_prev_transform * position;
 
     out_normal = normalize((in_transform * vec4(v.normal, 0.f)).xyz);
-    out_color = v.color.xyz * material_data.color_factors.xyz;
+    out_color = v.color.xyz * material_data.materials[push_constants.material_index].color_factors.xyz;
     out_uv = v.uv;
+    out_material = push_constants.material_index;
 }